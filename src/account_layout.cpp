@@ -0,0 +1,66 @@
+#include "include/account_layout.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "include/random.h"
+#include "include/simulator_main.h"
+
+/** Largest gap allocated between two scattered accounts */
+static constexpr size_t MAX_SCATTER_GAP = 512;
+
+const char *AccountLayoutName(AccountLayout layout) {
+    switch (layout) {
+        case AccountLayout::MAP:
+            return "map";
+        case AccountLayout::PACKED:
+            return "packed";
+        case AccountLayout::PADDED:
+            return "padded";
+        case AccountLayout::SCATTERED:
+            return "scattered";
+    }
+    return "unknown";
+}
+
+AccountStorage::AccountStorage(std::unordered_map<std::string, double> accounts, AccountLayout layout)
+        : map_(std::move(accounts)) {
+    if (layout == AccountLayout::MAP) {
+        addresses_ = GetAccountAddresses(map_);
+        return;
+    }
+
+    std::vector<double> balances;
+    balances.reserve(map_.size());
+    for (const auto &account : map_) {
+        balances.push_back(account.second);
+    }
+    addresses_.resize(balances.size());
+    if (layout == AccountLayout::PACKED) {
+        packed_ = std::move(balances);
+        for (size_t i = 0; i < packed_.size(); i++) {
+            addresses_[i] = &packed_[i];
+        }
+    } else if (layout == AccountLayout::PADDED) {
+        padded_.resize(balances.size());
+        for (size_t i = 0; i < padded_.size(); i++) {
+            padded_[i].balance_ = balances[i];
+            addresses_[i] = &padded_[i].balance_;
+        }
+    } else {
+        // Allocate in random order so neighbouring accounts are not neighbours on the heap
+        std::vector<size_t> order(balances.size());
+        std::iota(order.begin(), order.end(), 0);
+        for (size_t i = order.size(); i > 1; i--) {
+            std::swap(order[i - 1], order[Random::Uniform(i)]);
+        }
+        scattered_.resize(balances.size());
+        gaps_.reserve(balances.size());
+        for (auto i : order) {
+            gaps_.emplace_back(new char[1 + Random::Uniform(MAX_SCATTER_GAP)]);
+            scattered_[i] = std::make_unique<double>(balances[i]);
+            addresses_[i] = scattered_[i].get();
+        }
+    }
+    map_.clear();
+}
@@ -0,0 +1,74 @@
+#include "include/adaptive_policy.h"
+
+const char *TransactionModeName(TransactionMode mode) {
+    switch (mode) {
+        case TransactionMode::LAZY_PESSIMISTIC:
+            return "lazy pessimistic";
+        case TransactionMode::LAZY_OPTIMISTIC:
+            return "lazy optimistic";
+        case TransactionMode::EAGER_PESSIMISTIC:
+            return "eager pessimistic";
+    }
+    return "unknown";
+}
+
+bool AdaptivePolicy::Record(const TransactionSample &sample) {
+    if (sample.committed_) {
+        commits_++;
+    } else {
+        aborts_++;
+    }
+    accesses_ += sample.accesses_;
+    writes_ += sample.writes_;
+    stall_time_ += sample.stall_time_;
+    busy_time_ += sample.busy_time_;
+    return commits_ + aborts_ >= config_.window_transactions_;
+}
+
+TransactionMode AdaptivePolicy::Decide(TransactionMode current) {
+    size_t finished = commits_ + aborts_;
+    double abort_rate = finished == 0 ? 0 : static_cast<double>(aborts_) / static_cast<double>(finished);
+    double stall_fraction = busy_time_ == 0 ? 0 : static_cast<double>(stall_time_) / static_cast<double>(busy_time_);
+    double write_fraction = accesses_ == 0 ? 0 : static_cast<double>(writes_) / static_cast<double>(accesses_);
+    size_t mean_accesses = finished == 0 ? 0 : accesses_ / finished;
+    commits_ = 0;
+    aborts_ = 0;
+    accesses_ = 0;
+    writes_ = 0;
+    stall_time_ = 0;
+    busy_time_ = 0;
+
+    bool contended = abort_rate >= config_.high_abort_rate_ || stall_fraction >= config_.high_stall_fraction_;
+    bool uncontended = abort_rate <= config_.low_abort_rate_ && stall_fraction <= config_.low_stall_fraction_;
+    TransactionMode preferred = current;
+    if (write_fraction < config_.write_heavy_fraction_ || uncontended) {
+        preferred = TransactionMode::LAZY_OPTIMISTIC;
+    } else if (contended) {
+        preferred = mean_accesses >= config_.long_transaction_accesses_ ? TransactionMode::LAZY_PESSIMISTIC
+                                                                        : TransactionMode::EAGER_PESSIMISTIC;
+    }
+
+    if (preferred == current) {
+        candidate_windows_ = 0;
+        return current;
+    }
+    if (preferred != candidate_) {
+        candidate_ = preferred;
+        candidate_windows_ = 0;
+    }
+    if (++candidate_windows_ < config_.hysteresis_windows_) {
+        return current;
+    }
+    candidate_windows_ = 0;
+    return preferred;
+}
+
+void AdaptivePolicy::Reset() {
+    commits_ = 0;
+    aborts_ = 0;
+    accesses_ = 0;
+    writes_ = 0;
+    stall_time_ = 0;
+    busy_time_ = 0;
+    candidate_windows_ = 0;
+}
@@ -0,0 +1,98 @@
+#include "include/conflict_aware_scheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+
+ConflictAwareScheduler::ConflictAwareScheduler(size_t workers) : workers_(std::max<size_t>(workers, 1)) {}
+
+std::vector<std::vector<size_t>> ConflictAwareScheduler::Assign(size_t sites) {
+    accesses_.resize(sites);
+    if (round_aborts_.exchange(0) > 0) {
+        quiet_rounds_ = 0;
+    } else if (++quiet_rounds_ >= CONTENTION_ROUNDS && has_contended_) {
+        std::unique_lock<std::mutex> lock(contended_mutex_);
+        contended_.reset();
+        has_contended_ = false;
+        for (auto &accesses : accesses_) {
+            accesses.reset();
+        }
+    }
+    Footprint contended;
+    {
+        std::unique_lock<std::mutex> lock(contended_mutex_);
+        contended = contended_;
+    }
+
+    serialized_sites_ = 0;
+    std::vector<std::vector<size_t>> queues(workers_);
+    std::vector<Footprint> worker_footprints(workers_);
+    auto least_loaded = [&] {
+        return static_cast<size_t>(std::min_element(queues.begin(), queues.end(),
+                                                    [](const auto &a, const auto &b) {
+                                                        return a.size() < b.size();
+                                                    }) - queues.begin());
+    };
+
+    // Place sites with a footprint first so the rest can even out the load
+    std::vector<size_t> unknown;
+    for (size_t site = 0; site < sites; site++) {
+        auto footprint = accesses_[site] & contended;
+        if (footprint.none()) {
+            unknown.push_back(site);
+            continue;
+        }
+        size_t worker = workers_;
+        for (size_t w = 0; w < workers_; w++) {
+            if ((worker_footprints[w] & footprint).any()) {
+                worker = w;
+                serialized_sites_++;
+                break;
+            }
+        }
+        if (worker == workers_) {
+            worker = least_loaded();
+        }
+        queues[worker].push_back(site);
+        worker_footprints[worker] |= footprint;
+    }
+    for (auto site : unknown) {
+        queues[least_loaded()].push_back(site);
+    }
+    return queues;
+}
+
+void ConflictAwareScheduler::RecordAccesses(size_t site, const Transaction &transaction) {
+    if (has_contended_) {
+        accesses_[site] = FootprintOf(transaction);
+    }
+}
+
+void ConflictAwareScheduler::RecordAbort(size_t site, const Transaction &transaction) {
+    auto footprint = FootprintOf(transaction);
+    accesses_[site] = footprint;
+    round_aborts_++;
+    std::unique_lock<std::mutex> lock(contended_mutex_);
+    contended_ |= footprint;
+    has_contended_ = true;
+}
+
+ConflictAwareScheduler::Footprint ConflictAwareScheduler::FootprintOf(const Transaction &transaction) {
+    Footprint footprint;
+    for (auto *address : transaction.GetWriteSet()) {
+        footprint.set(StripeFor(address));
+    }
+    for (auto *address : transaction.GetReadSet()) {
+        footprint.set(StripeFor(address));
+    }
+    // An attempt aborted by a load or store has not added that address to its sets yet
+    if (transaction.GetLastAccess() != nullptr) {
+        footprint.set(StripeFor(transaction.GetLastAccess()));
+    }
+    return footprint;
+}
+
+size_t ConflictAwareScheduler::StripeFor(const void *address) {
+    // Fibonacci hashing, the low bits of addresses are mostly alignment
+    auto hash = (reinterpret_cast<uintptr_t>(address) >> 3) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(hash >> 32) % FOOTPRINT_BITS;
+}
@@ -0,0 +1,151 @@
+#include "include/coroutine_scheduler.h"
+
+#include <deque>
+#include <thread>
+
+#include "include/abort_exception.h"
+
+namespace {
+
+/** awaiter of the coroutine that just suspended on the calling worker */
+thread_local StallAwaiter *suspended_awaiter = nullptr;
+
+}
+
+TransactionTask &TransactionTask::operator=(TransactionTask &&other) noexcept {
+    if (this != &other) {
+        if (handle_ != nullptr) {
+            handle_.destroy();
+        }
+        handle_ = other.handle_;
+        other.handle_ = nullptr;
+    }
+    return *this;
+}
+
+TransactionTask::~TransactionTask() {
+    if (handle_ != nullptr) {
+        handle_.destroy();
+    }
+}
+
+bool StallAwaiter::Poll() {
+    try {
+        return Retry();
+    } catch (...) {
+        exception_ = std::current_exception();
+        return true;
+    }
+}
+
+void StallAwaiter::Suspend() {
+    suspended_awaiter = this;
+}
+
+CoroutineScheduler::CoroutineScheduler(TransactionManager *transaction_manager, size_t workers)
+        : transaction_manager_(transaction_manager), workers_(workers) {}
+
+size_t CoroutineScheduler::Run(const std::vector<Body> &bodies) {
+    uint64_t first_stream = Random::ReserveStreams(bodies.size());
+    std::vector<size_t> aborts(workers_, 0);
+    std::vector<std::thread> threads;
+    threads.reserve(workers_);
+    for (size_t worker = 0; worker < workers_; worker++) {
+        threads.emplace_back([&, worker] { aborts[worker] = RunWorker(worker, bodies, first_stream); });
+    }
+    size_t total_aborts = 0;
+    for (size_t worker = 0; worker < workers_; worker++) {
+        threads[worker].join();
+        total_aborts += aborts[worker];
+    }
+    return total_aborts;
+}
+
+size_t CoroutineScheduler::RunWorker(size_t worker, const std::vector<Body> &bodies, uint64_t first_stream) {
+    std::vector<InFlight> in_flight;
+    for (size_t i = worker; i < bodies.size(); i += workers_) {
+        Xoshiro256 generator(Random::GetSeed(), first_stream + i);
+        in_flight.push_back({&bodies[i], nullptr, {}, nullptr, generator, generator});
+    }
+    std::deque<InFlight *> ready;
+    for (auto &transaction : in_flight) {
+        ready.push_back(&transaction);
+    }
+    std::vector<InFlight *> parked;
+
+    size_t aborts = 0;
+    auto run = [&](InFlight *transaction) {
+        switch (Step(transaction)) {
+            case Outcome::COMMITTED:
+                break;
+            case Outcome::SUSPENDED:
+                parked.push_back(transaction);
+                break;
+            case Outcome::ABORTED:
+                aborts++;
+                ready.push_back(transaction);
+                break;
+        }
+    };
+    while (!ready.empty() || !parked.empty()) {
+        if (!ready.empty()) {
+            auto *transaction = ready.front();
+            ready.pop_front();
+            run(transaction);
+        }
+
+        bool resumed = false;
+        for (size_t i = 0; i < parked.size();) {
+            auto *transaction = parked[i];
+            if (!transaction_manager_->IsStallOver(transaction->transaction_.get()) ||
+                !transaction->awaiter_->Poll()) {
+                i++;
+                continue;
+            }
+            parked[i] = parked.back();
+            parked.pop_back();
+            // Resume right away, a transaction that is running but not scheduled could block other readers
+            run(transaction);
+            resumed = true;
+        }
+        if (ready.empty() && !resumed) {
+            std::this_thread::yield();
+        }
+    }
+    return aborts;
+}
+
+CoroutineScheduler::Outcome CoroutineScheduler::Step(InFlight *in_flight) {
+    if (in_flight->transaction_ == nullptr) {
+        in_flight->generator_ = in_flight->attempt_generator_;
+        in_flight->transaction_.reset(new Transaction(transaction_manager_->XBegin()));
+        in_flight->task_ = (*in_flight->body_)(in_flight->transaction_.get());
+    }
+
+    // Transactions interleave on the worker, each keeps its own random stream
+    Random::Generator() = in_flight->generator_;
+    suspended_awaiter = nullptr;
+    in_flight->task_.handle_.resume();
+    in_flight->generator_ = Random::Generator();
+
+    if (!in_flight->task_.handle_.done()) {
+        in_flight->awaiter_ = suspended_awaiter;
+        suspensions_++;
+        return Outcome::SUSPENDED;
+    }
+    Outcome outcome = Outcome::COMMITTED;
+    try {
+        auto exception = in_flight->task_.handle_.promise().exception_;
+        if (exception != nullptr) {
+            std::rethrow_exception(exception);
+        }
+        in_flight->transaction_->XEnd();
+    } catch (const AbortException &e) {
+        VirtualTimeScheduler::Charge(SimulatedOperation::ABORT);
+        outcome = Outcome::ABORTED;
+    }
+    // The coroutine frame may reference the transaction
+    in_flight->task_ = TransactionTask();
+    in_flight->transaction_.reset();
+    return outcome;
+}
@@ -2,33 +2,84 @@
 
 
 void EagerVersionManager::Store(void *address, void *value, size_t len) {
+    auto &undo_log = undo_logs_.back();
     // If we write twice to the same location, we only care about the earliest write
-    if (undo_log_.count(address) == 0) {
+    auto saved = undo_log.saved_.find(address);
+    if (saved == undo_log.saved_.end() || saved->second < len) {
         void *buffered_val = malloc(len);
         std::memcpy(buffered_val, address, len);
-
-        undo_log_.emplace(
-                std::piecewise_construct,
-                std::forward_as_tuple(reinterpret_cast<void *>(address)),
-                std::forward_as_tuple(buffered_val, len));
+        if (region_ != nullptr && region_->Contains(address, len)) {
+            // The mapping may be written back to the file at any time, so the undo has to be durable first
+            region_->WaitDurable(region_->AppendUndo(transaction_id_, address, len));
+            logged_ = true;
+        }
+        undo_log.undos_.emplace_back(address, buffered_val, len);
+        undo_log.saved_[address] = len;
     }
     std::memcpy(address, value, len);
 }
 
-bool EagerVersionManager::GetValue(void *address, void *dest) {
+bool EagerVersionManager::GetValue(void *address, void *dest, size_t len) {
     return false;
 }
 
 void EagerVersionManager::Abort() {
-    for (const auto &undo : undo_log_) {
-        std::memcpy(undo.first, undo.second.data_, undo.second.size_);
-        free(undo.second.data_);
+    // Undo inner segments first so the outermost transaction's values are restored last
+    for (auto undo_log = undo_logs_.rbegin(); undo_log != undo_logs_.rend(); undo_log++) {
+        Restore(*undo_log);
+    }
+    if (logged_) {
+        region_->AppendAbort(transaction_id_);
     }
 }
 
 void EagerVersionManager::XEnd() {
-    for (const auto &undo : undo_log_) {
-        free(undo.second.data_);
+    if (logged_) {
+        std::vector<RedoEntry> redo;
+        for (const auto &undo_log : undo_logs_) {
+            for (const auto &undo : undo_log.undos_) {
+                if (region_->Contains(undo.address_, undo.size_)) {
+                    redo.push_back({undo.address_, undo.address_, undo.size_});
+                }
+            }
+        }
+        region_->WaitDurable(region_->AppendCommit(transaction_id_, redo));
+    }
+    for (const auto &undo_log : undo_logs_) {
+        for (const auto &undo : undo_log.undos_) {
+            free(undo.data_);
+        }
+    }
+}
+
+void EagerVersionManager::BeginNested() {
+    undo_logs_.emplace_back();
+}
+
+void EagerVersionManager::AbortNested() {
+    Restore(undo_logs_.back());
+    undo_logs_.pop_back();
+}
+
+void EagerVersionManager::CommitNested() {
+    auto child = std::move(undo_logs_.back());
+    undo_logs_.pop_back();
+    auto &parent = undo_logs_.back();
+    for (const auto &undo : child.undos_) {
+        // The parent's undo is older, only keep the child's if the parent never saved as much at the address
+        auto saved = parent.saved_.find(undo.address_);
+        if (saved != parent.saved_.end() && saved->second >= undo.size_) {
+            free(undo.data_);
+        } else {
+            parent.undos_.push_back(undo);
+            parent.saved_[undo.address_] = undo.size_;
+        }
     }
+}
 
+void EagerVersionManager::Restore(const UndoLog &undo_log) {
+    for (auto undo = undo_log.undos_.rbegin(); undo != undo_log.undos_.rend(); undo++) {
+        std::memcpy(undo->address_, undo->data_, undo->size_);
+        free(undo->data_);
+    }
 }
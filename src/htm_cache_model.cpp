@@ -0,0 +1,24 @@
+#include "include/htm_cache_model.h"
+
+#include <algorithm>
+
+HtmCacheModel::HtmCacheModel(const HtmConfig &config)
+        : ways_(config.ways_), line_size_(config.line_size_), sets_(config.sets_), footprint_(0) {}
+
+bool HtmCacheModel::Access(const void *address, size_t len) {
+    auto start = reinterpret_cast<uintptr_t>(address);
+    uintptr_t first_line = start / line_size_;
+    uintptr_t last_line = (start + std::max<size_t>(len, 1) - 1) / line_size_;
+    for (uintptr_t line = first_line; line <= last_line; line++) {
+        auto &set = sets_[line % sets_.size()];
+        if (std::find(set.begin(), set.end(), line) != set.end()) {
+            continue;
+        }
+        if (set.size() == ways_) {
+            return false;
+        }
+        set.push_back(line);
+        footprint_++;
+    }
+    return true;
+}
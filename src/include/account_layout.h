@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Where benchmark account balances live in memory
+ */
+enum class AccountLayout {
+    /** nodes of the unordered_map the accounts were generated in, wherever the allocator put them */
+    MAP,
+    /** one contiguous array, 8 accounts share a cache line */
+    PACKED,
+    /** one contiguous array with every account on its own cache line */
+    PADDED,
+    /** individually allocated in random order with random gaps between them */
+    SCATTERED
+};
+
+/**
+ *
+ * @param layout account layout
+ * @return command line name of the layout
+ */
+const char *AccountLayoutName(AccountLayout layout);
+
+/**
+ * Owns benchmark account balances in the requested layout
+ */
+class AccountStorage {
+public:
+    /**
+     * @param accounts account names and initial balances
+     * @param layout where to put the balances
+     */
+    AccountStorage(std::unordered_map<std::string, double> accounts, AccountLayout layout);
+
+    AccountStorage(const AccountStorage &) = delete;
+
+    AccountStorage &operator=(const AccountStorage &) = delete;
+
+    /**
+     *
+     * @return address of every balance, in the iteration order of the accounts map
+     */
+    const std::vector<double *> &GetAddresses() const { return addresses_; }
+
+private:
+    struct alignas(64) PaddedAccount {
+        double balance_;
+    };
+
+    std::unordered_map<std::string, double> map_;
+    std::vector<double> packed_;
+    std::vector<PaddedAccount> padded_;
+    std::vector<std::unique_ptr<double>> scattered_;
+    /** allocations that keep scattered accounts apart */
+    std::vector<std::unique_ptr<char[]>> gaps_;
+    std::vector<double *> addresses_;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Versioning and conflict detection a transaction manager runs with
+ */
+enum class TransactionMode {
+    LAZY_PESSIMISTIC,
+    LAZY_OPTIMISTIC,
+    EAGER_PESSIMISTIC
+};
+
+/**
+ *
+ * @param mode transaction mode
+ * @return readable name of the mode
+ */
+const char *TransactionModeName(TransactionMode mode);
+
+/**
+ * Thresholds of the adaptive policy. Rates between the low and high thresholds keep the current mode, so a workload
+ * near one threshold doesn't flip modes every window.
+ */
+struct AdaptiveConfig {
+    /** finished transactions per window */
+    size_t window_transactions_ = 512;
+    /** consecutive windows that must agree on a new mode before switching */
+    size_t hysteresis_windows_ = 3;
+    /** aborts per finished transaction at or above which the workload is contended */
+    double high_abort_rate_ = 0.25;
+    /** aborts per finished transaction at or below which the workload is uncontended */
+    double low_abort_rate_ = 0.05;
+    /** fraction of transaction time spent stalled at or above which the workload is contended */
+    double high_stall_fraction_ = 0.10;
+    /** fraction of transaction time spent stalled at or below which the workload is uncontended */
+    double low_stall_fraction_ = 0.01;
+    /** fraction of accessed addresses that are stored at or above which the workload is write heavy */
+    double write_heavy_fraction_ = 0.25;
+    /** mean loads and stores per transaction at or above which contended transactions count as long */
+    size_t long_transaction_accesses_ = 64;
+};
+
+/**
+ * What one finished transaction attempt contributes to a window
+ */
+struct TransactionSample {
+    bool committed_;
+    /** distinct addresses loaded or stored */
+    size_t accesses_;
+    /** distinct addresses stored */
+    size_t writes_;
+    /** time spent stalled in nanoseconds, or virtual cycles on a simulated core */
+    uint64_t stall_time_;
+    /** time from begin to end in nanoseconds, or virtual cycles on a simulated core */
+    uint64_t busy_time_;
+};
+
+/**
+ * Chooses a transaction mode from the abort rate, stall time, read write mix and length of the transactions in a
+ * window:
+ *
+ * - Read mostly and uncontended windows use lazy versioning and optimistic conflict detection. Readers never stall
+ * and the few writers don't lose to every reader of their addresses, they only abort readers that commit later.
+ * - Contended write heavy windows use pessimistic conflict detection, a writer that would lose at commit aborts
+ * before doing the rest of its work. Short transactions use eager versioning, whose commits are cheap and whose aborts
+ * only undo a few writes. Long ones use lazy versioning, which never has to undo anything.
+ * - Every other window keeps the current mode.
+ *
+ * Not thread safe.
+ */
+class AdaptivePolicy {
+public:
+    explicit AdaptivePolicy(const AdaptiveConfig &config) : config_(config) {}
+
+    /**
+     * Add a finished attempt to the current window
+     *
+     * @param sample finished attempt
+     * @return true if the window is full and Decide should be called
+     */
+    bool Record(const TransactionSample &sample);
+
+    /**
+     * Close the current window
+     *
+     * @param current mode the window ran with
+     * @return mode to switch to, current unless enough windows in a row preferred another mode
+     */
+    TransactionMode Decide(TransactionMode current);
+
+    /**
+     * Drop the current window and the windows counted towards a switch, after the mode changed
+     */
+    void Reset();
+
+    /**
+     *
+     * @return thresholds of the policy
+     */
+    const AdaptiveConfig &GetConfig() const { return config_; }
+
+private:
+    const AdaptiveConfig config_;
+
+    size_t commits_ = 0;
+    size_t aborts_ = 0;
+    size_t accesses_ = 0;
+    size_t writes_ = 0;
+    uint64_t stall_time_ = 0;
+    uint64_t busy_time_ = 0;
+
+    TransactionMode candidate_ = TransactionMode::LAZY_PESSIMISTIC;
+    size_t candidate_windows_ = 0;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "abort_exception.h"
+#include "capacity_abort_exception.h"
+#include "random.h"
+#include "retry_limit_exception.h"
+#include "transaction.h"
+#include "transaction_manager.h"
+#include "virtual_time_scheduler.h"
+
+/**
+ * How Atomically retries aborted transactions
+ */
+struct RetryPolicy {
+    /** attempts before giving up with a RetryLimitException, 0 retries until the transaction commits */
+    size_t max_attempts_ = 0;
+    /** start in emulated hardware when the manager emulates HTM, otherwise go straight to software */
+    bool use_htm_ = true;
+    /** pauses after the first abort, doubled after every further abort, 0 retries right away */
+    size_t initial_backoff_pauses_ = 0;
+    /** most pauses between two attempts */
+    size_t max_backoff_pauses_ = 1024;
+    /** retries draw the same random values as the first attempt, so every attempt runs the same transaction */
+    bool replay_random_ = true;
+};
+
+/**
+ * Abort callback of Atomically that does nothing
+ */
+struct IgnoreAborts {
+    void operator()(const Transaction &) const {}
+};
+
+/**
+ * Run body in a transaction until it commits. The body is inlined into the retry loop, unlike RunTransaction there's
+ * no type erased function to call, and its result is returned once the transaction that computed it committed.
+ *
+ * @tparam Body callable taking Transaction &
+ * @tparam OnAbort callable taking const Transaction &
+ * @param transaction_manager transaction manager
+ * @param body transaction body, may run several times
+ * @param policy how to retry aborted attempts
+ * @param on_abort called with every aborted attempt before it is retried
+ * @return result of the committed attempt
+ */
+template<typename Body, typename OnAbort = IgnoreAborts>
+std::invoke_result_t<Body &, Transaction &>
+Atomically(TransactionManager *transaction_manager, Body &&body, const RetryPolicy &policy = RetryPolicy(),
+           OnAbort &&on_abort = OnAbort()) {
+    using Result = std::invoke_result_t<Body &, Transaction &>;
+    size_t htm_attempts = policy.use_htm_ && transaction_manager->IsHtmEmulationEnabled()
+                          ? transaction_manager->GetHtmConfig().max_attempts_ : 0;
+    size_t attempts = 0;
+    size_t backoff_pauses = policy.initial_backoff_pauses_;
+    const Xoshiro256 attempt_generator = Random::Generator();
+    while (true) {
+        if (policy.replay_random_) {
+            Random::Generator() = attempt_generator;
+        }
+        Transaction transaction = transaction_manager->XBegin(htm_attempts > 0);
+        try {
+            if constexpr (std::is_void_v<Result>) {
+                body(transaction);
+                transaction.XEnd();
+                return;
+            } else {
+                Result result = body(transaction);
+                transaction.XEnd();
+                return result;
+            }
+        } catch (const CapacityAbortException &e) {
+            // The transaction will never fit, go straight to the software path
+            VirtualTimeScheduler::Charge(SimulatedOperation::ABORT);
+            htm_attempts = 0;
+            on_abort(static_cast<const Transaction &>(transaction));
+        } catch (const AbortException &e) {
+            VirtualTimeScheduler::Charge(SimulatedOperation::ABORT);
+            if (htm_attempts > 0) {
+                htm_attempts--;
+            }
+            on_abort(static_cast<const Transaction &>(transaction));
+        }
+
+        attempts++;
+        if (policy.max_attempts_ > 0 && attempts >= policy.max_attempts_) {
+            throw RetryLimitException("Transaction aborted on every allowed attempt");
+        }
+        for (size_t pause = 0; pause < backoff_pauses; pause++) {
+            VirtualTimeScheduler::Pause();
+        }
+        backoff_pauses = std::min(backoff_pauses * 2, policy.max_backoff_pauses_);
+    }
+}
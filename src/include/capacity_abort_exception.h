@@ -0,0 +1,12 @@
+#pragma once
+
+#include "abort_exception.h"
+
+/**
+ * Thrown when a best effort hardware transaction's footprint no longer fits in the simulated cache. Retrying in
+ * hardware won't help.
+ */
+class CapacityAbortException : public AbortException {
+public:
+    explicit CapacityAbortException(const char *msg) : AbortException(msg) {}
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "transaction.h"
+
+/**
+ * Assigns transaction sites to worker queues so transactions predicted to conflict run one after another on the same
+ * worker instead of colliding, in the style of CAR-STM and Shrink. A site is one of the functions a workload runs
+ * repeatedly. The read and write sets of aborted attempts mark addresses as contended, and a site's footprint is the
+ * contended part of the addresses its last attempt accessed. Sites whose footprints overlap are predicted to
+ * conflict, which also catches the transaction that won the conflict, and sites without one spread over the workers.
+ *
+ * Addresses are hashed onto FOOTPRINT_BITS stripes, so a false prediction only costs parallelism.
+ */
+class ConflictAwareScheduler {
+public:
+    static constexpr size_t FOOTPRINT_BITS = 1024;
+    /** contended addresses are forgotten after this many rounds without an abort, so stale predictions get rechecked */
+    static constexpr size_t CONTENTION_ROUNDS = 256;
+
+    using Footprint = std::bitset<FOOTPRINT_BITS>;
+
+    /**
+     * @param workers number of worker queues
+     */
+    explicit ConflictAwareScheduler(size_t workers);
+
+    /**
+     * Start a round by splitting sites between the workers. Sites with a footprint join the first worker that already
+     * runs an overlapping footprint, every other site goes to the least loaded worker.
+     *
+     * @param sites number of sites
+     * @return site indexes each worker should run in order, one queue per worker
+     */
+    std::vector<std::vector<size_t>> Assign(size_t sites);
+
+    /**
+     * Remember the addresses an attempt accessed as the accesses of its site. Only the worker running the site may call
+     * this, before the attempt ends. Does nothing while no address is contended.
+     *
+     * @param site site index
+     * @param transaction running attempt
+     */
+    void RecordAccesses(size_t site, const Transaction &transaction);
+
+    /**
+     * Mark the addresses an aborted attempt accessed as contended and remember them as the accesses of its site. Only
+     * the worker running the site may call this.
+     *
+     * @param site site index
+     * @param transaction aborted attempt
+     */
+    void RecordAbort(size_t site, const Transaction &transaction);
+
+    /**
+     *
+     * @return number of worker queues
+     */
+    size_t GetWorkers() const { return workers_; }
+
+    /**
+     *
+     * @return number of sites the last Assign queued behind a predicted conflict
+     */
+    size_t GetSerializedSites() const { return serialized_sites_; }
+
+private:
+    /**
+     *
+     * @param address accessed address
+     * @return footprint stripe of address
+     */
+    static size_t StripeFor(const void *address);
+
+    /**
+     *
+     * @param transaction attempt
+     * @return stripes of every address the attempt accessed
+     */
+    static Footprint FootprintOf(const Transaction &transaction);
+
+    const size_t workers_;
+    /** accesses of the last attempt of each site */
+    std::vector<Footprint> accesses_;
+    std::mutex contended_mutex_;
+    Footprint contended_;
+    std::atomic<bool> has_contended_{false};
+    std::atomic<size_t> round_aborts_{0};
+    size_t quiet_rounds_ = 0;
+    size_t serialized_sites_ = 0;
+};
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "random.h"
+#include "transaction.h"
+#include "transaction_manager.h"
+
+/**
+ * Coroutine running the body of a transaction on a CoroutineScheduler. Bodies load with co_await
+ * transaction->AsyncLoad(address) so a load that has to stall on a writer suspends the body instead of blocking the
+ * worker thread. Stores and every other transaction operation stay synchronous, they never stall.
+ */
+class TransactionTask {
+public:
+    struct promise_type {
+        std::exception_ptr exception_;
+
+        TransactionTask get_return_object() {
+            return TransactionTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        /** Start suspended so the scheduler decides when the body first runs */
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+
+        void unhandled_exception() { exception_ = std::current_exception(); }
+    };
+
+    TransactionTask() = default;
+
+    TransactionTask(TransactionTask &&other) noexcept: handle_(other.handle_) { other.handle_ = nullptr; }
+
+    TransactionTask &operator=(TransactionTask &&other) noexcept;
+
+    TransactionTask(const TransactionTask &) = delete;
+
+    TransactionTask &operator=(const TransactionTask &) = delete;
+
+    ~TransactionTask();
+
+private:
+    explicit TransactionTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_ = nullptr;
+
+    friend class CoroutineScheduler;
+};
+
+/**
+ * Awaitable that suspends its coroutine while its transaction is stalled. The scheduler polls it once the stall may
+ * be over.
+ */
+class StallAwaiter {
+public:
+    explicit StallAwaiter(Transaction *transaction) : transaction_(transaction) {}
+
+    virtual ~StallAwaiter() = default;
+
+    /**
+     * Retry the stalled operation, exceptions are kept and rethrown inside the coroutine
+     *
+     * @return true if the coroutine can resume, false if it stalled again
+     */
+    bool Poll();
+
+protected:
+    /**
+     * Continue the stalled transaction and retry the operation
+     *
+     * @return true if the operation completed, false if it stalled again
+     *
+     * @throws TransactionAbortException
+     */
+    virtual bool Retry() = 0;
+
+    /**
+     * Hand this awaiter to the scheduler running the coroutine
+     */
+    void Suspend();
+
+    /**
+     * Rethrow an exception Retry threw while the coroutine was suspended
+     */
+    void RethrowIfFailed() {
+        if (exception_ != nullptr) {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+    Transaction *transaction_;
+
+private:
+    std::exception_ptr exception_;
+};
+
+/**
+ * Awaitable returned by Transaction::AsyncLoad
+ *
+ * @tparam T type of value
+ */
+template<typename T>
+class LoadAwaiter : public StallAwaiter {
+public:
+    LoadAwaiter(Transaction *transaction, T *address) : StallAwaiter(transaction), address_(address) {}
+
+    bool await_ready() { return transaction_->TryLoad(address_, &value_); }
+
+    void await_suspend(std::coroutine_handle<>) { Suspend(); }
+
+    T await_resume() {
+        RethrowIfFailed();
+        return value_;
+    }
+
+protected:
+    bool Retry() override {
+        transaction_->ResumeAfterStall();
+        return transaction_->TryLoad(address_, &value_);
+    }
+
+private:
+    T *address_;
+    T value_;
+};
+
+template<typename T>
+LoadAwaiter<T> Transaction::AsyncLoad(T *address) {
+    return LoadAwaiter<T>(this, address);
+}
+
+/**
+ * Runs many transactions as coroutines on a few worker threads. A worker resumes its ready transactions one at a time
+ * and parks the ones suspended on a stall, so a stalled reader costs no thread. Parked transactions resume on their
+ * worker once a writer released an address on their stall queue or they were aborted.
+ *
+ * Coroutines never move between workers, so thread local state like allocator pins stays on one thread. Bodies must
+ * load through AsyncLoad: a blocking Load could wait on a writer parked on the same worker.
+ */
+class CoroutineScheduler {
+public:
+    using Body = std::function<TransactionTask(Transaction *)>;
+
+    /**
+     * @param transaction_manager manager the transactions run on
+     * @param workers number of worker threads
+     */
+    CoroutineScheduler(TransactionManager *transaction_manager, size_t workers);
+
+    /**
+     * Run every body as a transaction until it commits, bodies are assigned to workers round robin and all of them
+     * are in flight at once
+     *
+     * @param bodies transaction bodies, must outlive the call
+     * @return number of aborts
+     */
+    size_t Run(const std::vector<Body> &bodies);
+
+    /**
+     *
+     * @return number of worker threads
+     */
+    size_t GetWorkers() const { return workers_; }
+
+    /**
+     *
+     * @return number of times a transaction was suspended on a stall since the scheduler was created
+     */
+    size_t GetSuspensions() const { return suspensions_; }
+
+private:
+    /**
+     * A body and its current attempt
+     */
+    struct InFlight {
+        const Body *body_;
+        std::unique_ptr<Transaction> transaction_;
+        TransactionTask task_;
+        StallAwaiter *awaiter_ = nullptr;
+        /** random values of every attempt start from this state, see RunTransaction */
+        Xoshiro256 attempt_generator_;
+        Xoshiro256 generator_;
+    };
+
+    enum class Outcome {
+        COMMITTED, SUSPENDED, ABORTED
+    };
+
+    /**
+     * Run a transaction until it commits, aborts or suspends
+     *
+     * @param in_flight transaction to run, a new attempt is started if it has none
+     * @return what happened
+     */
+    Outcome Step(InFlight *in_flight);
+
+    /**
+     * Run the bodies assigned to one worker
+     *
+     * @param worker worker index
+     * @param bodies every body
+     * @param first_stream random stream of the first body
+     * @return number of aborts
+     */
+    size_t RunWorker(size_t worker, const std::vector<Body> &bodies, uint64_t first_stream);
+
+    TransactionManager *transaction_manager_;
+    const size_t workers_;
+    std::atomic<size_t> suspensions_{0};
+
+    friend class StallAwaiter;
+};
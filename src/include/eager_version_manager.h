@@ -2,27 +2,44 @@
 
 #include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 #include <cstring>
 
+#include "persistent_region.h"
 #include "transaction_manager.h"
 #include "version_manager.h"
 
 
 struct Undo {
-    Undo(void *data, size_t size) : data_(data), size_(size) {}
+    Undo(void *address, void *data, size_t size) : address_(address), data_(data), size_(size) {}
 
+    void *address_;
     void *data_;
     size_t size_;
 };
 
 
-using UndoLog = std::unordered_map<void *, Undo>;
+/**
+ * Undos of one nesting level in the order they were taken. Restoring them newest first is correct even when the
+ * writes overlap, the largest undo taken at each address lets repeated writes skip the copy.
+ */
+struct UndoLog {
+    std::vector<Undo> undos_;
+    std::unordered_map<void *, size_t> saved_;
+};
 
 class EagerVersionManager : public VersionManager {
 public:
+    /**
+     * @param region persistent region whose old values are undo logged before they're overwritten, nullptr if nothing
+     * is persistent
+     * @param transaction_id id of the transaction the writes belong to
+     */
+    explicit EagerVersionManager(PersistentRegion *region = nullptr, uint64_t transaction_id = 0)
+            : region_(region), transaction_id_(transaction_id) {}
 
     /**
-    * Store undo into undo buffer
+    * Store undo into undo buffer. Undos of persistent addresses are durable before the address is overwritten.
     *
     * @param address address to undo
     * @param value value to undo
@@ -34,9 +51,10 @@ public:
      * Always returns false
      * @param address
      * @param dest
+     * @param len
      * @return false
      */
-    bool GetValue(void *address, void *dest);
+    bool GetValue(void *address, void *dest, size_t len) override;
 
     /**
      * AbortWithoutLocks transaction
@@ -44,11 +62,30 @@ public:
     void Abort() override;
 
     /**
-    * Free all memory related to transaction
+    * Make the writes to the persistent region durable and free all memory related to transaction
     */
     void XEnd() override;
 
+    void BeginNested() override;
+
+    void AbortNested() override;
+
+    void CommitNested() override;
+
 private:
-    UndoLog undo_log_;
+    /**
+     * Restore and free undos newest first
+     *
+     * @param undo_log undo log to roll back
+     */
+    static void Restore(const UndoLog &undo_log);
+
+    PersistentRegion *region_;
+    const uint64_t transaction_id_;
+    /** true once an undo record was appended to the region's log */
+    bool logged_ = false;
+
+    /** one segment per nesting level, the outermost transaction's segment is first */
+    std::vector<UndoLog> undo_logs_ = std::vector<UndoLog>(1);
 };
 
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Geometry of the simulated L1 cache and retry policy of the best effort hardware transactions
+ */
+struct HtmConfig {
+    size_t sets_ = 64;
+    size_t ways_ = 8;
+    size_t line_size_ = 64;
+    /** hardware attempts before falling back to software, capacity aborts fall back immediately */
+    size_t max_attempts_ = 3;
+};
+
+/**
+ * Tracks the cache lines a hardware transaction has touched in a simulated set associative L1. Transactional lines
+ * can't be evicted, so touching a new line in a set whose ways are all transactional is a capacity abort. Reads and
+ * writes are both tracked in the L1.
+ */
+class HtmCacheModel {
+public:
+    explicit HtmCacheModel(const HtmConfig &config);
+
+    /**
+     * Bring all lines covering [address, address + len) into the transactional footprint
+     *
+     * @param address start of access
+     * @param len length of access
+     * @return false if a line would have to be evicted, true otherwise
+     */
+    bool Access(const void *address, size_t len);
+
+    /**
+     *
+     * @return number of distinct lines in the footprint
+     */
+    size_t GetFootprint() const { return footprint_; }
+
+private:
+    const size_t ways_;
+    const size_t line_size_;
+    std::vector<std::vector<uintptr_t>> sets_;
+    size_t footprint_;
+};
@@ -2,11 +2,13 @@
 
 #include <cstdint>
 #include <unordered_map>
+#include <vector>
 #include <list>
 #include <iostream>
 #include <shared_mutex>
 #include <cstring>
 
+#include "persistent_region.h"
 #include "transaction_manager.h"
 #include "version_manager.h"
 
@@ -22,6 +24,12 @@ using WriteBuffer = std::unordered_map<void *, Write>;
 class LazyVersionManager : public VersionManager {
 
 public:
+    /**
+     * @param region persistent region whose writes are redo logged at commit, nullptr if nothing is persistent
+     * @param transaction_id id of the transaction the writes belong to
+     */
+    explicit LazyVersionManager(PersistentRegion *region = nullptr, uint64_t transaction_id = 0)
+            : region_(region), transaction_id_(transaction_id) {}
 
     /**
      * Store write into write buffer
@@ -37,9 +45,10 @@ public:
      * @param transaction_id id of transaction
      * @param address address to get value from
      * @param dest memory location to write value to
+     * @param len size of value
      * @return true if value was written to dest, false otherwise
      */
-    bool GetValue(void *address, void *dest) override;
+    bool GetValue(void *address, void *dest, size_t len) override;
 
     /**
      * Aborts transaction
@@ -47,10 +56,21 @@ public:
     void Abort() override;
 
     /**
-     * Free all memory related to transaction
+     * Make the writes to the persistent region durable, write back every buffered write and free all memory related
+     * to transaction
      */
     void XEnd() override;
 
+    void BeginNested() override;
+
+    void AbortNested() override;
+
+    void CommitNested() override;
+
 private:
-    WriteBuffer write_buffer_;
+    PersistentRegion *region_;
+    const uint64_t transaction_id_;
+
+    /** one segment per nesting level, the outermost transaction's segment is first */
+    std::vector<WriteBuffer> write_buffers_ = std::vector<WriteBuffer>(1);
 };
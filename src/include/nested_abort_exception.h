@@ -0,0 +1,10 @@
+#pragma once
+
+/**
+ * Thrown when only the innermost closed nested transaction has to be rolled back. Caught by
+ * Transaction::RunNested, the parent transaction keeps running.
+ */
+class NestedAbortException : public std::runtime_error {
+public:
+    explicit NestedAbortException(const char *msg) : std::runtime_error(msg) {}
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "slot_table.h"
+
+/**
+ * Ownership record of one stripe of addresses in four bytes, the slot + 1 of the writer in the upper half and the
+ * number of reading slots in the lower half. A slot counts as a single reader however many of its addresses share
+ * the orec.
+ */
+using Orec = std::atomic<uint32_t>;
+
+static_assert(sizeof(Orec) == 4, "Orecs have to stay four bytes");
+static_assert(Orec::is_always_lock_free, "Orecs have to work across processes");
+
+/**
+ * Lock-free pessimistic conflict detection for large key spaces. Works like ReaderBitmapTable, but addresses hash to
+ * a large table of four byte orecs instead of cache line sized reader bitmaps, so many more stripes fit in the same
+ * memory and unrelated addresses rarely share one. Nothing is allocated per access.
+ *
+ * Readers are counted instead of identified, so the caller has to remember which orecs each transaction reads.
+ *
+ * Orecs hold slot numbers instead of pointers and addresses are hashed by their offset from a base, so the orecs and
+ * slots can live in memory shared by processes that map it at different addresses.
+ */
+class OrecTable : public SlotTable {
+public:
+    static constexpr size_t DEFAULT_ORECS = 1 << 22;
+
+    /**
+     * @param orecs number of orecs addresses hash to, rounded up to a power of two
+     */
+    explicit OrecTable(size_t orecs = DEFAULT_ORECS);
+
+    /**
+     * Orecs and slots that live elsewhere, like in shared memory
+     *
+     * @param orecs zeroed orecs, must outlive the table
+     * @param count number of orecs, a power of two
+     * @param slots slot state prepared by SlotTable::InitializeState, must outlive the table
+     * @param base addresses are hashed by their offset from base
+     */
+    OrecTable(Orec *orecs, size_t count, State *slots, const void *base);
+
+    /**
+     *
+     * @param orecs requested number of orecs
+     * @return number of orecs a table really uses for the request
+     */
+    static size_t RoundOrecCount(size_t orecs);
+
+    /**
+     * Become the writer of the orec
+     *
+     * @param orec orec to acquire
+     * @param slot slot of writing transaction
+     * @param reading true if the writing transaction already counts as a reader of the orec
+     * @return false if another transaction reads or writes the orec, nothing is held in that case
+     */
+    bool AcquireWrite(Orec &orec, uint32_t slot, bool reading);
+
+    /**
+     * Count the slot as a reader of the orec, stalling on or aborting its writer. Only called for the first address
+     * the slot reads through the orec.
+     *
+     * @param orec orec to acquire
+     * @param slot slot of reading transaction
+     * @return false if the reading transaction was aborted while stalled, nothing is held in that case
+     */
+    bool AcquireRead(Orec &orec, uint32_t slot);
+
+    /**
+     * Stop being the writer of the orec, nothing happens if the slot doesn't write it
+     *
+     * @param orec orec to release
+     * @param slot slot of writing transaction
+     */
+    void ReleaseWrite(Orec &orec, uint32_t slot);
+
+    /**
+     * Stop counting a reader of the orec, called once the last address a slot reads through it is released
+     *
+     * @param orec orec to release
+     */
+    void ReleaseRead(Orec &orec);
+
+    /**
+     *
+     * @param address address to look up
+     * @return orec that address hashes to
+     */
+    Orec &OrecFor(const void *address) {
+        auto key = reinterpret_cast<uintptr_t>(address) - base_;
+        key ^= key >> 17;
+        key *= 0x9E3779B97F4A7C15ull;
+        return orecs_[(key >> 20) & orec_mask_];
+    }
+
+    /**
+     *
+     * @return bytes taken by the orecs
+     */
+    size_t GetBytes() const { return (orec_mask_ + 1) * sizeof(Orec); }
+
+private:
+    static constexpr uint32_t OWNER_SHIFT = 16;
+    static constexpr uint32_t READERS_MASK = (uint32_t{1} << OWNER_SHIFT) - 1;
+
+    std::vector<Orec> owned_orecs_;
+    Orec *orecs_;
+    size_t orec_mask_;
+    uintptr_t base_ = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Hardware cache miss counts of a measured region
+ */
+struct CacheMissCounts {
+    /** false if the kernel refused to open the counters, for example in a container */
+    bool available_ = false;
+    /** last level cache misses */
+    uint64_t cache_misses_ = 0;
+    /** L1 data cache read misses */
+    uint64_t l1d_read_misses_ = 0;
+};
+
+/**
+ * Counts cache misses of the calling thread and every thread it starts while counting, through perf_event_open on
+ * Linux. Unavailable everywhere else.
+ */
+class PerfCounters {
+public:
+    PerfCounters();
+
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    /**
+     * Reset and start counting
+     */
+    void Start();
+
+    /**
+     * Stop counting. Threads started while counting must have exited for their misses to be included.
+     *
+     * @return misses since Start
+     */
+    CacheMissCounts Stop();
+
+private:
+    int cache_misses_fd_;
+    int l1d_read_misses_fd_;
+};
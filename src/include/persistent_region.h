@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Bytes a committing transaction wrote inside a persistent region
+ */
+struct RedoEntry {
+    void *address_;
+    const void *data_;
+    size_t size_;
+};
+
+/**
+ * What recovery found in the log when a region was opened
+ */
+struct RecoveryStats {
+    /** committed transactions whose writes were replayed */
+    size_t committed_ = 0;
+    /** transactions that aborted or never finished and were rolled back */
+    size_t rolled_back_ = 0;
+    /** bytes at the end of the log that were torn by the crash and ignored */
+    size_t torn_bytes_ = 0;
+};
+
+/**
+ * Commit and sync counts of a persistent region
+ */
+struct PersistenceStats {
+    size_t commits_;
+    size_t syncs_;
+};
+
+/**
+ * Memory mapped file whose contents survive crashes when it is only modified through transactions.
+ *
+ * The region is backed by the file at path and a write ahead log at path.log. Lazy versioning appends one redo record
+ * with the final value of every byte a transaction wrote when it commits. Eager versioning appends an undo record
+ * before the first in place write of each address, a redo record when it commits and an abort record when it rolls
+ * back. Records are appended to an in memory buffer and made durable with group commit: the first waiter writes and
+ * fdatasyncs everything appended so far while later waiters queue behind it, so one sync covers every transaction that
+ * committed during the previous one.
+ *
+ * Opening a region replays the log onto the file. Committed transactions are redone and aborted or unfinished ones
+ * are undone, in log order. Log records are keyed by transaction id, so only one transaction manager may use a region
+ * at a time.
+ */
+class PersistentRegion {
+public:
+    static constexpr uint8_t UNDO = 1;
+    static constexpr uint8_t COMMIT = 2;
+    static constexpr uint8_t ABORT = 3;
+
+    /**
+     * Open or create a region and recover it
+     *
+     * @param path file backing the region
+     * @param size size of the region in bytes, the file is grown to it if needed
+     *
+     * @throws std::system_error if the files can't be opened or mapped
+     */
+    PersistentRegion(const std::string &path, size_t size);
+
+    /**
+     * Checkpoint and unmap the region. No transaction may be running.
+     */
+    ~PersistentRegion();
+
+    PersistentRegion(const PersistentRegion &) = delete;
+
+    PersistentRegion &operator=(const PersistentRegion &) = delete;
+
+    /**
+     *
+     * @return first byte of the region
+     */
+    void *GetBase() const { return base_; }
+
+    /**
+     *
+     * @return size of the region in bytes
+     */
+    size_t GetSize() const { return size_; }
+
+    /**
+     *
+     * @param address first byte
+     * @param len number of bytes
+     * @return true if every byte lies in the region
+     */
+    bool Contains(const void *address, size_t len) const {
+        auto start = static_cast<const char *>(address);
+        return start >= base_ && start + len <= base_ + size_;
+    }
+
+    /**
+     * Append an undo record with the bytes at address before a transaction overwrites them
+     *
+     * @param transaction_id transaction about to write
+     * @param address first byte about to be written, inside the region
+     * @param len number of bytes
+     * @return log sequence number to wait for before writing in place
+     */
+    uint64_t AppendUndo(uint64_t transaction_id, void *address, size_t len);
+
+    /**
+     * Append a commit record with the final bytes of every write
+     *
+     * @param transaction_id committing transaction
+     * @param entries writes inside the region
+     * @return log sequence number to wait for before the commit is durable
+     */
+    uint64_t AppendCommit(uint64_t transaction_id, const std::vector<RedoEntry> &entries);
+
+    /**
+     * Append an abort record, must be appended before the transaction releases its addresses
+     *
+     * @param transaction_id aborted transaction
+     */
+    void AppendAbort(uint64_t transaction_id);
+
+    /**
+     * Block until every record up to lsn is durable, syncing the log if nobody else is
+     *
+     * @param lsn log sequence number returned by an append
+     */
+    void WaitDurable(uint64_t lsn);
+
+    /**
+     * Write the region back to its file and empty the log. No transaction may be running.
+     */
+    void Checkpoint();
+
+    /**
+     *
+     * @return what recovery found when the region was opened
+     */
+    const RecoveryStats &GetRecoveryStats() const { return recovery_stats_; }
+
+    /**
+     *
+     * @return commits and log syncs since the region was opened, more commits than syncs means group commit helped
+     */
+    PersistenceStats GetPersistenceStats() const { return {commits_, syncs_}; }
+
+private:
+    struct RecordHeader {
+        uint32_t magic_;
+        uint8_t type_;
+        uint8_t padding_[3];
+        uint64_t transaction_id_;
+        uint64_t payload_size_;
+        uint64_t checksum_;
+    };
+
+    struct EntryHeader {
+        uint64_t offset_;
+        uint64_t size_;
+    };
+
+    static constexpr uint32_t MAGIC = 0x544d4c47;
+
+    /**
+     * Append a record to the log buffer
+     * DO NOT CALL THIS METHOD WITHOUT HOLDING log_mutex_
+     *
+     * @param type record type
+     * @param transaction_id transaction the record belongs to
+     * @param entries byte ranges in the payload
+     * @return log sequence number of the end of the record
+     */
+    uint64_t AppendWithoutLocking(uint8_t type, uint64_t transaction_id, const std::vector<RedoEntry> &entries);
+
+    /**
+     * Replay the log onto the region
+     */
+    void Recover();
+
+    /**
+     * Write all bytes to the log file
+     *
+     * @param data bytes to write
+     * @param len number of bytes
+     * @return false if writing failed, errno says why
+     */
+    bool WriteLog(const char *data, size_t len);
+
+    static uint64_t Checksum(const RecordHeader &header, const char *payload);
+
+    const std::string path_;
+    const size_t size_;
+    int data_fd_;
+    int log_fd_;
+    char *base_;
+
+    std::mutex log_mutex_;
+    std::condition_variable_any durable_cv_;
+    std::vector<char> log_buffer_;
+    uint64_t appended_lsn_ = 0;
+    uint64_t durable_lsn_ = 0;
+    bool syncing_ = false;
+
+    std::atomic<size_t> commits_{0};
+    std::atomic<size_t> syncs_{0};
+    RecoveryStats recovery_stats_;
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+
+#if defined(TM_PROFILING) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/**
+ * Transaction operation whose time the profiler attributes to phases
+ */
+enum class ProfileOperation : uint8_t {
+    LOAD = 0,
+    STORE = 1,
+    COMMIT = 2,
+};
+
+/**
+ * Phase of a transaction operation. Time is charged to the innermost phase only, so the phases of an operation add up
+ * to its total time.
+ */
+enum class ProfilePhase : uint8_t {
+    /** everything the operation does outside the other phases */
+    OTHER = 0,
+    /** acquiring the global read and write set locks or the combiner lock */
+    GLOBAL_LOCK_WAIT = 1,
+    /** acquiring the lock of a single address' TransactionSet */
+    SET_LOCK_WAIT = 2,
+    /** looking for and resolving conflicts with other transactions */
+    CONFLICT_CHECK = 3,
+    /** adding the transaction to or removing it from the read and write sets */
+    SET_UPDATE = 4,
+    /** buffering, logging, writing back or restoring values */
+    VERSION_MANAGER = 5,
+    /** waiting for a writer to finish or a stalled victim to clean up */
+    STALL_WAIT = 6,
+    /** rolling back and releasing an aborted transaction */
+    ABORT_CLEANUP = 7,
+};
+
+static constexpr size_t PROFILE_OPERATIONS = 3;
+static constexpr size_t PROFILE_PHASES = 8;
+
+/**
+ * Calls and time of every operation and phase
+ */
+struct ProfileTotals {
+    std::array<uint64_t, PROFILE_OPERATIONS> calls_{};
+    std::array<std::array<uint64_t, PROFILE_PHASES>, PROFILE_OPERATIONS> ticks_{};
+    /** threads that recorded at least one operation */
+    size_t threads_ = 0;
+};
+
+/**
+ * Optional phase profiler of the transaction hot path, compiled in with the TM_PROFILING CMake option. Each thread
+ * attributes the time stamp counter ticks between its scope boundaries to the innermost phase of the current
+ * operation and keeps its own totals, which are summed when a report is collected. Without TM_PROFILING every scope
+ * is empty and compiles away.
+ */
+class Profiler {
+public:
+#ifdef TM_PROFILING
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    /**
+     *
+     * @return time stamp counter, or nanoseconds where there is none
+     */
+    static uint64_t Now() {
+#if defined(TM_PROFILING) && (defined(__x86_64__) || defined(__i386__))
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /**
+     *
+     * @return unit of Now
+     */
+    static const char *TickUnit();
+
+    /**
+     * Clear the totals of every thread. Profiled threads must be quiescent.
+     */
+    static void Reset();
+
+    /**
+     * Sum the totals of every thread. Profiled threads must be quiescent.
+     *
+     * @return totals since the last reset
+     */
+    static ProfileTotals Collect();
+
+    /**
+     * Print the phase breakdown of every operation since the last reset
+     *
+     * @param out stream to print to
+     * @param configuration name of the configuration that ran
+     */
+    static void Report(std::ostream &out, const std::string &configuration);
+
+    static const char *OperationName(ProfileOperation operation);
+
+    static const char *PhaseName(ProfilePhase phase);
+
+    /**
+     * Start a phase, or an operation if operation is set
+     */
+    static void Enter(ProfilePhase phase, bool start_operation, ProfileOperation operation);
+
+    /**
+     * End the innermost phase or operation
+     */
+    static void Exit();
+};
+
+/**
+ * Attributes the time until it is destroyed to a phase
+ */
+class ProfileScope {
+public:
+#ifdef TM_PROFILING
+    explicit ProfileScope(ProfilePhase phase) { Profiler::Enter(phase, false, ProfileOperation::LOAD); }
+
+    ~ProfileScope() { Profiler::Exit(); }
+#else
+
+    explicit ProfileScope(ProfilePhase) {}
+
+#endif
+
+    ProfileScope(const ProfileScope &) = delete;
+
+    ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+/**
+ * Counts an operation and attributes the time until it is destroyed to its phases
+ */
+class OperationProfileScope {
+public:
+#ifdef TM_PROFILING
+    explicit OperationProfileScope(ProfileOperation operation) {
+        Profiler::Enter(ProfilePhase::OTHER, true, operation);
+    }
+
+    ~OperationProfileScope() { Profiler::Exit(); }
+#else
+
+    explicit OperationProfileScope(ProfileOperation) {}
+
+#endif
+
+    OperationProfileScope(const OperationProfileScope &) = delete;
+
+    OperationProfileScope &operator=(const OperationProfileScope &) = delete;
+};
+
+/**
+ * Lock a mutex exclusively, attributing the time spent waiting for it to a phase
+ *
+ * @param mutex mutex to lock
+ * @param phase phase waiting for the mutex belongs to
+ * @return acquired lock
+ */
+template<typename Mutex>
+std::unique_lock<Mutex> ProfiledUniqueLock(Mutex &mutex, ProfilePhase phase) {
+    ProfileScope scope(phase);
+    return std::unique_lock<Mutex>(mutex);
+}
+
+/**
+ * Lock a mutex shared, attributing the time spent waiting for it to a phase
+ *
+ * @param mutex mutex to lock
+ * @param phase phase waiting for the mutex belongs to
+ * @return acquired lock
+ */
+template<typename Mutex>
+std::shared_lock<Mutex> ProfiledSharedLock(Mutex &mutex, ProfilePhase phase) {
+    ProfileScope scope(phase);
+    return std::shared_lock<Mutex>(mutex);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * xoshiro256** pseudo random number generator. Small, fast and without any shared state, so every thread or bulk
+ * generation task owns one.
+ */
+class Xoshiro256 {
+public:
+    /**
+     * @param seed seed, expanded into the full state with splitmix64
+     * @param stream stream id, generators with the same seed and different streams are independent
+     */
+    explicit Xoshiro256(uint64_t seed = 0, uint64_t stream = 0);
+
+    /**
+     *
+     * @return next 64 random bits
+     */
+    uint64_t Next() {
+        uint64_t result = RotateLeft(state_[1] * 5, 7) * 9;
+        uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = RotateLeft(state_[3], 45);
+        return result;
+    }
+
+    /**
+     *
+     * @param bound exclusive upper bound, must not be 0
+     * @return random integer in [0, bound)
+     */
+    uint64_t Uniform(uint64_t bound) {
+        // Multiply shift range reduction, the bias is negligible for benchmark bounds
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(Next()) * bound) >> 64);
+    }
+
+    /**
+     *
+     * @return random double in [0, 1)
+     */
+    double UniformDouble() { return static_cast<double>(Next() >> 11) * 0x1.0p-53; }
+
+private:
+    static uint64_t RotateLeft(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t state_[4];
+};
+
+/**
+ * Reproducible random numbers for workloads. Every thread draws from its own Xoshiro256, so drawing never takes a lock
+ * or serializes transactions.
+ *
+ * A thread's generator is reseeded from the global seed and a stream id whenever it starts running a workload
+ * function, which makes the values a function draws depend only on the seed and on the order functions were handed
+ * out, not on which thread runs them or how the threads interleave.
+ */
+class Random {
+public:
+    /**
+     * Set the global seed and restart stream ids. Not thread safe, call before starting workloads.
+     *
+     * @param seed global seed
+     */
+    static void Seed(uint64_t seed);
+
+    /**
+     *
+     * @return global seed
+     */
+    static uint64_t GetSeed();
+
+    /**
+     * Reserve consecutive stream ids, ids are handed out in order
+     *
+     * @param count number of ids to reserve
+     * @return first reserved id
+     */
+    static uint64_t ReserveStreams(size_t count = 1);
+
+    /**
+     * Reseed the calling thread's generator from the global seed and a stream id
+     *
+     * @param stream stream id
+     */
+    static void SetStream(uint64_t stream);
+
+    /**
+     *
+     * @return the calling thread's generator
+     */
+    static Xoshiro256 &Generator();
+
+    /**
+     *
+     * @return next 64 random bits of the calling thread's generator
+     */
+    static uint64_t Next() { return Generator().Next(); }
+
+    /**
+     *
+     * @param bound exclusive upper bound, must not be 0
+     * @return random integer in [0, bound) from the calling thread's generator
+     */
+    static uint64_t Uniform(uint64_t bound) { return Generator().Uniform(bound); }
+
+    /**
+     *
+     * @return random double in [0, 1) from the calling thread's generator
+     */
+    static double UniformDouble() { return Generator().UniformDouble(); }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "lazy_version_manager.h"
+#include "persistent_region.h"
+#include "version_manager.h"
+
+/** Buffered writes keyed by their first byte, no two writes in a buffer overlap */
+using RangeWriteBuffer = std::map<uintptr_t, Write>;
+
+/**
+ * Lazy versioning for byte range conflict detection. Writes are buffered as byte ranges so a read sees every byte that
+ * this transaction wrote before it, even when the read only partially overlaps those writes.
+ */
+class RangeLazyVersionManager : public VersionManager {
+
+public:
+    /**
+     * @param region persistent region whose writes are redo logged at commit, nullptr if nothing is persistent
+     * @param transaction_id id of the transaction the writes belong to
+     */
+    explicit RangeLazyVersionManager(PersistentRegion *region = nullptr, uint64_t transaction_id = 0)
+            : region_(region), transaction_id_(transaction_id) {}
+    /**
+     * Store write into write buffer, trimming older buffered writes that it overlaps
+     *
+     * @param address address that the write is going to take place on
+     * @param value value to write
+     * @param len size of value
+     */
+    void Store(void *address, void *value, size_t len) override;
+
+    /**
+     * Get the value at an address, if any buffered write overlaps it. Bytes that no buffered write covers are read
+     * from memory.
+     *
+     * @param address address to get value from
+     * @param dest memory location to write value to
+     * @param len size of value
+     * @return true if value was written to dest, false otherwise
+     */
+    bool GetValue(void *address, void *dest, size_t len) override;
+
+    /**
+     * Aborts transaction
+     */
+    void Abort() override;
+
+    /**
+     * Make the writes to the persistent region durable, write back every buffered write and free all memory related
+     * to transaction
+     */
+    void XEnd() override;
+
+    void BeginNested() override;
+
+    void AbortNested() override;
+
+    void CommitNested() override;
+
+private:
+    /**
+     * Insert a write into a buffer, the parts of older writes that it overlaps are discarded
+     *
+     * @param write_buffer buffer to insert into
+     * @param start first byte of the write
+     * @param write buffered write, owned by the buffer afterwards
+     */
+    static void Insert(RangeWriteBuffer *write_buffer, uintptr_t start, Write write);
+
+    PersistentRegion *region_;
+    const uint64_t transaction_id_;
+
+    /** one segment per nesting level, the outermost transaction's segment is first */
+    std::vector<RangeWriteBuffer> write_buffers_ = std::vector<RangeWriteBuffer>(1);
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "slot_table.h"
+
+/**
+ * Conflict metadata of one stripe of addresses, or of a single TVar. Readers set their slot's bit, the single writer
+ * CASes its slot into the owner word.
+ */
+struct ReaderBitmap {
+    static constexpr size_t MAX_SLOTS = SlotTable::MAX_SLOTS;
+    static constexpr size_t SLOT_WORDS = SlotTable::SLOT_WORDS;
+
+    /** slot + 1 of the writer, 0 if there is none */
+    std::atomic<uint64_t> owner_{0};
+    std::array<std::atomic<uint64_t>, SLOT_WORDS> readers_{};
+    /** number of transactions that committed a write */
+    std::atomic<uint64_t> version_{0};
+};
+
+/**
+ * Lock-free pessimistic conflict detection. Every running transaction owns a slot, addresses hash to stripes of
+ * ReaderBitmaps, so registering a read or write is a single atomic operation and conflict checks are bitmap tests.
+ *
+ * Follows the same policy as the transaction sets: writers lose, readers stall on writers unless the writer is itself
+ * stalled, in which case the writer aborts.
+ */
+class ReaderBitmapTable : public SlotTable {
+public:
+    static constexpr size_t DEFAULT_STRIPES = 1 << 16;
+
+    /**
+     * @param stripes number of stripes addresses hash to, rounded up to a power of two
+     */
+    explicit ReaderBitmapTable(size_t stripes = DEFAULT_STRIPES);
+
+    /**
+     * Become the writer of the stripe
+     *
+     * @param entry metadata to acquire
+     * @param slot slot of writing transaction
+     * @return false if another transaction reads or writes the stripe, nothing is held in that case
+     */
+    bool AcquireWrite(ReaderBitmap &entry, uint32_t slot);
+
+    /**
+     * Become a reader of the stripe, stalling on or aborting its writer
+     *
+     * @param entry metadata to acquire
+     * @param slot slot of reading transaction
+     * @return false if the reading transaction was aborted while stalled, nothing is held in that case
+     */
+    bool AcquireRead(ReaderBitmap &entry, uint32_t slot);
+
+    /**
+     * Stop being the writer of the stripe
+     *
+     * @param entry metadata to release
+     * @param slot slot of writing transaction
+     * @param committed true if the write was committed, bumps the version
+     */
+    void ReleaseWrite(ReaderBitmap &entry, uint32_t slot, bool committed);
+
+    /**
+     * Stop being a reader of the stripe
+     */
+    void ReleaseRead(ReaderBitmap &entry, uint32_t slot);
+
+    /**
+     *
+     * @param address address to look up
+     * @return stripe that address hashes to
+     */
+    ReaderBitmap &StripeFor(const void *address) {
+        auto key = reinterpret_cast<uintptr_t>(address);
+        key ^= key >> 17;
+        key *= 0x9E3779B97F4A7C15ull;
+        return stripes_[(key >> 20) & stripe_mask_].bitmap_;
+    }
+
+    /**
+     *
+     * @return bytes taken by the stripes
+     */
+    size_t GetBytes() const { return stripes_.size() * sizeof(Stripe); }
+
+private:
+    /** Stripes get a cache line each so unrelated addresses don't share one */
+    struct alignas(64) Stripe {
+        ReaderBitmap bitmap_;
+    };
+
+    std::vector<Stripe> stripes_;
+    size_t stripe_mask_;
+};
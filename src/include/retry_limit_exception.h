@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdexcept>
+
+/**
+ * Thrown by Atomically when a transaction aborted as many times as its retry policy allows
+ */
+class RetryLimitException : public std::runtime_error {
+public:
+    explicit RetryLimitException(const char *msg) : std::runtime_error(msg) {}
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "transaction_manager.h"
+#include "virtual_time_scheduler.h"
+
+/**
+ * Parameters of a scalability sweep
+ */
+struct SweepConfig {
+    /** the sweep writes OUTPUT_PREFIX.csv and one OUTPUT_PREFIX-WORKLOAD-METRIC.svg plot per workload and metric */
+    std::string output_prefix_ = "sweep";
+    /** largest thread count, or simulated core count when running in virtual time */
+    size_t max_threads_ = 1;
+    /** runs of every point, for the confidence intervals */
+    size_t repeats_ = 5;
+    /** transactions every thread commits per run */
+    size_t transactions_per_thread_ = 2000;
+    /** sizes of the account pools transactions pick from, smaller pools are more contended */
+    std::vector<size_t> contention_accounts_ = {16, 1024, 65536};
+};
+
+/**
+ * Mean of a metric over the repeats of a point and the half width of its 95% confidence interval
+ */
+struct SweepEstimate {
+    double mean_ = 0;
+    double interval_ = 0;
+};
+
+/**
+ * One point of the sweep, every metric is summarized over the repeats
+ */
+struct SweepPoint {
+    std::string configuration_;
+    std::string workload_;
+    size_t accounts_;
+    size_t threads_;
+    /** committed transactions per second, or per million cycles in virtual time */
+    SweepEstimate throughput_;
+    /** throughput over the single thread throughput of the same configuration, workload and pool */
+    SweepEstimate speedup_;
+    /** speedup over threads */
+    SweepEstimate efficiency_;
+    /** aborts over attempts */
+    SweepEstimate abort_rate_;
+};
+
+/**
+ * Creates a transaction manager for a configuration of the sweep
+ */
+using SweepManagerFactory = std::function<std::unique_ptr<TransactionManager>(bool use_lazy_versioning,
+                                                                              bool use_pessimistic_conflict_detection)>;
+
+/**
+ *
+ * @param max_threads largest thread count
+ * @return every thread count up to 8, then doubling, always ending at max_threads
+ */
+std::vector<size_t> SweepThreadCounts(size_t max_threads);
+
+/**
+ * Mean and 95% confidence interval of samples using the Student t distribution
+ *
+ * @param samples samples of a metric
+ * @return estimate of the metric
+ */
+SweepEstimate EstimateOf(const std::vector<double> &samples);
+
+/**
+ * Run every configuration and workload across thread counts and contention levels, print a summary and write the
+ * speedup, efficiency and abort rate curves as CSV data and SVG plots
+ *
+ * @param config sweep parameters
+ * @param make_manager creates the manager of every configuration
+ * @param scheduler simulated cores to run on, or nullptr to run on host threads
+ * @return every point of the sweep
+ */
+std::vector<SweepPoint> RunScalabilitySweep(const SweepConfig &config, const SweepManagerFactory &make_manager,
+                                            VirtualTimeScheduler *scheduler);
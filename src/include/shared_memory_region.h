@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "orec_table.h"
+#include "slot_table.h"
+
+/**
+ * POSIX shared memory segment that lets transaction managers of several processes run transactions on the same data.
+ *
+ * The segment holds the slot states, which act as the transaction descriptors, the orecs and the data, in that order.
+ * None of them contains a pointer: orecs store slot numbers, slots store transaction ids and addresses are hashed by
+ * their offset from the data, so every process may map the segment at a different address. Transaction ids come
+ * from a counter in the segment, so conflicts between processes are resolved by age like conflicts between threads.
+ *
+ * The first process to open a name creates and initializes the segment, later ones wait until it is ready and
+ * attach. Write buffers, undo logs and memory allocated by transactions stay in the heap of their process, only
+ * the data is shared. A process that dies inside a transaction leaves its slot and orecs held, so the segment has to
+ * be unlinked and recreated after a crash.
+ */
+class SharedMemoryRegion {
+public:
+    /**
+     * Create the segment or attach to the existing one
+     *
+     * @param name name of the segment, starting with a slash
+     * @param data_size bytes of shared data, must match the size the segment was created with
+     * @param orecs number of orecs, rounded up to a power of two, must match the segment
+     *
+     * @throws std::system_error if the segment can't be opened or mapped
+     * @throws InvalidStateException if the existing segment has a different layout
+     */
+    SharedMemoryRegion(const std::string &name, size_t data_size, size_t orecs = OrecTable::DEFAULT_ORECS);
+
+    /**
+     * Unmap the segment, it stays around for the other processes until it is unlinked. No transaction may be running.
+     */
+    ~SharedMemoryRegion();
+
+    SharedMemoryRegion(const SharedMemoryRegion &) = delete;
+
+    SharedMemoryRegion &operator=(const SharedMemoryRegion &) = delete;
+
+    /**
+     * Remove the name of a segment, processes that mapped it keep using it
+     *
+     * @param name name of the segment
+     */
+    static void Unlink(const std::string &name);
+
+    /**
+     *
+     * @return first byte of the shared data, zeroed when the segment was created
+     */
+    void *GetData() const { return data_; }
+
+    /**
+     *
+     * @return bytes of shared data
+     */
+    size_t GetDataSize() const { return header_->data_size_; }
+
+    /**
+     *
+     * @return true if this process created the segment
+     */
+    bool IsCreator() const { return creator_; }
+
+    /**
+     *
+     * @return slot states shared by every process
+     */
+    SlotTable::State *GetSlots() const { return slots_; }
+
+    /**
+     *
+     * @return first orec shared by every process
+     */
+    Orec *GetOrecs() const { return orecs_; }
+
+    /**
+     *
+     * @return number of orecs
+     */
+    size_t GetOrecCount() const { return header_->orec_count_; }
+
+    /**
+     *
+     * @return transaction id unique across every process using the segment
+     */
+    uint64_t NextTransactionId() { return header_->next_transaction_id_++; }
+
+private:
+    struct Header {
+        std::atomic<uint32_t> magic_;
+        uint64_t data_size_;
+        uint64_t orec_count_;
+        std::atomic<uint64_t> next_transaction_id_;
+    };
+
+    static constexpr uint32_t MAGIC = 0x544d5348;
+    static constexpr size_t ALIGNMENT = 64;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Transaction ids have to work across processes");
+
+    /**
+     *
+     * @param size bytes
+     * @return size rounded up to a whole number of cache lines
+     */
+    static size_t Align(size_t size) { return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    /**
+     * Point the members at the parts of the mapped segment
+     *
+     * @param orec_count number of orecs
+     */
+    void Locate(size_t orec_count);
+
+    const std::string name_;
+    int fd_;
+    size_t mapped_size_;
+    char *base_;
+    bool creator_;
+    Header *header_;
+    SlotTable::State *slots_;
+    Orec *orecs_;
+    void *data_;
+};
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <functional>
+#include "conflict_aware_scheduler.h"
+#include "coroutine_scheduler.h"
 #include "transaction_manager.h"
+#include "virtual_time_scheduler.h"
 
 struct TransactionRunDetails {
     TransactionRunDetails(size_t aborts, size_t time_taken) : aborts_(aborts), time_taken_(time_taken) {}
@@ -13,13 +16,16 @@ struct TransactionRunDetails {
 int main(int argc, char *argv[]);
 
 /**
- * Run a transaction until the transaction is successful
+ * Run a transaction until the transaction is successful. Atomically does the same without type erasing the function
+ * and returns its result.
  *
  * @param transaction_manager transaction manager
  * @param func function to run with transaction
+ * @param on_abort called with every aborted attempt before it is retried
  * @return number of aborts
  */
-int RunTransaction(TransactionManager *transaction_manager, const std::function<void(Transaction *)> &func);
+int RunTransaction(TransactionManager *transaction_manager, const std::function<void(Transaction *)> &func,
+                   const std::function<void(const Transaction &)> &on_abort = nullptr);
 
 /**
  * Run a group of transactions asynchronously
@@ -33,6 +39,80 @@ TransactionRunDetails
 RunAsyncTransactions(TransactionManager *transaction_manager, std::vector<std::function<void(Transaction *)>> funcs,
                      size_t iterations = 1);
 
+/**
+ * Run a group of transactions on simulated cores in virtual time. Functions are assigned to cores round robin and
+ * each core runs its functions one after another.
+ *
+ * @param transaction_manager transaction manager
+ * @param scheduler virtual time scheduler to run on
+ * @param funcs functions to run
+ * @param iterations how many times to run each function
+ * @return number of aborts and virtual time taken in cycles
+ */
+TransactionRunDetails
+RunSimulatedTransactions(TransactionManager *transaction_manager, VirtualTimeScheduler *scheduler,
+                         const std::vector<std::function<void(Transaction *)>> &funcs, size_t iterations = 1);
+
+/**
+ * Run a group of transactions on the worker queues of a conflict aware scheduler, on simulated cores when a virtual
+ * time scheduler was requested. Queues are rebuilt every iteration from the footprints learned so far.
+ *
+ * @param transaction_manager transaction manager
+ * @param scheduler scheduler assigning transactions to workers, learns from their aborts
+ * @param funcs functions to run, each is a site of the scheduler
+ * @param iterations how many times to run each function
+ * @return number of aborts and time taken
+ */
+TransactionRunDetails
+RunScheduledTransactions(TransactionManager *transaction_manager, ConflictAwareScheduler *scheduler,
+                         const std::vector<std::function<void(Transaction *)>> &funcs, size_t iterations = 1);
+
+/**
+ * Run a group of transactions as coroutines on a few worker threads, a transaction stalled on a conflict suspends and
+ * its worker runs the others
+ *
+ * @param transaction_manager transaction manager
+ * @param bodies transaction bodies, all in flight at once
+ * @param workers number of worker threads
+ * @param iterations how many times to run each body
+ * @return number of aborts and time taken
+ */
+TransactionRunDetails
+RunCoroutineTransactions(TransactionManager *transaction_manager, const std::vector<CoroutineScheduler::Body> &bodies,
+                         size_t workers, size_t iterations = 1);
+
+/**
+ * Run a workload on host threads, or on simulated cores when a virtual time scheduler was requested
+ *
+ * @param transaction_manager transaction manager
+ * @param funcs functions to run concurrently
+ * @param iterations how many times to run each function
+ * @return number of aborts and time taken
+ */
+TransactionRunDetails RunWorkload(TransactionManager *transaction_manager,
+                                  const std::vector<std::function<void(Transaction *)>> &funcs, size_t iterations);
+
+/**
+ * Print the results of a workload
+ *
+ * @param transaction_manager transaction manager the workload ran on
+ * @param details number of aborts and time taken
+ */
+void PrintRunDetails(TransactionManager *transaction_manager, const TransactionRunDetails &details);
+
+/**
+ * Print the phase profile of everything that ran since the last report and start a new one. Does nothing unless
+ * built with TM_PROFILING.
+ *
+ * @param configuration name of the configuration that ran
+ */
+void ReportProfile(const std::string &configuration);
+
 std::unordered_map<std::string, double> GetTestAccounts(size_t size);
 
-std::vector<double *> GetAccountAddresses(std::unordered_map<std::string, double> map);
\ No newline at end of file
+/**
+ *
+ * @param map accounts, must outlive the returned addresses
+ * @return address of every balance in map
+ */
+std::vector<double *> GetAccountAddresses(std::unordered_map<std::string, double> &map);
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/**
+ * Slots of the running transactions of the lock-free conflict metadata. Every running transaction owns a slot whose
+ * state word holds its id and state, so metadata entries only need to store slot numbers. Remote transactions only
+ * ever touch a slot's state word, the owner of the slot notices it was aborted while it is stalled.
+ *
+ * The state words hold no pointers, so they can live in memory shared between processes.
+ */
+class SlotTable {
+public:
+    static constexpr size_t MAX_SLOTS = 256;
+    static constexpr size_t SLOT_WORDS = MAX_SLOTS / 64;
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    /**
+     * Slot state words and free slot bits
+     */
+    struct State {
+        std::array<std::atomic<uint64_t>, MAX_SLOTS> slot_states_;
+        std::array<std::atomic<uint64_t>, SLOT_WORDS> free_slots_;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Slot states have to work across processes");
+
+    /**
+     * Slots with their own state
+     */
+    SlotTable();
+
+    /**
+     * Slots whose state lives elsewhere, like in shared memory
+     *
+     * @param state state prepared by InitializeState, must outlive the table
+     */
+    explicit SlotTable(State *state);
+
+    /**
+     * Mark every slot free
+     *
+     * @param state state to initialize
+     */
+    static void InitializeState(State *state);
+
+    /**
+     * Take a free slot, waiting for one if all are in use
+     *
+     * @param transaction_id id of transaction taking the slot
+     * @return slot
+     */
+    uint32_t AcquireSlot(uint64_t transaction_id);
+
+    /**
+     * Give a slot back, the transaction must have released all of its metadata
+     *
+     * @param slot slot to give back
+     */
+    void ReleaseSlot(uint32_t slot);
+
+    /**
+     * Mark the slot's transaction as committing so it can no longer be aborted by other transactions
+     *
+     * @param slot slot of committing transaction
+     * @return false if the transaction was aborted, true otherwise
+     */
+    bool MarkCommitting(uint32_t slot);
+
+protected:
+    /**
+     * Same greedy algorithm as TransactionManager::HandlePessimisticReadConflicts for a reader that found a writer:
+     * abort the writer if it is stalled, otherwise stall until it stops writing
+     *
+     * @param slot slot of reading transaction
+     * @param writer_slot slot of writing transaction
+     * @param still_writing true while the writer still owns the metadata
+     * @return true if the reader should look at the metadata again, false if it was aborted while stalled
+     */
+    bool WaitForWriter(uint32_t slot, uint32_t writer_slot, const std::function<bool()> &still_writing);
+
+private:
+    /** Slot states share the Transaction state constants, the transaction id sits above the two state bits */
+    static constexpr uint64_t STATE_MASK = 3;
+
+    std::unique_ptr<State> owned_state_;
+    State *state_;
+};
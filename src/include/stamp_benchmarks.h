@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+
+#include "transaction_manager.h"
+
+/** Default percentage of intset operations that insert or remove instead of looking up */
+static constexpr size_t DEFAULT_INTSET_UPDATE_RATE = 20;
+
+/**
+ * Integer set as a sorted linked list, long transactions that conflict on every update before them in the list. Runs
+ * again with elastic searches that only conflict with updates next to the nodes they return.
+ *
+ * @param transaction_manager transaction manager
+ * @param update_rate percentage of operations that insert or remove
+ */
+void IntSetListWorkload(TransactionManager *transaction_manager, size_t update_rate);
+
+/**
+ * Integer set as a red-black tree, short transactions whose rebalancing conflicts near the root
+ *
+ * @param transaction_manager transaction manager
+ * @param update_rate percentage of operations that insert or remove
+ */
+void IntSetRbTreeWorkload(TransactionManager *transaction_manager, size_t update_rate);
+
+/**
+ * Integer set as a hash set, short transactions that rarely conflict
+ *
+ * @param transaction_manager transaction manager
+ * @param update_rate percentage of operations that insert or remove
+ */
+void IntSetHashWorkload(TransactionManager *transaction_manager, size_t update_rate);
+
+/**
+ * Travel reservation system modeled after STAMP vacation. Clients reserve the most expensive of several queried cars,
+ * flights and rooms, delete customers and add or remove inventory.
+ *
+ * @param transaction_manager transaction manager
+ */
+void VacationWorkload(TransactionManager *transaction_manager);
+
+/**
+ * K-means clustering modeled after STAMP kmeans. Every transaction adds one point to the accumulator of its nearest
+ * center, so contention grows as the number of clusters shrinks.
+ *
+ * @param transaction_manager transaction manager
+ */
+void KMeansWorkload(TransactionManager *transaction_manager);
+
+/**
+ * Bank with short transfers between random accounts and long read only audits of every account
+ *
+ * @param transaction_manager transaction manager
+ */
+void BankWorkload(TransactionManager *transaction_manager);
+
+/**
+ * Run every application workload
+ *
+ * @param transaction_manager transaction manager
+ * @param update_rate percentage of intset operations that insert or remove
+ */
+void StampWorkloads(TransactionManager *transaction_manager, size_t update_rate);
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#include "transaction.h"
+#include "transactional_allocator.h"
+
+/**
+ * Transactional hash map with a fixed number of buckets, each a singly linked list of nodes.
+ *
+ * Every operation reads the head of its bucket and inserts write it, so operations on different buckets never
+ * conflict. Keys are written once before a node is published and are read without going through the transaction,
+ * only bucket heads, next pointers and values are transactional. Nodes come from Transaction::Alloc and erased nodes
+ * are reclaimed once no running transaction can reach them.
+ *
+ * @tparam K key type
+ * @tparam V value type
+ * @tparam Hash hash function for keys
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+class TMap {
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                  "Transactional memory copies keys and values byte by byte");
+
+public:
+    static constexpr size_t DEFAULT_BUCKETS = 1024;
+
+    /**
+     * @param buckets number of buckets, the map never resizes
+     */
+    explicit TMap(size_t buckets = DEFAULT_BUCKETS) : buckets_(buckets, nullptr) {}
+
+    /**
+     * Free every node, no transaction may be using the map
+     */
+    ~TMap() {
+        for (auto *node : buckets_) {
+            while (node != nullptr) {
+                auto *next = node->next_;
+                TransactionalAllocator::Deallocate(node);
+                node = next;
+            }
+        }
+    }
+
+    TMap(const TMap &) = delete;
+
+    TMap &operator=(const TMap &) = delete;
+
+    /**
+     * Look up a key
+     *
+     * @param transaction transaction performing the lookup
+     * @param key key to look up
+     * @param value set to the key's value if it's present
+     * @return true if the key is present, false otherwise
+     *
+     * @throws TransactionAbortException
+     */
+    bool Get(Transaction *transaction, const K &key, V *value) {
+        Node *node = Find(transaction, key, nullptr);
+        if (node == nullptr) {
+            return false;
+        }
+        *value = transaction->Load(&node->value_);
+        return true;
+    }
+
+    /**
+     * Insert a key or overwrite its value
+     *
+     * @param transaction transaction performing the insert
+     * @param key key to insert
+     * @param value value to associate with key
+     * @return true if the key was inserted, false if an existing value was overwritten
+     *
+     * @throws TransactionAbortException
+     */
+    bool Put(Transaction *transaction, const K &key, const V &value) {
+        auto &head = BucketFor(key);
+        Node *first = transaction->Load(&head);
+        for (Node *node = first; node != nullptr; node = transaction->Load(&node->next_)) {
+            if (node->key_ == key) {
+                transaction->Store(&node->value_, value);
+                return false;
+            }
+        }
+
+        // Nobody can see the node before the head is written, so it's initialized directly
+        auto *node = static_cast<Node *>(transaction->Alloc(sizeof(Node)));
+        node->key_ = key;
+        node->value_ = value;
+        node->next_ = first;
+        transaction->Store(&head, node);
+        return true;
+    }
+
+    /**
+     * Remove a key
+     *
+     * @param transaction transaction performing the erase
+     * @param key key to remove
+     * @return true if the key was removed, false if it wasn't present
+     *
+     * @throws TransactionAbortException
+     */
+    bool Erase(Transaction *transaction, const K &key) {
+        Node **link = nullptr;
+        Node *node = Find(transaction, key, &link);
+        if (node == nullptr) {
+            return false;
+        }
+        transaction->Store(link, transaction->Load(&node->next_));
+        transaction->Free(node);
+        return true;
+    }
+
+    /**
+     *
+     * @param transaction transaction performing the lookup
+     * @param key key to look up
+     * @return true if the key is present, false otherwise
+     *
+     * @throws TransactionAbortException
+     */
+    bool Contains(Transaction *transaction, const K &key) {
+        return Find(transaction, key, nullptr) != nullptr;
+    }
+
+private:
+    struct Node {
+        K key_;
+        V value_;
+        Node *next_;
+    };
+
+    std::vector<Node *> buckets_;
+
+    Node *&BucketFor(const K &key) {
+        return buckets_[Hash{}(key) % buckets_.size()];
+    }
+
+    /**
+     * @param transaction transaction performing the lookup
+     * @param key key to look up
+     * @param link if not nullptr, set to the pointer that references the returned node
+     * @return node holding key, nullptr if there is none
+     */
+    Node *Find(Transaction *transaction, const K &key, Node ***link) {
+        Node **current = &BucketFor(key);
+        Node *node = transaction->Load(current);
+        while (node != nullptr && !(node->key_ == key)) {
+            current = &node->next_;
+            node = transaction->Load(current);
+        }
+        if (link != nullptr) {
+            *link = current;
+        }
+        return node;
+    }
+};
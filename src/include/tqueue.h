@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "transaction.h"
+
+/**
+ * Transactional bounded FIFO queue backed by a ring of slots.
+ *
+ * Every slot carries a flag saying whether it holds an element, so producers only read the tail and consumers only
+ * read the head. Producers and consumers only conflict on a slot when the queue is empty or full.
+ *
+ * @tparam T element type
+ */
+template<typename T>
+class TQueue {
+    static_assert(std::is_trivially_copyable<T>::value, "Transactional memory copies elements byte by byte");
+
+public:
+    /**
+     * @param capacity maximum number of elements in the queue
+     */
+    explicit TQueue(size_t capacity) : slots_(capacity) {}
+
+    TQueue(const TQueue &) = delete;
+
+    TQueue &operator=(const TQueue &) = delete;
+
+    /**
+     * Append an element to the back of the queue
+     *
+     * @param transaction transaction performing the enqueue
+     * @param value element to append
+     * @return false if the queue is full, true otherwise
+     *
+     * @throws TransactionAbortException
+     */
+    bool Enqueue(Transaction *transaction, const T &value) {
+        uint64_t tail = transaction->Load(&tail_);
+        auto &slot = slots_[tail % slots_.size()];
+        if (transaction->Load(&slot.full_)) {
+            return false;
+        }
+        transaction->Store(&slot.value_, value);
+        transaction->Store(&slot.full_, true);
+        transaction->Store(&tail_, tail + 1);
+        return true;
+    }
+
+    /**
+     * Remove the element at the front of the queue
+     *
+     * @param transaction transaction performing the dequeue
+     * @param value set to the removed element
+     * @return false if the queue is empty, true otherwise
+     *
+     * @throws TransactionAbortException
+     */
+    bool Dequeue(Transaction *transaction, T *value) {
+        uint64_t head = transaction->Load(&head_);
+        auto &slot = slots_[head % slots_.size()];
+        if (!transaction->Load(&slot.full_)) {
+            return false;
+        }
+        *value = transaction->Load(&slot.value_);
+        transaction->Store(&slot.full_, false);
+        transaction->Store(&head_, head + 1);
+        return true;
+    }
+
+    /**
+     *
+     * @param transaction transaction reading the size
+     * @return number of elements, conflicts with every producer and consumer
+     *
+     * @throws TransactionAbortException
+     */
+    size_t Size(Transaction *transaction) {
+        return transaction->Load(&tail_) - transaction->Load(&head_);
+    }
+
+    /**
+     *
+     * @return maximum number of elements in the queue
+     */
+    size_t Capacity() const { return slots_.size(); }
+
+private:
+    struct Slot {
+        T value_;
+        bool full_ = false;
+    };
+
+    /** Kept on separate cache lines so producers and consumers don't share one */
+    alignas(64) uint64_t head_ = 0;
+    alignas(64) uint64_t tail_ = 0;
+    std::vector<Slot> slots_;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+enum class TraceEventType : uint8_t {
+    BEGIN = 0,
+    LOAD = 1,
+    STORE = 2,
+    STALL_BEGIN = 3,
+    STALL_END = 4,
+    ABORT = 5,
+    COMMIT = 6,
+    KILL = 7,
+};
+
+/**
+ * Fixed size event as stored in the ring buffers and in the binary trace file
+ */
+struct TraceEvent {
+    uint64_t timestamp_;
+    uint64_t transaction_id_;
+    /** address for loads and stores, id of the other transaction for stalls and kills */
+    uint64_t arg_;
+    uint32_t lane_;
+    TraceEventType type_;
+};
+
+/**
+ * Optional event tracer. Each thread appends to its own lock-free ring buffer (a "lane"), lanes are recycled when
+ * threads exit so the number of buffers is bounded by the number of concurrently running threads. When tracing is
+ * disabled, recording an event costs a single relaxed load.
+ */
+class Tracer {
+public:
+    static constexpr size_t DEFAULT_LANE_CAPACITY = 4096;
+
+    /**
+     * Start recording events
+     *
+     * @param lane_capacity number of events kept per lane, older events are overwritten
+     */
+    static void Enable(size_t lane_capacity = DEFAULT_LANE_CAPACITY);
+
+    /**
+     * Stop recording events
+     */
+    static void Disable();
+
+    /**
+     *
+     * @return true if events are being recorded, false otherwise
+     */
+    static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * Record an event for the calling thread
+     *
+     * @param type type of event
+     * @param transaction_id id of transaction generating the event
+     * @param arg event specific argument
+     */
+    static void Record(TraceEventType type, uint64_t transaction_id, uint64_t arg = 0) {
+        if (IsEnabled()) {
+            RecordSlow(type, transaction_id, arg);
+        }
+    }
+
+    /**
+     * Write all recorded events to a compact binary file. Must be called once traced threads are quiescent.
+     *
+     * @param path file to write events to
+     * @return number of events written
+     */
+    static size_t DumpBinary(const std::string &path);
+
+    /**
+     * Convert a binary trace file into Chrome/Perfetto trace event JSON
+     *
+     * @param binary_path file written by DumpBinary
+     * @param json_path file to write JSON to
+     *
+     * @throws std::runtime_error if the binary file can't be read
+     */
+    static void ConvertToChromeJson(const std::string &binary_path, const std::string &json_path);
+
+private:
+    static inline std::atomic<bool> enabled_{false};
+
+    static void RecordSlow(TraceEventType type, uint64_t transaction_id, uint64_t arg);
+};
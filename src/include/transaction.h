@@ -1,14 +1,30 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include "eager_version_manager.h"
+#include "htm_cache_model.h"
 #include "lazy_version_manager.h"
+#include "nested_abort_exception.h"
+#include "profiler.h"
 #include "transaction_manager.h"
+#include "tracer.h"
+#include "tvar.h"
+#include "virtual_time_scheduler.h"
 
 
 class TransactionManager;
 
+template<typename T>
+class LoadAwaiter;
+
 
 class Transaction {
 
@@ -18,7 +34,20 @@ public:
     static constexpr int ABORTED = 2;
     static constexpr int STALLED = 3;
 
-    explicit Transaction(uint64_t transaction_id, TransactionManager *transaction_manager, bool use_lazy_versioning);
+    /** Times a closed nested transaction is retried before the whole transaction aborts */
+    static constexpr size_t MAX_NESTED_RETRIES = 8;
+
+    /**
+     * @param transaction_id id of transaction
+     * @param transaction_manager manager that created the transaction
+     * @param use_lazy_versioning true for lazy versioning, false for eager versioning
+     * @param htm_config cache geometry to emulate a best effort hardware transaction with, nullptr for software
+     * @param slot reader bitmap slot owned by the transaction
+     */
+    explicit Transaction(uint64_t transaction_id, TransactionManager *transaction_manager, bool use_lazy_versioning,
+                         const HtmConfig *htm_config = nullptr, uint32_t slot = SlotTable::NO_SLOT);
+
+    ~Transaction();
 
     /**
      * Store value at address for transaction
@@ -31,12 +60,22 @@ public:
      */
     template<typename T>
     void Store(T *address, T value) {
-        if (state_ == ABORTED) {
-            transaction_manager_->Abort(this);
-        }
-        transaction_manager_->Store(address, this);
-        write_set_.emplace(address);
-        version_manager_->Store(address, &value, sizeof(T));
+        StoreWithMetadata(address, value, nullptr);
+    }
+
+    /**
+     * Store value in a transactional variable, using its embedded conflict metadata when the manager supports it
+     *
+     * @tparam T type of value
+     * @param tvar variable to Store value in
+     * @param value value to Store
+     *
+     * @throws TransactionAbortException
+     */
+    template<typename T>
+    void Store(TVar<T> *tvar, T value) {
+        StoreWithMetadata(tvar->GetAddress(), value,
+                          transaction_manager_->UsesReaderBitmaps() ? tvar->GetMetadata() : nullptr);
     }
 
     /**
@@ -51,19 +90,143 @@ public:
      */
     template<typename T>
     T Load(T *address) {
-        if (state_ == ABORTED) {
-            transaction_manager_->Abort(this);
-        }
-        transaction_manager_->Load(address, this);
-        read_set_.emplace(address);
-        T res;
-        // Check if write is in write buffer
-        if (version_manager_->GetValue(address, &res)) {
-            return res;
-        }
-        return *address;
+        return LoadWithMetadata(address, nullptr);
+    }
+
+    /**
+     * Loads value from a transactional variable, using its embedded conflict metadata when the manager supports it
+     *
+     * @tparam T type of value
+     * @param tvar variable to load from
+     *
+     * @return value stored in tvar
+     *
+     * @throws TransactionAbortException
+     */
+    template<typename T>
+    T Load(TVar<T> *tvar) {
+        return LoadWithMetadata(tvar->GetAddress(),
+                                transaction_manager_->UsesReaderBitmaps() ? tvar->GetMetadata() : nullptr);
+    }
+
+    /**
+     * Add delta to the value at address when the transaction commits. Concurrent Adds to the same address don't
+     * conflict, loads, stores and other kinds of updates by other transactions do. A Load of the address by this
+     * transaction sees the pending delta, a Store replaces it.
+     *
+     * @tparam T arithmetic type of value
+     * @param address location to add to
+     * @param delta value to add
+     *
+     * @throws TransactionAbortException
+     */
+    template<typename T>
+    void Add(T *address, T delta) {
+        UpdateWithOp(address, CommutativeOp::ADD, delta);
+    }
+
+    /**
+     * Lower the value at address to value when the transaction commits, see Add
+     *
+     * @tparam T arithmetic type of value
+     * @param address location to lower
+     * @param value upper bound of the value at address
+     *
+     * @throws TransactionAbortException
+     */
+    template<typename T>
+    void Min(T *address, T value) {
+        UpdateWithOp(address, CommutativeOp::MIN, value);
+    }
+
+    /**
+     * Raise the value at address to value when the transaction commits, see Add
+     *
+     * @tparam T arithmetic type of value
+     * @param address location to raise
+     * @param value lower bound of the value at address
+     *
+     * @throws TransactionAbortException
+     */
+    template<typename T>
+    void Max(T *address, T value) {
+        UpdateWithOp(address, CommutativeOp::MAX, value);
+    }
+
+    /**
+     * Set bits of the value at address when the transaction commits, see Add
+     *
+     * @tparam T integral type of value
+     * @param address location to set bits in
+     * @param bits bits to set
+     *
+     * @throws TransactionAbortException
+     */
+    template<typename T>
+    void Or(T *address, T bits) {
+        static_assert(std::is_integral_v<T>, "Or needs an integral type");
+        UpdateWithOp(address, CommutativeOp::OR, bits);
+    }
+
+    /**
+     * Drop an address from the read set before commit, so writers no longer conflict with the earlier read. Only safe
+     * when the rest of the transaction doesn't depend on the value staying the same, like the nodes a search walked
+     * past. Addresses the transaction wrote stay tracked, and AbortNested doesn't bring a released read back.
+     *
+     * @tparam T type of value
+     * @param address location that was read
+     */
+    template<typename T>
+    void Release(T *address) {
+        ReleaseRange(address, sizeof(T));
     }
 
+    /**
+     * Drop a transactional variable from the read set before commit, see Release
+     *
+     * @tparam T type of value
+     * @param tvar variable that was read
+     */
+    template<typename T>
+    void Release(TVar<T> *tvar) {
+        ReleaseRange(tvar->GetAddress(), sizeof(T));
+    }
+
+    /**
+     * Start an elastic section that keeps only the window most recent new reads in the read set and releases older
+     * ones as the transaction moves on. Hand over hand traversals of linked structures stay correct with a window
+     * of 2 and no longer conflict with writers behind them.
+     *
+     * @param window reads kept, at least 1
+     */
+    void BeginElastic(size_t window);
+
+    /**
+     * End the elastic section, reads still in the window stay in the read set until commit
+     */
+    void EndElastic();
+
+    /**
+     *
+     * @return true inside an elastic section, false otherwise
+     */
+    bool IsElastic() const { return elastic_window_ > 0; }
+
+    /**
+     * Allocate memory that is discarded if the transaction aborts
+     *
+     * @param size bytes to allocate
+     * @return uninitialized block aligned to 16 bytes
+     */
+    void *Alloc(size_t size);
+
+    /**
+     * Free memory once the transaction commits and no concurrent transaction can still reference it
+     *
+     * @param block block returned by Alloc
+     */
+    void Free(void *block);
+
     /**
      * Abort transaction
      *
@@ -72,7 +235,13 @@ public:
     void Abort();
 
     /**
-    * Commit memory transaction
+     * Begin a closed nested transaction inside this transaction. Its writes and newly accessed addresses are tracked
+     * separately until the matching XEnd merges them into the parent, or AbortNested rolls back only them.
+     */
+    void XBegin();
+
+    /**
+    * Commit memory transaction. If a nested transaction is active it is merged into its parent instead.
     *
     * @param transaction_id id of transaction to commit
     *
@@ -80,12 +249,57 @@ public:
     */
     void XEnd();
 
+    /**
+     * Roll back the innermost nested transaction, leaving its parent running
+     */
+    void AbortNested();
+
+    /**
+     * Run func as a closed nested transaction. Conflicts that only need the nested transaction rolled back retry
+     * func, after MAX_NESTED_RETRIES attempts the whole transaction aborts.
+     *
+     * @tparam Func callable taking a Transaction *
+     * @param func body of the nested transaction
+     *
+     * @throws TransactionAbortException
+     */
+    template<typename Func>
+    void RunNested(Func func) {
+        for (size_t attempt = 1;; attempt++) {
+            XBegin();
+            try {
+                func(this);
+                XEnd();
+                return;
+            } catch (const NestedAbortException &e) {
+                AbortNested();
+                VirtualTimeScheduler::Charge(SimulatedOperation::ABORT);
+                if (attempt == MAX_NESTED_RETRIES) {
+                    transaction_manager_->Abort(this);
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     *
+     * @return true if a nested transaction is active, false otherwise
+     */
+    bool IsNested() const { return !nested_scopes_.empty(); }
+
     /**
      *
      * @return Transaction Id of transaction
      */
     uint64_t GetTransactionId() const;
 
+    /**
+     *
+     * @return Reader bitmap slot owned by the transaction
+     */
+    uint32_t GetSlot() const { return slot_; }
+
     /**
      * Mark that this transaction has been aborted
      *
@@ -99,15 +313,17 @@ public:
      * @param exclusive_write_lock exclusive lock on write sets
      * @return current state
      */
-    bool MarkStalledTransactionAborted(std::unique_lock<std::shared_mutex> *exclusive_write_lock,
-                                       std::condition_variable_any *read_stall_cv);
+    bool MarkStalledTransactionAborted(std::unique_lock<std::shared_mutex> *exclusive_write_lock);
 
     /**
      * Mark that this transaction is stalled
      *
+     * @param stall_queue queue the transaction waits on, woken if the transaction is aborted while stalled
+     * @param suspended true if the transaction suspends instead of waiting on the queue, so transactions aborting it
+     * must not wait for it to clean up
      * @return true if the transaction was successfully stalled false otherwise
      */
-    bool MarkStalled();
+    bool MarkStalled(std::condition_variable_any *stall_queue, bool suspended = false);
 
     /**
     * Mark that this transaction is unstalled
@@ -116,11 +332,61 @@ public:
     */
     bool MarkUnstalled();
 
+    /**
+     * @param generation generation of the stall queue when a suspended transaction stalled on it
+     */
+    void SetStallGeneration(uint64_t generation) { stall_generation_ = generation; }
+
+    /**
+     *
+     * @return generation of the stall queue when the transaction was suspended
+     */
+    uint64_t GetStallGeneration() const { return stall_generation_; }
+
+    /**
+     *
+     * @return queue the transaction stalled on last
+     */
+    const std::condition_variable_any *GetStallQueue() const { return stall_queue_; }
+
+    /**
+     * Continue a transaction suspended by TransactionManager::TryLoad
+     *
+     * @throws TransactionAbortException if it was aborted while suspended
+     */
+    void ResumeAfterStall();
+
+    /**
+     * Load a value inside a coroutine, suspending the coroutine instead of blocking the thread if the load has to
+     * stall. Defined in coroutine_scheduler.h.
+     *
+     * @tparam T type of value
+     * @param address location that value is stored
+     * @return awaitable producing the value stored at address
+     */
+    template<typename T>
+    LoadAwaiter<T> AsyncLoad(T *address);
+
+    /**
+     * Load a value unless the load would stall
+     *
+     * @tparam T type of value
+     * @param address location that value is stored
+     * @param value set to the value stored at address
+     * @return true if loaded, false if the transaction was suspended instead
+     *
+     * @throws TransactionAbortException
+     */
+    template<typename T>
+    bool TryLoad(T *address, T *value) {
+        return LoadOrSuspend(address, nullptr, true, value);
+    }
+
     /**
      *
      * @return true if aborted, false otherwise
      */
-    bool IsAborted() { return state_ == ABORTED; }
+    bool IsAborted() const { return state_ == ABORTED; }
 
     /**
      *
@@ -128,6 +394,12 @@ public:
      */
     bool IsStalled() { return state_ == STALLED; }
 
+    /**
+     *
+     * @return true if this is an emulated best effort hardware transaction, false otherwise
+     */
+    bool IsHardware() const { return htm_cache_ != nullptr; }
+
     /**
      *
      * @return Write set of transaction
@@ -140,10 +412,244 @@ public:
      */
     const std::unordered_set<void *> &GetReadSet() const { return read_set_; }
 
+    /**
+     *
+     * @return address of the most recent load or store, the one that aborted the transaction if an access did
+     */
+    void *GetLastAccess() const { return last_access_; }
+
+    /**
+     *
+     * @param address address in the read or write set
+     * @return conflict metadata embedded next to address by a TVar, nullptr if the address has none
+     */
+    ReaderBitmap *GetEmbeddedMetadata(void *address) const {
+        auto metadata = embedded_metadata_.find(address);
+        return metadata == embedded_metadata_.end() ? nullptr : metadata->second;
+    }
+
+    /**
+     * Count an address the transaction reads through an orec
+     *
+     * @param orec orec the address hashes to
+     * @return true if it's the first address the transaction reads through orec
+     */
+    bool AddOrecRead(Orec *orec) { return orec_reads_[orec]++ == 0; }
+
+    /**
+     * Stop counting an address the transaction reads through an orec
+     *
+     * @param orec orec the address hashes to
+     * @return true if it was the last address the transaction read through orec
+     */
+    bool RemoveOrecRead(Orec *orec);
+
+    /**
+     *
+     * @param orec orec to look up
+     * @return true if the transaction reads an address through orec
+     */
+    bool ReadsOrec(Orec *orec) const { return orec_reads_.count(orec) > 0; }
+
+    /**
+     *
+     * @return orecs the transaction reads through and the number of addresses it reads through each
+     */
+    std::unordered_map<Orec *, size_t> &GetOrecReads() { return orec_reads_; }
+
 private:
+    /**
+     * Register a store with the manager and add it to the write set. With byte ranges enabled every granule the
+     * range touches is registered instead of the start address.
+     *
+     * @param address first byte written
+     * @param len bytes written
+     * @param metadata conflict metadata embedded next to address, nullptr to use the address' stripe
+     */
+    void TrackStore(void *address, size_t len, ReaderBitmap *metadata);
+
+    /**
+     * Register a load with the manager and add it to the read set. With byte ranges enabled every granule the range
+     * touches is registered instead of the start address.
+     *
+     * @param address first byte read
+     * @param len bytes read
+     * @param metadata conflict metadata embedded next to address, nullptr to use the address' stripe
+     * @param may_suspend suspend instead of stalling on a writer
+     * @return false if the transaction was suspended
+     */
+    bool TrackLoad(void *address, size_t len, ReaderBitmap *metadata, bool may_suspend = false);
+
+    /**
+     * Release every unit of a range the same way TrackLoad registered them
+     *
+     * @param address first byte read
+     * @param len bytes read
+     */
+    void ReleaseRange(void *address, size_t len);
+
+    void ReleaseUnit(void *address);
+
+    void TrackStoreUnit(void *address, ReaderBitmap *metadata);
+
+    /**
+     * Register a commutative update with the manager and add it to the write set, granule by granule like TrackStore
+     *
+     * @param address first byte updated
+     * @param len bytes updated
+     * @param op kind of update
+     */
+    void TrackUpdate(void *address, size_t len, CommutativeOp op);
+
+    void TrackUpdateUnit(void *address, CommutativeOp op);
+
+    /**
+     * Combine the updates still pending on address into a value read from it
+     *
+     * @param address address read
+     * @param value value read, updated in place
+     */
+    void ApplyPendingUpdates(void *address, void *value) const;
+
+    /**
+     * Drop the updates pending on address because the transaction stored to it
+     *
+     * @param address address stored to
+     */
+    void CancelPendingUpdates(void *address);
+
+    /**
+     * Apply every update that wasn't cancelled to memory, called while committing
+     */
+    void ApplyUpdates();
+
+    /**
+     * Commutative update deferred to commit, or a cancellation of the earlier updates to its address if op_ is NONE
+     */
+    struct CommutativeUpdate {
+        void *address_;
+        CommutativeOp op_;
+        alignas(8) std::array<unsigned char, 8> operand_;
+        /** combine the operand into value, atomically if value is shared memory */
+        void (*apply_)(const CommutativeUpdate &update, void *value, bool atomically);
+    };
+
+    template<typename T>
+    static T Combine(CommutativeOp op, T value, T operand) {
+        switch (op) {
+            case CommutativeOp::ADD:
+                return value + operand;
+            case CommutativeOp::MIN:
+                return operand < value ? operand : value;
+            case CommutativeOp::MAX:
+                return value < operand ? operand : value;
+            case CommutativeOp::OR:
+                if constexpr (std::is_integral_v<T>) {
+                    return value | operand;
+                } else {
+                    return value;
+                }
+            default:
+                return value;
+        }
+    }
+
+    template<typename T>
+    static void ApplyUpdate(const CommutativeUpdate &update, void *value, bool atomically) {
+        T operand;
+        std::memcpy(&operand, update.operand_.data(), sizeof(T));
+        auto *typed_value = static_cast<T *>(value);
+        if (!atomically) {
+            *typed_value = Combine(update.op_, *typed_value, operand);
+            return;
+        }
+        // Other transactions may apply updates to the same address concurrently
+        std::atomic_ref<T> shared_value(*typed_value);
+        T current = shared_value.load();
+        while (!shared_value.compare_exchange_weak(current, Combine(update.op_, current, operand))) {}
+    }
+
+    template<typename T>
+    void UpdateWithOp(T *address, CommutativeOp op, T operand) {
+        static_assert(std::is_arithmetic_v<T> && sizeof(T) <= sizeof(CommutativeUpdate::operand_),
+                      "Commutative updates need an arithmetic type of at most 8 bytes");
+        if (!transaction_manager_->SupportsCommutativeUpdates()) {
+            StoreWithMetadata(address, Combine(op, LoadWithMetadata(address, nullptr), operand), nullptr);
+            return;
+        }
+        OperationProfileScope operation_scope(ProfileOperation::STORE);
+        if (state_ == ABORTED) {
+            transaction_manager_->Abort(this);
+        }
+        VirtualTimeScheduler::Charge(SimulatedOperation::STORE);
+        Tracer::Record(TraceEventType::STORE, transaction_id_, reinterpret_cast<uintptr_t>(address));
+        if (htm_cache_ != nullptr && !htm_cache_->Access(address, sizeof(T))) {
+            transaction_manager_->CapacityAbort(this);
+        }
+        TrackUpdate(address, sizeof(T), op);
+        CommutativeUpdate update{address, op, {}, &ApplyUpdate<T>};
+        std::memcpy(update.operand_.data(), &operand, sizeof(T));
+        updates_.push_back(update);
+    }
+
+    bool TrackLoadUnit(void *address, ReaderBitmap *metadata, bool may_suspend);
+
+    template<typename T>
+    void StoreWithMetadata(T *address, T value, ReaderBitmap *metadata) {
+        OperationProfileScope operation_scope(ProfileOperation::STORE);
+        if (state_ == ABORTED) {
+            transaction_manager_->Abort(this);
+        }
+        VirtualTimeScheduler::Charge(SimulatedOperation::STORE);
+        Tracer::Record(TraceEventType::STORE, transaction_id_, reinterpret_cast<uintptr_t>(address));
+        if (htm_cache_ != nullptr && !htm_cache_->Access(address, sizeof(T))) {
+            transaction_manager_->CapacityAbort(this);
+        }
+        TrackStore(address, sizeof(T), metadata);
+        if (!updates_.empty()) {
+            CancelPendingUpdates(address);
+        }
+        ProfileScope version_scope(ProfilePhase::VERSION_MANAGER);
+        version_manager_->Store(address, &value, sizeof(T));
+    }
+
+    template<typename T>
+    T LoadWithMetadata(T *address, ReaderBitmap *metadata) {
+        T res;
+        LoadOrSuspend(address, metadata, false, &res);
+        return res;
+    }
+
+    template<typename T>
+    bool LoadOrSuspend(T *address, ReaderBitmap *metadata, bool may_suspend, T *value) {
+        OperationProfileScope operation_scope(ProfileOperation::LOAD);
+        if (state_ == ABORTED) {
+            transaction_manager_->Abort(this);
+        }
+        VirtualTimeScheduler::Charge(SimulatedOperation::LOAD);
+        Tracer::Record(TraceEventType::LOAD, transaction_id_, reinterpret_cast<uintptr_t>(address));
+        if (htm_cache_ != nullptr && !htm_cache_->Access(address, sizeof(T))) {
+            transaction_manager_->CapacityAbort(this);
+        }
+        if (!TrackLoad(address, sizeof(T), metadata, may_suspend)) {
+            return false;
+        }
+        // Check if write is in write buffer
+        ProfileScope version_scope(ProfilePhase::VERSION_MANAGER);
+        if (!version_manager_->GetValue(address, value, sizeof(T))) {
+            *value = *address;
+        }
+        if (!updates_.empty()) {
+            ApplyPendingUpdates(address, value);
+        }
+        return true;
+    }
+
     const uint64_t transaction_id_;
+    const uint32_t slot_;
     TransactionManager *transaction_manager_;
     std::unique_ptr<VersionManager> version_manager_;
+    std::unique_ptr<HtmCacheModel> htm_cache_;
 
     /**
      * Indicates the state of a transaction.
@@ -155,6 +661,45 @@ private:
     std::atomic<int> state_;
     std::unordered_set<void *> write_set_;
     std::unordered_set<void *> read_set_;
+    void *last_access_ = nullptr;
+    /** TVar addresses accessed through their own metadata, only used with reader bitmaps */
+    std::unordered_map<void *, ReaderBitmap *> embedded_metadata_;
+    /** orecs the transaction reads through, only used with orecs */
+    std::unordered_map<Orec *, size_t> orec_reads_;
+    /** reads kept by the elastic section, 0 outside of one */
+    size_t elastic_window_ = 0;
+    /** new reads of the elastic section, oldest first */
+    std::deque<void *> elastic_reads_;
 
     std::condition_variable_any abort_cv_;
+    /** queue this transaction waits on while stalled, protected by the manager's write set lock */
+    std::condition_variable_any *stall_queue_ = nullptr;
+    /** stall queue generation when suspended, protected by the manager's write set lock */
+    uint64_t stall_generation_ = 0;
+    /** true while suspended by TransactionManager::TryLoad */
+    std::atomic<bool> suspended_{false};
+
+    /** true if the manager adapts its mode, which needs the time spent running and stalled */
+    bool timed_ = false;
+    /** times in nanoseconds, or virtual cycles on a simulated core */
+    uint64_t begin_time_ = 0;
+    uint64_t stall_begin_time_ = 0;
+    uint64_t stall_time_ = 0;
+
+    /**
+     * Addresses first read or written by a nested transaction
+     */
+    struct NestedScope {
+        std::unordered_set<void *> write_set_;
+        std::unordered_set<void *> read_set_;
+        size_t allocations_begin_;
+        size_t frees_begin_;
+        size_t updates_begin_;
+    };
+
+    std::vector<NestedScope> nested_scopes_;
+    std::vector<void *> allocations_;
+    std::vector<void *> frees_;
+    /** commutative updates and cancellations in program order */
+    std::vector<CommutativeUpdate> updates_;
 };
\ No newline at end of file
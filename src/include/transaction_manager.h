@@ -1,14 +1,63 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <bitset>
 #include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <unordered_set>
 
+#include "adaptive_policy.h"
 #include "eager_version_manager.h"
+#include "htm_cache_model.h"
 #include "lazy_version_manager.h"
+#include "orec_table.h"
+#include "persistent_region.h"
+#include "reader_bitmap_table.h"
+#include "shared_memory_region.h"
 
 class Transaction;
 
+/**
+ * How the manager tracks which transactions read and write each address
+ */
+enum class ConflictMetadata {
+    /** a TransactionSet per address behind global read and write set locks */
+    HASH_SETS,
+    /** lock-free reader bitmaps and owner words per address stripe, pessimistic conflict detection only */
+    READER_BITMAPS,
+    /** lock-free four byte orecs in a large table of address stripes, pessimistic conflict detection only */
+    ORECS,
+};
+
+/**
+ *
+ * @param conflict_metadata conflict metadata
+ * @return command line name of the conflict metadata
+ */
+const char *ConflictMetadataName(ConflictMetadata conflict_metadata);
+
+/**
+ * Commutative update a transaction defers to its commit. Updates of the same kind to an address commute, so they
+ * don't conflict with each other.
+ */
+enum class CommutativeOp {
+    /** not commutative, like a store */
+    NONE,
+    ADD,
+    MIN,
+    MAX,
+    OR,
+};
+
+struct HtmStats {
+    size_t hardware_commits_;
+    size_t software_commits_;
+    size_t capacity_aborts_;
+    size_t conflict_aborts_;
+};
+
 class TransactionManager {
 
 public:
@@ -18,31 +67,224 @@ public:
         std::shared_mutex transaction_mutex_;
     };
 
+    /** Granule size for byte range conflict detection, the width of the largest scalar */
+    static constexpr size_t DEFAULT_GRANULE_SIZE = 8;
+
     /**
      * Default constructor for TransactionManager
      */
-    TransactionManager(bool use_lazy_versioning, bool use_pessimistic_conflict_detection);
+    TransactionManager(bool use_lazy_versioning, bool use_pessimistic_conflict_detection,
+                       ConflictMetadata conflict_metadata = ConflictMetadata::HASH_SETS);
+
+    /**
+     * Emulate best effort hardware transactions with the software path as the fallback
+     *
+     * @param config simulated cache geometry and retry policy
+     */
+    void EnableHtmEmulation(const HtmConfig &config);
+
+    /**
+     *
+     * @return true if hardware transactions are emulated, false otherwise
+     */
+    bool IsHtmEmulationEnabled() const { return use_htm_emulation_; }
+
+    /**
+     *
+     * @return simulated cache geometry and retry policy
+     */
+    const HtmConfig &GetHtmConfig() const { return htm_config_; }
+
+    /**
+     *
+     * @return commit and abort counts of hardware and software transactions since the last reset
+     */
+    HtmStats GetHtmStats() const;
+
+    /**
+     * Reset hardware transaction statistics
+     */
+    void ResetHtmStats();
+
+    /**
+     * Apply the read and write set removals of concurrent commits and aborts in batches. Finishing transactions
+     * publish a request and whichever one becomes the combiner removes every published transaction under a single
+     * acquisition of the global locks. Only supported with ConflictMetadata::HASH_SETS.
+     */
+    void EnableFlatCombining();
+
+    /**
+     *
+     * @return true if commits and aborts are combined, false otherwise
+     */
+    bool IsFlatCombiningEnabled() const { return use_flat_combining_; }
+
+    /**
+     * Detect conflicts between overlapping byte ranges instead of identical start addresses. Every access is split
+     * into the aligned granules it touches and each granule is tracked like an address, so two accesses conflict
+     * whenever they share a granule. Buffered writes are versioned by byte range, so a read sees the bytes of every
+     * earlier write of its transaction that it overlaps.
+     *
+     * Must be called before the first transaction begins.
+     *
+     * @param granule_size bytes per granule, a power of two. Smaller granules cause fewer false conflicts, larger
+     * ones track large values with fewer entries.
+     */
+    void EnableByteRanges(size_t granule_size = DEFAULT_GRANULE_SIZE);
+
+    /**
+     *
+     * @return bytes per conflict granule, 0 if conflicts are detected on start addresses
+     */
+    size_t GetGranuleSize() const { return granule_size_; }
+
+    /**
+     * Make transactional writes to a memory mapped region durable. Lazy versioning redo logs every commit and eager
+     * versioning undo logs every address before overwriting it in place, commits wait for group commit.
+     *
+     * No transaction may be running.
+     *
+     * @param region region to persist, must outlive the manager's transactions, nullptr to stop persisting
+     */
+    void EnablePersistence(PersistentRegion *region);
+
+    /**
+     *
+     * @return persistent region, nullptr if nothing is persistent
+     */
+    PersistentRegion *GetPersistentRegion() const { return persistent_region_; }
+
+    /**
+     * Run transactions together with the managers of other processes attached to the same shared memory segment. The
+     * orecs and slots of the segment replace the manager's own and transaction ids come from the segment, so only
+     * transactional accesses to the segment's data are isolated from the other processes.
+     *
+     * Only supported with ConflictMetadata::ORECS and without persistence. Must be called before the first
+     * transaction begins.
+     *
+     * @param region segment to share, must outlive the manager
+     */
+    void EnableSharedMemory(SharedMemoryRegion *region);
+
+    /**
+     *
+     * @return shared memory segment, nullptr if the manager runs transactions of this process only
+     */
+    SharedMemoryRegion *GetSharedMemoryRegion() const { return shared_memory_region_; }
+
+    /**
+     * Switch between lazy optimistic, lazy pessimistic and eager pessimistic transactions as the workload changes.
+     * Every finished attempt is added to a window of abort, stall and length statistics and an AdaptivePolicy picks
+     * the mode for the next window. A switch waits for a quiescent point: new transactions wait in XBegin until every
+     * running one finished. Threads that still run other transactions, like coroutine workers, never wait, so the
+     * switch is delayed until they finish theirs.
+     *
+     * Only supported with ConflictMetadata::HASH_SETS. Must be called before the first transaction begins.
+     *
+     * @param config thresholds of the policy
+     */
+    void EnableAdaptiveMode(const AdaptiveConfig &config = {});
+
+    /**
+     *
+     * @return true if the mode adapts to the workload, false otherwise
+     */
+    bool IsAdaptiveModeEnabled() const { return adaptive_policy_ != nullptr; }
+
+    /**
+     *
+     * @return versioning and conflict detection new transactions run with
+     */
+    TransactionMode GetMode();
+
+    /**
+     *
+     * @return number of times the adaptive mode switched
+     */
+    size_t GetModeSwitches();
+
+    /**
+     * Add a finished attempt to the adaptive window, called by every transaction of an adaptive manager when it is
+     * destroyed
+     *
+     * @param sample finished attempt
+     */
+    void FinishAdaptiveTransaction(const TransactionSample &sample);
 
     /**
      * Begin memory transaction
+     *
+     * @param use_htm run as an emulated hardware transaction, ignored unless HTM emulation is enabled
      * @return transaction
      */
-    Transaction XBegin();
+    Transaction XBegin(bool use_htm = false);
 
     /**
      * Adds transaction to write set for address
      *
      * @param address location to Store value
      * @param transaction transaction performing store
+     * @param metadata conflict metadata embedded next to address, nullptr to use the address' stripe
      */
-    void Store(void *address, Transaction *transaction);
+    void Store(void *address, Transaction *transaction, ReaderBitmap *metadata = nullptr);
+
+    /**
+     * Adds transaction to write set for address as a commutative update. Other updates of the same kind to address
+     * are compatible, reads, stores and updates of other kinds conflict with it like a store.
+     *
+     * @param address location the update is applied to at commit
+     * @param transaction transaction performing the update
+     * @param op kind of update
+     */
+    void Update(void *address, Transaction *transaction, CommutativeOp op);
+
+    /**
+     *
+     * @return true if commutative updates are deferred to commit, false if transactions fall back to loading and
+     * storing the address. Reader bitmaps and orecs have a single owner per stripe and persistence logs stored
+     * values, so none of them defers updates.
+     */
+    bool SupportsCommutativeUpdates() const { return slots_ == nullptr && persistent_region_ == nullptr; }
 
     /**
      * Adds transaction to read set for address
      * @param address
      * @param transaction transaction performing load
+     * @param metadata conflict metadata embedded next to address, nullptr to use the address' stripe
+     */
+    void Load(void *address, Transaction *transaction, ReaderBitmap *metadata = nullptr);
+
+    /**
+     * Adds transaction to read set for address unless it would have to stall on a writer. A transaction that would
+     * stall is marked stalled and suspended instead, other transactions treat it like any stalled transaction and it
+     * has to call Transaction::ResumeAfterStall once IsStallOver returns true before retrying.
+     *
+     * @param address location to load
+     * @param transaction transaction performing load
+     * @return true if the load was registered, false if the transaction was suspended
+     */
+    bool TryLoad(void *address, Transaction *transaction);
+
+    /**
+     *
+     * @param transaction transaction suspended by TryLoad
+     * @return true once the transaction was aborted or a writer may have released the address it stalled on
+     */
+    bool IsStallOver(const Transaction *transaction) const;
+
+    /**
+     *
+     * @return true if conflicts are tracked with reader bitmaps, so TVars can use their embedded metadata
      */
-    void Load(void *address, Transaction *transaction);
+    bool UsesReaderBitmaps() const { return reader_bitmaps_ != nullptr; }
+
+    /**
+     * Memory taken by conflict metadata right now. Transaction sets are estimated from their entries and bucket
+     * arrays, reader bitmaps and orecs are fixed tables.
+     *
+     * @return bytes of conflict metadata
+     */
+    size_t GetMetadataBytes();
 
     void ResolveConflictsAtCommit(Transaction *transaction);
 
@@ -68,21 +310,164 @@ public:
     */
     void Abort(Transaction *transaction);
 
+    /**
+     * Stop tracking addresses that were first accessed by a rolled back nested transaction
+     *
+     * @param transaction transaction whose nested transaction aborted
+     * @param write_set addresses first written by the nested transaction
+     * @param read_set addresses first read by the nested transaction
+     */
+    void AbortNested(Transaction *transaction, const std::unordered_set<void *> &write_set,
+                     const std::unordered_set<void *> &read_set);
+
+    /**
+     * Stop tracking an address the transaction read, so writers no longer conflict with the read. The transaction
+     * must have removed the address from its read set already.
+     *
+     * @param address address the transaction released
+     * @param transaction transaction releasing the address
+     */
+    void ReleaseRead(void *address, Transaction *transaction);
+
+    /**
+     * Abort a hardware transaction whose footprint overflowed the simulated cache
+     *
+     * @param transaction transaction to clean up memory for
+     *
+     * @throws CapacityAbortException
+     */
+    void CapacityAbort(Transaction *transaction);
+
 private:
     bool use_lazy_versioning_;
     bool use_pessimistic_conflict_detection_;
+    bool use_htm_emulation_;
+    HtmConfig htm_config_;
+    bool use_flat_combining_;
+    size_t granule_size_;
+    PersistentRegion *persistent_region_;
+    SharedMemoryRegion *shared_memory_region_ = nullptr;
+
+    std::atomic<size_t> htm_commits_;
+    std::atomic<size_t> software_commits_;
+    std::atomic<size_t> htm_capacity_aborts_;
+    std::atomic<size_t> htm_conflict_aborts_;
 
     std::atomic<uint64_t> next_txn_id_;
+
+    /** set when the mode adapts, everything below is protected by adaptive_mutex_ */
+    std::unique_ptr<AdaptivePolicy> adaptive_policy_;
+    std::mutex adaptive_mutex_;
+    /** transactions wait here in XBegin for a pending switch */
+    std::condition_variable_any adaptive_cv_;
+    size_t active_transactions_ = 0;
+    bool switch_pending_ = false;
+    TransactionMode pending_mode_ = TransactionMode::LAZY_PESSIMISTIC;
+    size_t mode_switches_ = 0;
     std::unordered_map<void *, TransactionSet> write_sets_;
     std::shared_mutex write_set_mutex_;
     std::unordered_map<void *, TransactionSet> read_sets_;
     std::shared_mutex read_set_mutex_;
+    /**
+     * Kind of commutative update each transaction has pending per address, NONE once it also stored to the address
+     * or mixed kinds. Protected by write_set_mutex_.
+     */
+    std::unordered_map<void *, std::unordered_map<Transaction *, CommutativeOp>> update_ops_;
 
-    std::condition_variable_any read_stall_cv_;
+    /**
+     * Stalled readers park on the queue their address hashes to, so a finishing writer only wakes readers of the
+     * addresses it wrote instead of every stalled reader. Protected by write_set_mutex_.
+     */
+    static constexpr size_t STALL_QUEUES = 256;
+    std::array<std::condition_variable_any, STALL_QUEUES> stall_queues_;
+    /** bumped on every wake of the matching stall queue, suspended transactions poll it instead of waiting */
+    std::array<std::atomic<uint64_t>, STALL_QUEUES> stall_generations_{};
+
+    /**
+     * Published by a finishing transaction, lives on its stack until a combiner sets done_
+     */
+    struct CombiningRequest {
+        Transaction *transaction_;
+        CombiningRequest *next_;
+        std::atomic<bool> done_{false};
+    };
+
+    std::atomic<CombiningRequest *> combining_requests_{nullptr};
+    std::mutex combiner_mutex_;
+
+    /** set when using ConflictMetadata::READER_BITMAPS, replaces the read and write sets */
+    std::unique_ptr<ReaderBitmapTable> reader_bitmaps_;
+    /** set when using ConflictMetadata::ORECS, replaces the read and write sets */
+    std::unique_ptr<OrecTable> orecs_;
+    /** slots of the reader bitmaps or orecs, nullptr with transaction sets */
+    SlotTable *slots_ = nullptr;
+
+    /**
+     * Count a new transaction of an adaptive manager, waiting for a pending switch first unless the calling thread
+     * runs other transactions
+     */
+    void AdmitAdaptiveTransaction();
 
     /**
      *
+     * @return current mode
+     * DO NOT CALL THIS METHOD WITHOUT THE ADAPTIVE LOCK
      */
+    TransactionMode GetModeWithoutLocking() const;
+
+    /**
+     * Remove an aborted transaction from all sets and wake up stalled readers
+     * DO NOT CALL THIS METHOD WITHOUT EXCLUSIVE LOCKS ON THE READ AND WRITE SETS
+     *
+     * @param transaction transaction to clean up memory for
+     */
+    void CleanUpAbortWithoutLocks(Transaction *transaction);
+
+    /**
+     *
+     * @param address address a reader stalls on
+     * @return queue readers stalled on address wait on
+     */
+    std::condition_variable_any &StallQueueFor(const void *address);
+
+    /**
+     * Wake readers stalled on any of the addresses, every queue is notified at most once
+     * DO NOT CALL THIS METHOD WITHOUT AN EXCLUSIVE LOCK ON THE WRITE SETS
+     *
+     * @param write_set addresses that are no longer written by a transaction
+     */
+    void WakeStalledReadersWithoutLocking(const std::unordered_set<void *> &write_set);
+
+    /**
+     * Wake readers stalled on the queues
+     * DO NOT CALL THIS METHOD WITHOUT AN EXCLUSIVE LOCK ON THE WRITE SETS
+     *
+     * @param queues queues to notify
+     */
+    void WakeStalledReadersWithoutLocking(const std::bitset<STALL_QUEUES> &queues);
+
+    /**
+     *
+     * @param write_set addresses that are no longer written by a transaction
+     * @param queues queues of readers stalled on the addresses get added here
+     */
+    void CollectStallQueues(const std::unordered_set<void *> &write_set, std::bitset<STALL_QUEUES> *queues);
+
+    /**
+     * Remove a finished transaction from the read and write sets through the combiner
+     *
+     * @param transaction transaction that committed or rolled back
+     */
+    void RemoveTransactionCombined(Transaction *transaction);
+
+    /**
+     * Count a conflict abort and unwind the transaction
+     *
+     * @param transaction aborted transaction
+     *
+     * @throws AbortException
+     */
+    [[noreturn]] void ThrowConflictAbort(Transaction *transaction);
 
     /**
      * Check and see if there's a conflict with the current transaction
@@ -97,16 +482,57 @@ private:
     bool CheckForConflictWithoutLocking(void *address, std::unordered_map<void *, TransactionSet> &address_map,
                                         Transaction *transaction);
 
+    /**
+     * Check and see if another transaction writes address with anything but an update of kind op
+     * DO NOT CALL THIS METHOD WITHOUT A LOCK ON THE WRITE SETS
+     *
+     * @param address Address to check for conflicts
+     * @param transaction Transaction to check conflicts for
+     * @param op kind of update transaction performs
+     * @return true if there are conflicts false otherwise
+     */
+    bool CheckForUpdateConflictWithoutLocking(void *address, Transaction *transaction, CommutativeOp op);
+
+    /**
+     *
+     * DO NOT CALL THIS METHOD WITHOUT A LOCK ON THE WRITE SETS
+     *
+     * @param address address transaction writes
+     * @param transaction transaction writing address
+     * @return kind of update transaction has pending on address, NONE if it stored to it
+     */
+    CommutativeOp UpdateOpWithoutLocking(void *address, Transaction *transaction) const;
+
+    /**
+     * Record the kind of update transaction performs on address, mixing it with a store or another kind makes it NONE
+     * DO NOT CALL THIS METHOD WITHOUT AN EXCLUSIVE LOCK ON THE WRITE SETS
+     *
+     * @param address address transaction writes
+     * @param transaction transaction writing address
+     * @param op kind of update, NONE for a store
+     */
+    void RecordUpdateOpWithoutLocking(void *address, Transaction *transaction, CommutativeOp op);
+
+    /**
+     * Forget the kinds of update transaction has pending on addresses
+     * DO NOT CALL THIS METHOD WITHOUT AN EXCLUSIVE LOCK ON THE WRITE SETS
+     *
+     * @param write_set addresses transaction no longer writes
+     * @param transaction transaction to forget
+     */
+    void RemoveUpdateOpsWithoutLocking(const std::unordered_set<void *> &write_set, Transaction *transaction);
+
     /**
      * Abort all transactions that have a conflict with the current transaction
      * DO NOT CALL THIS METHOD WITHOUT AN EXCLUSIVE LOCK
      *
      * @param address_map Map of transaction sets to check for conflicts in
      * @param transaction Transaction to check conflicts for
+     * @param skip_compatible_updates spare transactions performing the same kind of update as transaction
      * @return true if we were able to successfully abort other transactions false otherwise
      */
     bool AbortTransactionsWithConflictsWithoutLocking(std::unordered_map<void *, TransactionSet> &address_map,
-                                                      Transaction *transaction);
+                                                      Transaction *transaction, bool skip_compatible_updates = false);
 
     /**
      * Handle conflicts for transactions trying to read. Will either abort conflicting transactions, stall current
@@ -115,10 +541,44 @@ private:
      * @param address Address to check for conflicts at
      * @param transaction Transaction to check for conflicts
      * @param exclusive_write_lock Acquired lock on write sets
+     * @param suspended if not nullptr, suspend the transaction instead of stalling and set to true when suspended
      * @return
      */
     bool HandlePessimisticReadConflicts(void *address, Transaction *transaction,
-                                        std::unique_lock<std::shared_mutex> *exclusive_write_lock);
+                                        std::unique_lock<std::shared_mutex> *exclusive_write_lock,
+                                        bool *suspended = nullptr);
+
+    /**
+     * Release the reader bitmap stripes of addresses
+     *
+     * @param write_set addresses to stop writing
+     * @param read_set addresses to stop reading
+     * @param transaction transaction releasing the stripes
+     * @param keep_remaining keep stripes shared with addresses still in the transaction's read and write sets
+     * @param committed true if the transaction committed its writes
+     */
+    void ReleaseReaderBitmaps(const std::unordered_set<void *> &write_set, const std::unordered_set<void *> &read_set,
+                              Transaction *transaction, bool keep_remaining, bool committed);
+
+    /**
+     * Release the orecs of addresses
+     *
+     * @param write_set addresses to stop writing
+     * @param read_set addresses to stop reading
+     * @param transaction transaction releasing the orecs
+     * @param keep_remaining keep orecs shared with addresses still in the transaction's read and write sets, release
+     * every orec the transaction holds otherwise
+     */
+    void ReleaseOrecs(const std::unordered_set<void *> &write_set, const std::unordered_set<void *> &read_set,
+                      Transaction *transaction, bool keep_remaining);
+
+    /**
+     *
+     * @param address address accessed by transaction
+     * @param transaction transaction accessing the address
+     * @return metadata embedded next to address if it was accessed through a TVar, the address' stripe otherwise
+     */
+    ReaderBitmap &MetadataFor(void *address, const Transaction *transaction);
 
     /**
      * Add transaction to set of transactions
@@ -143,4 +603,16 @@ private:
     void RemoveTransactionFromAddressSetWithoutLocking(const std::unordered_set<void *> &address_set,
                                                        std::unordered_map<void *, TransactionSet> &address_map,
                                                        Transaction *transaction);
+
+    /**
+     * Remove transaction from the set of transactions of a single address
+     * DO NOT CALL THIS METHOD WITHOUT AN EXCLUSIVE LOCK
+     *
+     * @param address address to remove the transaction from
+     * @param address_map Map of addresses to remove address from
+     * @param transaction Transaction to remove
+     */
+    void RemoveTransactionFromAddressWithoutLocking(void *address,
+                                                    std::unordered_map<void *, TransactionSet> &address_map,
+                                                    Transaction *transaction);
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Allocator backing Transaction::Alloc and Transaction::Free.
+ *
+ * Blocks come from per-thread size class pools so allocating never touches shared state. Blocks freed by committed
+ * transactions are retired and only handed back to a pool through epoch based reclamation, once every transaction
+ * that was running when the block was retired has finished. Transactions pin the current epoch while they run.
+ */
+class TransactionalAllocator {
+public:
+    /** Size classes are powers of two from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE, larger blocks go straight to malloc */
+    static constexpr size_t MIN_BLOCK_SIZE = 16;
+    static constexpr size_t MAX_BLOCK_SIZE = 4096;
+    /** Blocks kept per size class and thread before they're returned to malloc */
+    static constexpr size_t MAX_POOLED_BLOCKS = 1024;
+    /** Retired blocks a thread accumulates before it tries to reclaim */
+    static constexpr size_t RECLAIM_THRESHOLD = 64;
+
+    /**
+     * Allocate a block from the calling thread's pool
+     *
+     * @param size bytes requested
+     * @return block aligned to 16 bytes
+     */
+    static void *Allocate(size_t size);
+
+    /**
+     * Return a block that no other thread can reference to the calling thread's pool
+     *
+     * @param block block returned by Allocate
+     */
+    static void Deallocate(void *block);
+
+    /**
+     * Free a block once no pinned thread can still reference it
+     *
+     * @param block block returned by Allocate
+     */
+    static void Retire(void *block);
+
+    /**
+     * Announce that the calling thread may reference transactional memory. Pins nest.
+     */
+    static void Pin();
+
+    /**
+     * Undo one Pin
+     */
+    static void Unpin();
+
+    /**
+     * Try to advance the global epoch and free the calling thread's retired blocks that are no longer reachable
+     *
+     * @return number of blocks reclaimed
+     */
+    static size_t Reclaim();
+};
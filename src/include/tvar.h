@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "reader_bitmap_table.h"
+
+/**
+ * Transactional variable that carries its own conflict metadata. The owner word, reader bits and version sit on the
+ * same cache line as small values, so managers using ConflictMetadata::READER_BITMAPS detect conflicts on it without
+ * hashing the address to a shared stripe. Other managers treat it like a raw pointer.
+ *
+ * Access it with Transaction::Load and Transaction::Store.
+ *
+ * @tparam T value type
+ */
+template<typename T>
+class TVar {
+    static_assert(std::is_trivially_copyable<T>::value, "Transactional memory copies values byte by byte");
+
+public:
+    explicit TVar(T value = T()) : value_(value) {}
+
+    TVar(const TVar &) = delete;
+
+    TVar &operator=(const TVar &) = delete;
+
+    /**
+     *
+     * @return address of the value, for the raw pointer path
+     */
+    T *GetAddress() { return &value_; }
+
+    /**
+     *
+     * @return conflict metadata of the value
+     */
+    ReaderBitmap *GetMetadata() { return &metadata_; }
+
+    /**
+     *
+     * @return number of committed writes, only tracked by managers using ConflictMetadata::READER_BITMAPS
+     */
+    uint64_t GetVersion() const { return metadata_.version_.load(); }
+
+    /**
+     * Read the value outside of any transaction, no transaction may be writing it
+     *
+     * @return value
+     */
+    T UnsafeGet() const { return value_; }
+
+private:
+    alignas(64) ReaderBitmap metadata_;
+    T value_;
+};
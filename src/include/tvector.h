@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include "transaction.h"
+#include "transactional_allocator.h"
+
+/**
+ * Transactional growable array.
+ *
+ * Elements live in chunks that double in size and never move once allocated, so growing never copies elements and
+ * accessing an element only reads its chunk pointer and the element itself. The size is only read by operations that
+ * need it, so reading and writing existing elements doesn't conflict with appends.
+ *
+ * @tparam T element type
+ */
+template<typename T>
+class TVector {
+    static_assert(std::is_trivially_copyable<T>::value, "Transactional memory copies elements byte by byte");
+
+public:
+    /** Elements in the first chunk, chunk k holds FIRST_CHUNK_SIZE << k elements */
+    static constexpr size_t FIRST_CHUNK_SIZE = 16;
+    /** enough chunks for more elements than fit in memory */
+    static constexpr size_t MAX_CHUNKS = 48;
+
+    TVector() = default;
+
+    /**
+     * Free every chunk, no transaction may be using the vector
+     */
+    ~TVector() {
+        for (auto *chunk : chunks_) {
+            if (chunk != nullptr) {
+                TransactionalAllocator::Deallocate(chunk);
+            }
+        }
+    }
+
+    TVector(const TVector &) = delete;
+
+    TVector &operator=(const TVector &) = delete;
+
+    /**
+     *
+     * @param transaction transaction reading the size
+     * @return number of elements
+     *
+     * @throws TransactionAbortException
+     */
+    size_t Size(Transaction *transaction) {
+        return transaction->Load(&size_);
+    }
+
+    /**
+     * Read an element, index must be less than Size
+     *
+     * @param transaction transaction performing the read
+     * @param index index of element
+     * @return element at index
+     *
+     * @throws TransactionAbortException
+     */
+    T Get(Transaction *transaction, size_t index) {
+        return transaction->Load(ElementAt(transaction, index));
+    }
+
+    /**
+     * Overwrite an element, index must be less than Size
+     *
+     * @param transaction transaction performing the write
+     * @param index index of element
+     * @param value new value of element
+     *
+     * @throws TransactionAbortException
+     */
+    void Set(Transaction *transaction, size_t index, const T &value) {
+        transaction->Store(ElementAt(transaction, index), value);
+    }
+
+    /**
+     * Append an element
+     *
+     * @param transaction transaction performing the append
+     * @param value element to append
+     *
+     * @throws TransactionAbortException
+     */
+    void PushBack(Transaction *transaction, const T &value) {
+        uint64_t size = transaction->Load(&size_);
+        size_t offset;
+        size_t chunk = ChunkOf(size, &offset);
+        T *elements = transaction->Load(&chunks_[chunk]);
+        if (elements == nullptr) {
+            elements = static_cast<T *>(transaction->Alloc(sizeof(T) * (FIRST_CHUNK_SIZE << chunk)));
+            transaction->Store(&chunks_[chunk], elements);
+        }
+        transaction->Store(&elements[offset], value);
+        transaction->Store(&size_, size + 1);
+    }
+
+    /**
+     * Remove the last element, chunks are kept for later appends
+     *
+     * @param transaction transaction performing the removal
+     * @param value set to the removed element
+     * @return false if the vector was empty, true otherwise
+     *
+     * @throws TransactionAbortException
+     */
+    bool PopBack(Transaction *transaction, T *value) {
+        uint64_t size = transaction->Load(&size_);
+        if (size == 0) {
+            return false;
+        }
+        *value = Get(transaction, size - 1);
+        transaction->Store(&size_, size - 1);
+        return true;
+    }
+
+private:
+    uint64_t size_ = 0;
+    std::array<T *, MAX_CHUNKS> chunks_{};
+
+    /**
+     * @param index index of element
+     * @param offset set to the index of the element within its chunk
+     * @return chunk holding the element
+     */
+    static size_t ChunkOf(size_t index, size_t *offset) {
+        size_t chunk = 0;
+        size_t first = 0;
+        while (index - first >= FIRST_CHUNK_SIZE << chunk) {
+            first += FIRST_CHUNK_SIZE << chunk;
+            chunk++;
+        }
+        *offset = index - first;
+        return chunk;
+    }
+
+    T *ElementAt(Transaction *transaction, size_t index) {
+        size_t offset;
+        size_t chunk = ChunkOf(index, &offset);
+        T *elements = chunk < MAX_CHUNKS ? transaction->Load(&chunks_[chunk]) : nullptr;
+        if (elements == nullptr) {
+            throw std::out_of_range("TVector index out of range");
+        }
+        return &elements[offset];
+    }
+};
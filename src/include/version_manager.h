@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 
 class VersionManager {
 public:
@@ -7,11 +8,34 @@ public:
 
     virtual void Store(void *address, void *value, size_t len) = 0;
 
-    virtual bool GetValue(void *address, void *dest) = 0;
+    /**
+     * Read a value through the versioning layer
+     *
+     * @param address address of the value
+     * @param dest memory location to write the value to
+     * @param len size of the value
+     * @return true if the value was written to dest, false if it should be read from address
+     */
+    virtual bool GetValue(void *address, void *dest, size_t len) = 0;
 
     virtual void Abort() = 0;
 
     virtual void XEnd() = 0;
+
+    /**
+     * Start a new segment for a closed nested transaction
+     */
+    virtual void BeginNested() = 0;
+
+    /**
+     * Roll back and discard the innermost segment
+     */
+    virtual void AbortNested() = 0;
+
+    /**
+     * Merge the innermost segment into its parent
+     */
+    virtual void CommitNested() = 0;
 };
 
 
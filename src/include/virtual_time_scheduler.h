@@ -0,0 +1,149 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+/**
+ * Cost in cycles of each simulated operation
+ */
+struct SimulationCosts {
+    uint64_t begin_cycles_ = 10;
+    uint64_t load_cycles_ = 4;
+    uint64_t store_cycles_ = 4;
+    uint64_t commit_cycles_ = 20;
+    uint64_t abort_cycles_ = 50;
+    /** cost of re-checking a stall condition */
+    uint64_t stall_cycles_ = 10;
+    /** how far a core may run ahead of the slowest core before being preempted, 0 is exact */
+    uint64_t quantum_cycles_ = 0;
+};
+
+enum class SimulatedOperation {
+    BEGIN, LOAD, STORE, COMMIT, ABORT, STALL
+};
+
+/**
+ * Discrete event scheduler that runs simulated cores one at a time in virtual time. Every core is backed by a host
+ * thread but only the core with the lowest virtual clock runs, ties are broken with a seeded random number generator,
+ * so interleavings only depend on the seed and the cost model and not on the host.
+ *
+ * Cores are only switched at Charge points which are never reached while holding transaction manager locks.
+ */
+class VirtualTimeScheduler {
+public:
+    VirtualTimeScheduler(size_t cores, uint64_t seed, SimulationCosts costs = {});
+
+    /**
+     * Run each body on its own simulated core, bodies.size() must not exceed the number of cores
+     *
+     * @param bodies work for each core
+     * @return virtual time in cycles when the last core finished
+     */
+    uint64_t Run(const std::vector<std::function<void()>> &bodies);
+
+    /**
+     *
+     * @return number of simulated cores
+     */
+    size_t GetCores() const { return num_cores_; }
+
+    /**
+     * Advance the virtual clock of the calling core and let a core with a lower clock run. Does nothing if the caller
+     * isn't running on a simulated core.
+     *
+     * @param operation operation that was performed
+     */
+    static void Charge(SimulatedOperation operation) {
+        if (current_ != nullptr) {
+            current_->Advance(operation);
+        }
+    }
+
+    /**
+     *
+     * @return true if the caller is running on a simulated core
+     */
+    static bool IsSimulating() { return current_ != nullptr; }
+
+    /**
+     *
+     * @return virtual clock of the calling core in cycles, 0 if the caller isn't running on a simulated core
+     */
+    static uint64_t Now() { return current_ == nullptr ? 0 : current_->cores_[current_core_]->clock_; }
+
+    /**
+     * Back off while spinning on shared state. Yields the host thread, or virtual time on a simulated core.
+     */
+    static void Pause() {
+        if (current_ == nullptr) {
+            std::this_thread::yield();
+        } else {
+            current_->Advance(SimulatedOperation::STALL);
+        }
+    }
+
+    /**
+     * Wait on a condition variable or, on a simulated core, yield virtual time until the predicate holds. Blocking
+     * the host thread would block every simulated core.
+     *
+     * @param cv condition variable to wait on
+     * @param lock lock protecting the predicate
+     * @param predicate condition to wait for
+     */
+    template<typename Lock, typename Predicate>
+    static void Wait(std::condition_variable_any &cv, Lock &lock, Predicate predicate) {
+        if (current_ == nullptr) {
+            cv.wait(lock, predicate);
+            return;
+        }
+        while (!predicate()) {
+            lock.unlock();
+            current_->Advance(SimulatedOperation::STALL);
+            lock.lock();
+        }
+    }
+
+private:
+    static constexpr size_t NO_CORE = SIZE_MAX;
+
+    struct Core {
+        uint64_t clock_ = 0;
+        bool finished_ = false;
+        std::condition_variable cv_;
+    };
+
+    static inline thread_local VirtualTimeScheduler *current_ = nullptr;
+    static inline thread_local size_t current_core_ = NO_CORE;
+
+    const size_t num_cores_;
+    const SimulationCosts costs_;
+    std::mt19937_64 rng_;
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Core>> cores_;
+    size_t running_core_;
+
+    void Advance(SimulatedOperation operation);
+
+    uint64_t Cost(SimulatedOperation operation) const;
+
+    /**
+     * Pick the unfinished core with the lowest clock
+     * DO NOT CALL THIS METHOD WITHOUT HOLDING mutex_
+     *
+     * @return next core to run or NO_CORE if all cores finished
+     */
+    size_t PickNextCoreWithoutLocking();
+
+    /**
+     * Hand control to the next core
+     * DO NOT CALL THIS METHOD WITHOUT HOLDING mutex_
+     */
+    void RunNextCoreWithoutLocking();
+};
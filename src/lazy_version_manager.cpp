@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include "include/lazy_version_manager.h"
 
@@ -5,38 +6,85 @@ void LazyVersionManager::Store(void *address, void *value, size_t len) {
     void *buffered_val = malloc(len);
     std::memcpy(buffered_val, value, len);
 
+    auto &write_buffer = write_buffers_.back();
     // If we write twice to the same location, we only care about the most recent write.
-    if (write_buffer_.count(address) > 0) {
-        auto &write = write_buffer_.at(address);
+    if (write_buffer.count(address) > 0) {
+        auto &write = write_buffer.at(address);
         free(write.data_);
-        write_buffer_.erase(address);
+        write_buffer.erase(address);
     }
 
-    write_buffer_.emplace(
+    write_buffer.emplace(
             std::piecewise_construct,
             std::forward_as_tuple(reinterpret_cast<void *>(address)),
             std::forward_as_tuple(buffered_val, len));
 }
 
-bool LazyVersionManager::GetValue(void *address, void *dest) {
-    if (write_buffer_.count(address) > 0) {
-        const auto &write = write_buffer_.at(address);
-        // TODO this results in a double copy, which may be unavoidable
-        std::memcpy(dest, write.data_, write.size_);
-        return true;
+bool LazyVersionManager::GetValue(void *address, void *dest, size_t len) {
+    // Inner segments hold the most recent writes
+    for (auto write_buffer = write_buffers_.rbegin(); write_buffer != write_buffers_.rend(); write_buffer++) {
+        if (write_buffer->count(address) > 0) {
+            const auto &write = write_buffer->at(address);
+            // TODO this results in a double copy, which may be unavoidable
+            std::memcpy(dest, write.data_, std::min(write.size_, len));
+            return true;
+        }
     }
     return false;
 }
 
 void LazyVersionManager::Abort() {
-    for (const auto &write : write_buffer_) {
-        free(write.second.data_);
+    for (const auto &write_buffer : write_buffers_) {
+        for (const auto &write : write_buffer) {
+            free(write.second.data_);
+        }
     }
 }
 
 void LazyVersionManager::XEnd() {
-    for (const auto &write : write_buffer_) {
-        std::memcpy(write.first, write.second.data_, write.second.size_);
+    if (region_ != nullptr) {
+        std::vector<RedoEntry> redo;
+        for (const auto &write_buffer : write_buffers_) {
+            for (const auto &write : write_buffer) {
+                if (region_->Contains(write.first, write.second.size_)) {
+                    redo.push_back({write.first, write.second.data_, write.second.size_});
+                }
+            }
+        }
+        // Nothing may reach the file before the redo record is durable
+        if (!redo.empty()) {
+            region_->WaitDurable(region_->AppendCommit(transaction_id_, redo));
+        }
+    }
+    for (const auto &write_buffer : write_buffers_) {
+        for (const auto &write : write_buffer) {
+            std::memcpy(write.first, write.second.data_, write.second.size_);
+            free(write.second.data_);
+        }
+    }
+}
+
+void LazyVersionManager::BeginNested() {
+    write_buffers_.emplace_back();
+}
+
+void LazyVersionManager::AbortNested() {
+    for (const auto &write : write_buffers_.back()) {
         free(write.second.data_);
     }
+    write_buffers_.pop_back();
+}
+
+void LazyVersionManager::CommitNested() {
+    auto child = std::move(write_buffers_.back());
+    write_buffers_.pop_back();
+    auto &parent = write_buffers_.back();
+    for (const auto &write : child) {
+        auto parent_write = parent.find(write.first);
+        if (parent_write != parent.end()) {
+            free(parent_write->second.data_);
+            parent.erase(parent_write);
+        }
+        parent.emplace(write.first, write.second);
+    }
 }
@@ -0,0 +1,63 @@
+#include "include/orec_table.h"
+
+OrecTable::OrecTable(size_t orecs) : owned_orecs_(RoundOrecCount(orecs)) {
+    orecs_ = owned_orecs_.data();
+    orec_mask_ = owned_orecs_.size() - 1;
+}
+
+OrecTable::OrecTable(Orec *orecs, size_t count, State *slots, const void *base)
+        : SlotTable(slots), orecs_(orecs), orec_mask_(count - 1), base_(reinterpret_cast<uintptr_t>(base)) {}
+
+size_t OrecTable::RoundOrecCount(size_t orecs) {
+    size_t size = 1;
+    while (size < orecs) {
+        size <<= 1;
+    }
+    return size;
+}
+
+bool OrecTable::AcquireWrite(Orec &orec, uint32_t slot, bool reading) {
+    uint32_t state = orec.load();
+    while (true) {
+        uint32_t owner = state >> OWNER_SHIFT;
+        if (owner != 0) {
+            // Readers that showed up after we became the writer are waiting on us
+            return owner == slot + 1;
+        }
+        // Check for read conflicts - Writer loses
+        if ((state & READERS_MASK) != (reading ? 1 : 0)) {
+            return false;
+        }
+        // Readers and owner share the word, so no reader can slip in between the check and the exchange
+        if (orec.compare_exchange_weak(state, state | (slot + 1) << OWNER_SHIFT)) {
+            return true;
+        }
+    }
+}
+
+bool OrecTable::AcquireRead(Orec &orec, uint32_t slot) {
+    uint32_t state = orec.fetch_add(1) + 1;
+    while (true) {
+        uint32_t owner = state >> OWNER_SHIFT;
+        if (owner == 0 || owner == slot + 1) {
+            return true;
+        }
+        if (!WaitForWriter(slot, owner - 1, [&] { return orec.load() >> OWNER_SHIFT == owner; })) {
+            // We were aborted while stalled
+            orec.fetch_sub(1);
+            return false;
+        }
+        state = orec.load();
+    }
+}
+
+void OrecTable::ReleaseWrite(Orec &orec, uint32_t slot) {
+    // Only the writer changes the owner half while it owns the orec
+    if (orec.load() >> OWNER_SHIFT == slot + 1) {
+        orec.fetch_and(READERS_MASK);
+    }
+}
+
+void OrecTable::ReleaseRead(Orec &orec) {
+    orec.fetch_sub(1);
+}
@@ -0,0 +1,82 @@
+#include "include/perf_counters.h"
+
+#ifdef __linux__
+
+#include <cstring>
+#include <initializer_list>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int OpenCounter(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+static uint64_t ReadCounter(int fd) {
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
+
+PerfCounters::PerfCounters()
+        : cache_misses_fd_(OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES)),
+          l1d_read_misses_fd_(OpenCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                                              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))) {}
+
+PerfCounters::~PerfCounters() {
+    if (cache_misses_fd_ >= 0) {
+        close(cache_misses_fd_);
+    }
+    if (l1d_read_misses_fd_ >= 0) {
+        close(l1d_read_misses_fd_);
+    }
+}
+
+void PerfCounters::Start() {
+    for (int fd : {cache_misses_fd_, l1d_read_misses_fd_}) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+CacheMissCounts PerfCounters::Stop() {
+    CacheMissCounts counts;
+    if (cache_misses_fd_ < 0 || l1d_read_misses_fd_ < 0) {
+        return counts;
+    }
+    ioctl(cache_misses_fd_, PERF_EVENT_IOC_DISABLE, 0);
+    ioctl(l1d_read_misses_fd_, PERF_EVENT_IOC_DISABLE, 0);
+    counts.available_ = true;
+    counts.cache_misses_ = ReadCounter(cache_misses_fd_);
+    counts.l1d_read_misses_ = ReadCounter(l1d_read_misses_fd_);
+    return counts;
+}
+
+#else
+
+PerfCounters::PerfCounters() : cache_misses_fd_(-1), l1d_read_misses_fd_(-1) {}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::Start() {}
+
+CacheMissCounts PerfCounters::Stop() {
+    return {};
+}
+
+#endif
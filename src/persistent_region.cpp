@@ -0,0 +1,240 @@
+#include "include/persistent_region.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "include/virtual_time_scheduler.h"
+
+static void ThrowErrno(const std::string &what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+PersistentRegion::PersistentRegion(const std::string &path, size_t size) : path_(path), size_(size) {
+    data_fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (data_fd_ < 0) {
+        ThrowErrno("open " + path);
+    }
+    struct stat stat_buf{};
+    if (fstat(data_fd_, &stat_buf) != 0) {
+        ThrowErrno("stat " + path);
+    }
+    if (static_cast<size_t>(stat_buf.st_size) < size && ftruncate(data_fd_, static_cast<off_t>(size)) != 0) {
+        ThrowErrno("truncate " + path);
+    }
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, data_fd_, 0);
+    if (base == MAP_FAILED) {
+        ThrowErrno("mmap " + path);
+    }
+    base_ = static_cast<char *>(base);
+    log_fd_ = open((path + ".log").c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (log_fd_ < 0) {
+        ThrowErrno("open " + path + ".log");
+    }
+    Recover();
+}
+
+PersistentRegion::~PersistentRegion() {
+    try {
+        Checkpoint();
+    } catch (const std::system_error &e) {
+        // The log still holds everything, the next open recovers it
+    }
+    munmap(base_, size_);
+    close(data_fd_);
+    close(log_fd_);
+}
+
+uint64_t PersistentRegion::AppendUndo(uint64_t transaction_id, void *address, size_t len) {
+    std::unique_lock<std::mutex> lock(log_mutex_);
+    return AppendWithoutLocking(UNDO, transaction_id, {{address, address, len}});
+}
+
+uint64_t PersistentRegion::AppendCommit(uint64_t transaction_id, const std::vector<RedoEntry> &entries) {
+    commits_++;
+    std::unique_lock<std::mutex> lock(log_mutex_);
+    return AppendWithoutLocking(COMMIT, transaction_id, entries);
+}
+
+void PersistentRegion::AppendAbort(uint64_t transaction_id) {
+    std::unique_lock<std::mutex> lock(log_mutex_);
+    AppendWithoutLocking(ABORT, transaction_id, {});
+}
+
+uint64_t PersistentRegion::AppendWithoutLocking(uint8_t type, uint64_t transaction_id,
+                                                const std::vector<RedoEntry> &entries) {
+    RecordHeader header{};
+    header.magic_ = MAGIC;
+    header.type_ = type;
+    header.transaction_id_ = transaction_id;
+    for (const auto &entry : entries) {
+        header.payload_size_ += sizeof(EntryHeader) + entry.size_;
+    }
+
+    size_t record_start = log_buffer_.size();
+    log_buffer_.resize(record_start + sizeof(RecordHeader) + header.payload_size_);
+    char *payload = log_buffer_.data() + record_start + sizeof(RecordHeader);
+    char *cursor = payload;
+    for (const auto &entry : entries) {
+        EntryHeader entry_header{static_cast<uint64_t>(static_cast<char *>(entry.address_) - base_), entry.size_};
+        std::memcpy(cursor, &entry_header, sizeof(entry_header));
+        std::memcpy(cursor + sizeof(entry_header), entry.data_, entry.size_);
+        cursor += sizeof(entry_header) + entry.size_;
+    }
+    header.checksum_ = Checksum(header, payload);
+    std::memcpy(log_buffer_.data() + record_start, &header, sizeof(header));
+
+    appended_lsn_ += sizeof(RecordHeader) + header.payload_size_;
+    return appended_lsn_;
+}
+
+void PersistentRegion::WaitDurable(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(log_mutex_);
+    while (durable_lsn_ < lsn) {
+        if (syncing_) {
+            VirtualTimeScheduler::Wait(durable_cv_, lock, [&] { return !syncing_ || durable_lsn_ >= lsn; });
+            continue;
+        }
+        // Become the leader and sync everything appended so far, including records of later waiters
+        syncing_ = true;
+        std::vector<char> batch;
+        batch.swap(log_buffer_);
+        uint64_t batch_lsn = appended_lsn_;
+        lock.unlock();
+        bool synced = WriteLog(batch.data(), batch.size()) && fdatasync(log_fd_) == 0;
+        lock.lock();
+        syncing_ = false;
+        if (!synced) {
+            durable_cv_.notify_all();
+            ThrowErrno("sync " + path_ + ".log");
+        }
+        durable_lsn_ = batch_lsn;
+        syncs_++;
+        durable_cv_.notify_all();
+    }
+}
+
+void PersistentRegion::Checkpoint() {
+    WaitDurable(appended_lsn_);
+    if (msync(base_, size_, MS_SYNC) != 0) {
+        ThrowErrno("msync " + path_);
+    }
+    // Everything in the log is in the file now
+    if (ftruncate(log_fd_, 0) != 0 || fdatasync(log_fd_) != 0) {
+        ThrowErrno("truncate " + path_ + ".log");
+    }
+}
+
+bool PersistentRegion::WriteLog(const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(log_fd_, data, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        len -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void PersistentRegion::Recover() {
+    struct stat stat_buf{};
+    if (fstat(log_fd_, &stat_buf) != 0) {
+        ThrowErrno("stat " + path_ + ".log");
+    }
+    std::vector<char> log(static_cast<size_t>(stat_buf.st_size));
+    size_t read_bytes = 0;
+    while (read_bytes < log.size()) {
+        ssize_t got = pread(log_fd_, log.data() + read_bytes, log.size() - read_bytes, static_cast<off_t>(read_bytes));
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        read_bytes += static_cast<size_t>(got);
+    }
+    log.resize(read_bytes);
+
+    struct Undo {
+        uint64_t offset_;
+        const char *data_;
+        size_t size_;
+    };
+    auto apply_entries = [&](const char *payload, uint64_t payload_size, std::vector<Undo> *undos) {
+        const char *cursor = payload;
+        while (cursor < payload + payload_size) {
+            EntryHeader entry_header{};
+            std::memcpy(&entry_header, cursor, sizeof(entry_header));
+            cursor += sizeof(entry_header);
+            if (entry_header.offset_ + entry_header.size_ <= size_) {
+                if (undos != nullptr) {
+                    undos->push_back({entry_header.offset_, cursor, entry_header.size_});
+                } else {
+                    std::memcpy(base_ + entry_header.offset_, cursor, entry_header.size_);
+                }
+            }
+            cursor += entry_header.size_;
+        }
+    };
+    auto roll_back = [&](const std::vector<Undo> &undos) {
+        for (auto undo = undos.rbegin(); undo != undos.rend(); undo++) {
+            std::memcpy(base_ + undo->offset_, undo->data_, undo->size_);
+        }
+        recovery_stats_.rolled_back_++;
+    };
+
+    // Strict two phase locking orders conflicting records in the log, so replaying in log order is enough
+    std::unordered_map<uint64_t, std::vector<Undo>> pending_undos;
+    size_t position = 0;
+    while (position + sizeof(RecordHeader) <= log.size()) {
+        RecordHeader header{};
+        std::memcpy(&header, log.data() + position, sizeof(header));
+        const char *payload = log.data() + position + sizeof(RecordHeader);
+        if (header.magic_ != MAGIC || header.payload_size_ > log.size() - position - sizeof(RecordHeader) ||
+            Checksum(header, payload) != header.checksum_) {
+            break;
+        }
+        if (header.type_ == UNDO) {
+            apply_entries(payload, header.payload_size_, &pending_undos[header.transaction_id_]);
+        } else if (header.type_ == COMMIT) {
+            apply_entries(payload, header.payload_size_, nullptr);
+            pending_undos.erase(header.transaction_id_);
+            recovery_stats_.committed_++;
+        } else if (header.type_ == ABORT) {
+            roll_back(pending_undos[header.transaction_id_]);
+            pending_undos.erase(header.transaction_id_);
+        }
+        position += sizeof(RecordHeader) + header.payload_size_;
+    }
+    recovery_stats_.torn_bytes_ = log.size() - position;
+    // Transactions that were running at the crash
+    for (const auto &undos : pending_undos) {
+        roll_back(undos.second);
+    }
+    Checkpoint();
+}
+
+uint64_t PersistentRegion::Checksum(const RecordHeader &header, const char *payload) {
+    // FNV-1a over the header without its checksum and the payload
+    uint64_t hash = 0xcbf29ce484222325;
+    auto mix = [&hash](const void *data, size_t len) {
+        auto bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3;
+        }
+    };
+    mix(&header.type_, sizeof(header.type_));
+    mix(&header.transaction_id_, sizeof(header.transaction_id_));
+    mix(&header.payload_size_, sizeof(header.payload_size_));
+    mix(payload, header.payload_size_);
+    return hash;
+}
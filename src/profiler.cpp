@@ -0,0 +1,212 @@
+#include "include/profiler.h"
+
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+constexpr size_t MAX_DEPTH = 16;
+
+/**
+ * Totals of one thread. Only the owning thread writes them, the atomics let a report read them while it's alive.
+ */
+struct ThreadProfile {
+    std::array<std::atomic<uint64_t>, PROFILE_OPERATIONS> calls_{};
+    std::array<std::array<std::atomic<uint64_t>, PROFILE_PHASES>, PROFILE_OPERATIONS> ticks_{};
+
+    struct Frame {
+        ProfileOperation operation_;
+        ProfilePhase phase_;
+        /** whether the frame is inside an operation */
+        bool counted_;
+    };
+    std::array<Frame, MAX_DEPTH> stack_{};
+    size_t depth_ = 0;
+    uint64_t last_ = 0;
+
+    ThreadProfile();
+
+    ~ThreadProfile();
+
+    /**
+     * Charge the ticks since the last boundary to the innermost phase
+     *
+     * @param now current ticks
+     */
+    void Charge(uint64_t now) {
+        if (depth_ > 0 && depth_ <= MAX_DEPTH && stack_[depth_ - 1].counted_) {
+            const auto &frame = stack_[depth_ - 1];
+            auto &ticks = ticks_[static_cast<size_t>(frame.operation_)][static_cast<size_t>(frame.phase_)];
+            ticks.store(ticks.load(std::memory_order_relaxed) + (now - last_), std::memory_order_relaxed);
+        }
+        last_ = now;
+    }
+
+    void AddTo(ProfileTotals *totals) const {
+        bool active = false;
+        for (size_t operation = 0; operation < PROFILE_OPERATIONS; operation++) {
+            totals->calls_[operation] += calls_[operation].load(std::memory_order_relaxed);
+            active |= calls_[operation].load(std::memory_order_relaxed) > 0;
+            for (size_t phase = 0; phase < PROFILE_PHASES; phase++) {
+                totals->ticks_[operation][phase] += ticks_[operation][phase].load(std::memory_order_relaxed);
+            }
+        }
+        totals->threads_ += active ? 1 : 0;
+    }
+
+    void Clear() {
+        for (size_t operation = 0; operation < PROFILE_OPERATIONS; operation++) {
+            calls_[operation].store(0, std::memory_order_relaxed);
+            for (size_t phase = 0; phase < PROFILE_PHASES; phase++) {
+                ticks_[operation][phase].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+std::mutex registry_mutex;
+std::vector<ThreadProfile *> live_profiles;
+/** totals of threads that exited since the last reset */
+ProfileTotals retired_totals;
+
+ThreadProfile::ThreadProfile() {
+    std::unique_lock<std::mutex> lock(registry_mutex);
+    live_profiles.push_back(this);
+}
+
+ThreadProfile::~ThreadProfile() {
+    std::unique_lock<std::mutex> lock(registry_mutex);
+    AddTo(&retired_totals);
+    for (auto &profile : live_profiles) {
+        if (profile == this) {
+            profile = live_profiles.back();
+            live_profiles.pop_back();
+            break;
+        }
+    }
+}
+
+thread_local ThreadProfile thread_profile;
+
+}
+
+const char *Profiler::TickUnit() {
+#if defined(TM_PROFILING) && (defined(__x86_64__) || defined(__i386__))
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+void Profiler::Enter(ProfilePhase phase, bool start_operation, ProfileOperation operation) {
+    auto &profile = thread_profile;
+    profile.Charge(Now());
+    // Phases outside of an operation, like aborts requested by the workload itself, aren't attributed
+    bool counted = start_operation;
+    if (start_operation) {
+        auto &calls = profile.calls_[static_cast<size_t>(operation)];
+        calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } else if (profile.depth_ > 0 && profile.depth_ <= MAX_DEPTH) {
+        operation = profile.stack_[profile.depth_ - 1].operation_;
+        counted = profile.stack_[profile.depth_ - 1].counted_;
+    }
+    if (profile.depth_ < MAX_DEPTH) {
+        profile.stack_[profile.depth_] = {operation, phase, counted};
+    }
+    profile.depth_++;
+}
+
+void Profiler::Exit() {
+    auto &profile = thread_profile;
+    profile.Charge(Now());
+    profile.depth_--;
+}
+
+void Profiler::Reset() {
+    std::unique_lock<std::mutex> lock(registry_mutex);
+    retired_totals = {};
+    for (auto *profile : live_profiles) {
+        profile->Clear();
+    }
+}
+
+ProfileTotals Profiler::Collect() {
+    std::unique_lock<std::mutex> lock(registry_mutex);
+    ProfileTotals totals = retired_totals;
+    for (auto *profile : live_profiles) {
+        profile->AddTo(&totals);
+    }
+    return totals;
+}
+
+void Profiler::Report(std::ostream &out, const std::string &configuration) {
+    auto totals = Collect();
+    out << "Profile of " << configuration << " over " << totals.threads_ << " threads" << std::endl;
+    std::array<uint64_t, PROFILE_PHASES> phase_ticks{};
+    uint64_t all_ticks = 0;
+    for (size_t operation = 0; operation < PROFILE_OPERATIONS; operation++) {
+        uint64_t operation_ticks = 0;
+        for (size_t phase = 0; phase < PROFILE_PHASES; phase++) {
+            operation_ticks += totals.ticks_[operation][phase];
+            phase_ticks[phase] += totals.ticks_[operation][phase];
+        }
+        all_ticks += operation_ticks;
+        auto calls = totals.calls_[operation];
+        out << "  " << OperationName(static_cast<ProfileOperation>(operation)) << ": " << calls << " calls, "
+            << (calls == 0 ? 0 : operation_ticks / calls) << " " << TickUnit() << " per call" << std::endl;
+        for (size_t phase = 0; phase < PROFILE_PHASES; phase++) {
+            if (totals.ticks_[operation][phase] == 0) {
+                continue;
+            }
+            out << "    " << std::left << std::setw(18) << PhaseName(static_cast<ProfilePhase>(phase)) << std::right
+                << std::setw(7) << std::fixed << std::setprecision(1)
+                << 100.0 * static_cast<double>(totals.ticks_[operation][phase]) /
+                   static_cast<double>(operation_ticks) << "%" << std::endl;
+        }
+    }
+    out << "  All operations: " << all_ticks << " " << TickUnit() << std::endl;
+    for (size_t phase = 0; phase < PROFILE_PHASES; phase++) {
+        if (phase_ticks[phase] == 0) {
+            continue;
+        }
+        out << "    " << std::left << std::setw(18) << PhaseName(static_cast<ProfilePhase>(phase)) << std::right
+            << std::setw(7) << std::fixed << std::setprecision(1)
+            << 100.0 * static_cast<double>(phase_ticks[phase]) / static_cast<double>(all_ticks) << "%" << std::endl;
+    }
+    out.unsetf(std::ios_base::floatfield);
+}
+
+const char *Profiler::OperationName(ProfileOperation operation) {
+    switch (operation) {
+        case ProfileOperation::LOAD:
+            return "Load";
+        case ProfileOperation::STORE:
+            return "Store";
+        case ProfileOperation::COMMIT:
+            return "XEnd";
+    }
+    return "unknown";
+}
+
+const char *Profiler::PhaseName(ProfilePhase phase) {
+    switch (phase) {
+        case ProfilePhase::OTHER:
+            return "other";
+        case ProfilePhase::GLOBAL_LOCK_WAIT:
+            return "global lock wait";
+        case ProfilePhase::SET_LOCK_WAIT:
+            return "set lock wait";
+        case ProfilePhase::CONFLICT_CHECK:
+            return "conflict check";
+        case ProfilePhase::SET_UPDATE:
+            return "set update";
+        case ProfilePhase::VERSION_MANAGER:
+            return "version manager";
+        case ProfilePhase::STALL_WAIT:
+            return "stall wait";
+        case ProfilePhase::ABORT_CLEANUP:
+            return "abort cleanup";
+    }
+    return "unknown";
+}
@@ -0,0 +1,49 @@
+#include "include/random.h"
+
+#include <atomic>
+
+namespace {
+
+uint64_t SplitMix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+uint64_t global_seed = 0;
+std::atomic<uint64_t> next_stream(0);
+thread_local Xoshiro256 generator(0, ~uint64_t{0});
+
+}
+
+Xoshiro256::Xoshiro256(uint64_t seed, uint64_t stream) {
+    // Mix the stream into the seed first so nearby streams start far apart
+    uint64_t mix = seed;
+    uint64_t splitmix = SplitMix64(&mix) ^ stream;
+    for (auto &word : state_) {
+        word = SplitMix64(&splitmix);
+    }
+}
+
+void Random::Seed(uint64_t seed) {
+    global_seed = seed;
+    next_stream = 0;
+    generator = Xoshiro256(seed, ~uint64_t{0});
+}
+
+uint64_t Random::GetSeed() {
+    return global_seed;
+}
+
+uint64_t Random::ReserveStreams(size_t count) {
+    return next_stream.fetch_add(count);
+}
+
+void Random::SetStream(uint64_t stream) {
+    generator = Xoshiro256(global_seed, stream);
+}
+
+Xoshiro256 &Random::Generator() {
+    return generator;
+}
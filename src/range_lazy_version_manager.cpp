@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "include/range_lazy_version_manager.h"
+
+void RangeLazyVersionManager::Store(void *address, void *value, size_t len) {
+    void *buffered_val = malloc(len);
+    std::memcpy(buffered_val, value, len);
+    Insert(&write_buffers_.back(), reinterpret_cast<uintptr_t>(address), Write(buffered_val, len));
+}
+
+bool RangeLazyVersionManager::GetValue(void *address, void *dest, size_t len) {
+    auto start = reinterpret_cast<uintptr_t>(address);
+    auto end = start + len;
+    bool found = false;
+    // Outer segments first so the most recent writes of inner segments are copied last
+    for (const auto &write_buffer : write_buffers_) {
+        auto write = write_buffer.upper_bound(start);
+        if (write != write_buffer.begin()) {
+            write--;
+        }
+        for (; write != write_buffer.end() && write->first < end; write++) {
+            auto write_end = write->first + write->second.size_;
+            if (write_end <= start) {
+                continue;
+            }
+            if (!found) {
+                std::memcpy(dest, address, len);
+                found = true;
+            }
+            auto overlap_start = std::max(start, write->first);
+            auto overlap_end = std::min(end, write_end);
+            std::memcpy(static_cast<char *>(dest) + (overlap_start - start),
+                        static_cast<char *>(write->second.data_) + (overlap_start - write->first),
+                        overlap_end - overlap_start);
+        }
+    }
+    return found;
+}
+
+void RangeLazyVersionManager::Abort() {
+    for (const auto &write_buffer : write_buffers_) {
+        for (const auto &write : write_buffer) {
+            free(write.second.data_);
+        }
+    }
+}
+
+void RangeLazyVersionManager::XEnd() {
+    if (region_ != nullptr) {
+        std::vector<RedoEntry> redo;
+        for (const auto &write_buffer : write_buffers_) {
+            for (const auto &write : write_buffer) {
+                auto *address = reinterpret_cast<void *>(write.first);
+                if (region_->Contains(address, write.second.size_)) {
+                    redo.push_back({address, write.second.data_, write.second.size_});
+                }
+            }
+        }
+        // Nothing may reach the file before the redo record is durable
+        if (!redo.empty()) {
+            region_->WaitDurable(region_->AppendCommit(transaction_id_, redo));
+        }
+    }
+    // Inner segments last so their writes win where they overlap the outer ones
+    for (const auto &write_buffer : write_buffers_) {
+        for (const auto &write : write_buffer) {
+            std::memcpy(reinterpret_cast<void *>(write.first), write.second.data_, write.second.size_);
+            free(write.second.data_);
+        }
+    }
+}
+
+void RangeLazyVersionManager::BeginNested() {
+    write_buffers_.emplace_back();
+}
+
+void RangeLazyVersionManager::AbortNested() {
+    for (const auto &write : write_buffers_.back()) {
+        free(write.second.data_);
+    }
+    write_buffers_.pop_back();
+}
+
+void RangeLazyVersionManager::CommitNested() {
+    auto child = std::move(write_buffers_.back());
+    write_buffers_.pop_back();
+    auto &parent = write_buffers_.back();
+    for (const auto &write : child) {
+        Insert(&parent, write.first, write.second);
+    }
+}
+
+void RangeLazyVersionManager::Insert(RangeWriteBuffer *write_buffer, uintptr_t start, Write write) {
+    auto end = start + write.size_;
+    auto older = write_buffer->upper_bound(start);
+    if (older != write_buffer->begin() && std::prev(older)->first + std::prev(older)->second.size_ > start) {
+        older--;
+    }
+    while (older != write_buffer->end() && older->first < end) {
+        auto older_start = older->first;
+        auto older_end = older_start + older->second.size_;
+        auto *older_data = static_cast<char *>(older->second.data_);
+        older = write_buffer->erase(older);
+        // Keep the bytes of the older write on either side of the new one
+        if (older_start < start) {
+            size_t size = start - older_start;
+            void *data = malloc(size);
+            std::memcpy(data, older_data, size);
+            write_buffer->emplace(older_start, Write(data, size));
+        }
+        if (older_end > end) {
+            size_t size = older_end - end;
+            void *data = malloc(size);
+            std::memcpy(data, older_data + (end - older_start), size);
+            older = write_buffer->emplace(end, Write(data, size)).first;
+        }
+        free(older_data);
+    }
+    write_buffer->emplace(start, write);
+}
@@ -0,0 +1,73 @@
+#include "include/reader_bitmap_table.h"
+
+namespace {
+
+uint64_t SlotBit(uint32_t slot) {
+    return uint64_t{1} << (slot % 64);
+}
+
+}
+
+ReaderBitmapTable::ReaderBitmapTable(size_t stripes) {
+    size_t size = 1;
+    while (size < stripes) {
+        size <<= 1;
+    }
+    stripes_ = std::vector<Stripe>(size);
+    stripe_mask_ = size - 1;
+}
+
+bool ReaderBitmapTable::AcquireWrite(ReaderBitmap &entry, uint32_t slot) {
+    uint64_t owner = 0;
+    if (!entry.owner_.compare_exchange_strong(owner, slot + 1)) {
+        // Readers that showed up after we became the writer are waiting on us
+        return owner == slot + 1;
+    }
+
+    // Check for read conflicts - Writer loses
+    for (size_t word = 0; word < entry.readers_.size(); word++) {
+        uint64_t readers = entry.readers_[word].load();
+        if (word == slot / 64) {
+            readers &= ~SlotBit(slot);
+        }
+        if (readers != 0) {
+            entry.owner_.store(0);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* The read bit is published before looking at the owner and writers publish ownership before looking at readers, so at
+ * least one side always sees the other.
+ */
+bool ReaderBitmapTable::AcquireRead(ReaderBitmap &entry, uint32_t slot) {
+    auto &reader_word = entry.readers_[slot / 64];
+    bool was_reader = (reader_word.fetch_or(SlotBit(slot)) & SlotBit(slot)) != 0;
+
+    while (true) {
+        uint64_t owner = entry.owner_.load();
+        if (owner == 0 || owner == slot + 1) {
+            return true;
+        }
+        if (!WaitForWriter(slot, owner - 1, [&] { return entry.owner_.load() == owner; })) {
+            // We were aborted while stalled
+            if (!was_reader) {
+                reader_word.fetch_and(~SlotBit(slot));
+            }
+            return false;
+        }
+    }
+}
+
+void ReaderBitmapTable::ReleaseWrite(ReaderBitmap &entry, uint32_t slot, bool committed) {
+    uint64_t owner = slot + 1;
+    if (committed && entry.owner_.load() == owner) {
+        entry.version_.fetch_add(1);
+    }
+    entry.owner_.compare_exchange_strong(owner, 0);
+}
+
+void ReaderBitmapTable::ReleaseRead(ReaderBitmap &entry, uint32_t slot) {
+    entry.readers_[slot / 64].fetch_and(~SlotBit(slot));
+}
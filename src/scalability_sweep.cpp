@@ -0,0 +1,362 @@
+#include "include/scalability_sweep.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "include/atomically.h"
+#include "include/random.h"
+#include "include/simulator_main.h"
+#include "include/transaction.h"
+
+static constexpr size_t SWEEP_READS = 8;
+static constexpr size_t SWEEP_WRITES = 4;
+static constexpr double SVG_WIDTH = 720;
+static constexpr double SVG_HEIGHT = 480;
+static constexpr double SVG_MARGIN = 64;
+static constexpr double SVG_LEGEND_WIDTH = 240;
+
+namespace {
+
+struct SweepWorkload {
+    const char *name_;
+    std::function<void(Transaction *, std::vector<double> *)> body_;
+};
+
+struct SweepConfiguration {
+    const char *name_;
+    bool use_lazy_versioning_;
+    bool use_pessimistic_conflict_detection_;
+};
+
+/** a plotted metric, picked out of a point */
+struct SweepMetric {
+    const char *name_;
+    const char *label_;
+    SweepEstimate SweepPoint::*estimate_;
+};
+
+const std::array<SweepConfiguration, 3> SWEEP_CONFIGURATIONS = {{
+        {"lazy-pessimistic", true, true},
+        {"lazy-optimistic", true, false},
+        {"eager-pessimistic", false, true},
+}};
+
+const std::array<SweepMetric, 4> SWEEP_METRICS = {{
+        {"throughput", "committed transactions per time unit", &SweepPoint::throughput_},
+        {"speedup", "speedup over one thread", &SweepPoint::speedup_},
+        {"efficiency", "parallel efficiency", &SweepPoint::efficiency_},
+        {"aborts", "aborts per attempt", &SweepPoint::abort_rate_},
+}};
+
+const std::array<const char *, 3> SERIES_COLORS = {"#1f77b4", "#d62728", "#2ca02c"};
+const std::array<const char *, 4> SERIES_DASHES = {"", "8,4", "2,3", "10,3,2,3"};
+
+std::vector<SweepWorkload> SweepWorkloads() {
+    return {
+            {"read-only", [](Transaction *transaction, std::vector<double> *accounts) {
+                double sum = 0;
+                for (size_t i = 0; i < SWEEP_READS; i++) {
+                    sum += transaction->Load(&(*accounts)[Random::Uniform(accounts->size())]);
+                }
+                (void) sum;
+            }},
+            {"write-only", [](Transaction *transaction, std::vector<double> *accounts) {
+                for (size_t i = 0; i < SWEEP_WRITES; i++) {
+                    transaction->Store(&(*accounts)[Random::Uniform(accounts->size())], static_cast<double>(i));
+                }
+            }},
+            {"read-write", [](Transaction *transaction, std::vector<double> *accounts) {
+                size_t from = Random::Uniform(accounts->size());
+                size_t to = (from + 1 + Random::Uniform(accounts->size() - 1)) % accounts->size();
+                double amount = Random::UniformDouble();
+                transaction->Store(&(*accounts)[from], transaction->Load(&(*accounts)[from]) - amount);
+                transaction->Store(&(*accounts)[to], transaction->Load(&(*accounts)[to]) + amount);
+            }},
+    };
+}
+
+/**
+ * Run transactions_per_thread transactions on each of threads threads
+ *
+ * @return aborts and time taken
+ */
+TransactionRunDetails RunSweepPoint(TransactionManager *transaction_manager, VirtualTimeScheduler *scheduler,
+                                    const SweepWorkload &workload, std::vector<double> *accounts, size_t threads,
+                                    size_t transactions_per_thread) {
+    std::vector<size_t> thread_aborts(threads, 0);
+    uint64_t first_stream = Random::ReserveStreams(threads);
+    std::vector<std::function<void()>> bodies;
+    bodies.reserve(threads);
+    for (size_t thread = 0; thread < threads; thread++) {
+        bodies.emplace_back([&, thread] {
+            Random::SetStream(first_stream + thread);
+            for (size_t i = 0; i < transactions_per_thread; i++) {
+                Atomically(transaction_manager,
+                           [&](Transaction &transaction) { workload.body_(&transaction, accounts); },
+                           RetryPolicy(), [&](const Transaction &) { thread_aborts[thread]++; });
+            }
+        });
+    }
+
+    size_t time;
+    if (scheduler != nullptr) {
+        time = scheduler->Run(bodies);
+    } else {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> host_threads;
+        host_threads.reserve(threads);
+        for (auto &body : bodies) {
+            host_threads.emplace_back(body);
+        }
+        for (auto &host_thread : host_threads) {
+            host_thread.join();
+        }
+        time = static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() - start).count());
+    }
+
+    size_t aborts = 0;
+    for (auto thread_abort : thread_aborts) {
+        aborts += thread_abort;
+    }
+    return {aborts, std::max<size_t>(time, 1)};
+}
+
+/**
+ * Two sided 95% critical value of the Student t distribution
+ *
+ * @param degrees_of_freedom degrees of freedom, at least 1
+ */
+double StudentT95(size_t degrees_of_freedom) {
+    static const std::array<double, 30> CRITICAL_VALUES = {
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (degrees_of_freedom <= CRITICAL_VALUES.size()) {
+        return CRITICAL_VALUES[degrees_of_freedom - 1];
+    }
+    return 1.960;
+}
+
+std::string PlotPath(const std::string &prefix, const std::string &workload, const std::string &metric) {
+    return prefix + "-" + workload + "-" + metric + ".svg";
+}
+
+void WriteCsv(const std::string &path, const std::vector<SweepPoint> &points, const char *throughput_unit) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot write sweep results to " + path);
+    }
+    out << "configuration,workload,accounts,threads,throughput_unit,throughput,throughput_ci,speedup,speedup_ci,"
+           "efficiency,efficiency_ci,abort_rate,abort_rate_ci" << std::endl;
+    out << std::setprecision(6);
+    for (const auto &point : points) {
+        out << point.configuration_ << "," << point.workload_ << "," << point.accounts_ << "," << point.threads_
+            << "," << throughput_unit << "," << point.throughput_.mean_ << "," << point.throughput_.interval_ << ","
+            << point.speedup_.mean_ << "," << point.speedup_.interval_ << "," << point.efficiency_.mean_ << ","
+            << point.efficiency_.interval_ << "," << point.abort_rate_.mean_ << "," << point.abort_rate_.interval_
+            << std::endl;
+    }
+}
+
+/**
+ * Plot a metric of a workload against threads, one series per configuration and account pool with 95% confidence
+ * interval error bars. Speedup plots get the ideal linear speedup as a reference.
+ */
+void WritePlot(const std::string &path, const std::vector<SweepPoint> &points, const std::string &workload,
+               const SweepMetric &metric, const std::vector<size_t> &contention_accounts, size_t max_threads) {
+    double max_value = metric.estimate_ == &SweepPoint::speedup_ ? static_cast<double>(max_threads) : 0;
+    for (const auto &point : points) {
+        if (point.workload_ == workload) {
+            const auto &estimate = point.*metric.estimate_;
+            max_value = std::max(max_value, estimate.mean_ + estimate.interval_);
+        }
+    }
+    if (max_value <= 0) {
+        max_value = 1;
+    }
+    double plot_width = SVG_WIDTH - 2 * SVG_MARGIN - SVG_LEGEND_WIDTH;
+    double plot_height = SVG_HEIGHT - 2 * SVG_MARGIN;
+    double x_span = static_cast<double>(std::max<size_t>(max_threads - 1, 1));
+    auto x_of = [&](double threads) { return SVG_MARGIN + (threads - 1) / x_span * plot_width; };
+    auto y_of = [&](double value) { return SVG_HEIGHT - SVG_MARGIN - value / max_value * plot_height; };
+
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot write sweep plot to " + path);
+    }
+    out << std::fixed << std::setprecision(1);
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << SVG_WIDTH << "\" height=\"" << SVG_HEIGHT
+        << "\" font-family=\"sans-serif\" font-size=\"12\">" << std::endl;
+    out << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>" << std::endl;
+    out << "<text x=\"" << SVG_WIDTH / 2 << "\" y=\"24\" text-anchor=\"middle\" font-size=\"16\">" << workload << ": "
+        << metric.label_ << "</text>" << std::endl;
+
+    // Axes with five ticks each
+    double x_axis = SVG_HEIGHT - SVG_MARGIN;
+    out << "<line x1=\"" << SVG_MARGIN << "\" y1=\"" << x_axis << "\" x2=\"" << SVG_MARGIN + plot_width
+        << "\" y2=\"" << x_axis << "\" stroke=\"black\"/>" << std::endl;
+    out << "<line x1=\"" << SVG_MARGIN << "\" y1=\"" << SVG_MARGIN << "\" x2=\"" << SVG_MARGIN << "\" y2=\""
+        << x_axis << "\" stroke=\"black\"/>" << std::endl;
+    for (size_t tick = 0; tick <= 4; tick++) {
+        double value = max_value * static_cast<double>(tick) / 4;
+        double threads = 1 + x_span * static_cast<double>(tick) / 4;
+        out << "<text x=\"" << SVG_MARGIN - 6 << "\" y=\"" << y_of(value) + 4 << "\" text-anchor=\"end\">"
+            << std::setprecision(value < 10 ? 2 : 0) << value << std::setprecision(1) << "</text>" << std::endl;
+        out << "<line x1=\"" << SVG_MARGIN << "\" y1=\"" << y_of(value) << "\" x2=\"" << SVG_MARGIN + plot_width
+            << "\" y2=\"" << y_of(value) << "\" stroke=\"#dddddd\"/>" << std::endl;
+        out << "<text x=\"" << x_of(threads) << "\" y=\"" << x_axis + 18 << "\" text-anchor=\"middle\">"
+            << std::setprecision(0) << threads << std::setprecision(1) << "</text>" << std::endl;
+    }
+    out << "<text x=\"" << SVG_MARGIN + plot_width / 2 << "\" y=\"" << SVG_HEIGHT - 20
+        << "\" text-anchor=\"middle\">threads</text>" << std::endl;
+
+    if (metric.estimate_ == &SweepPoint::speedup_) {
+        out << "<line x1=\"" << x_of(1) << "\" y1=\"" << y_of(1) << "\" x2=\"" << x_of(static_cast<double>(max_threads))
+            << "\" y2=\"" << y_of(static_cast<double>(max_threads))
+            << "\" stroke=\"#999999\" stroke-dasharray=\"1,3\"/>" << std::endl;
+    }
+
+    size_t series = 0;
+    for (size_t configuration = 0; configuration < SWEEP_CONFIGURATIONS.size(); configuration++) {
+        for (size_t pool = 0; pool < contention_accounts.size(); pool++, series++) {
+            const char *color = SERIES_COLORS[configuration % SERIES_COLORS.size()];
+            const char *dash = SERIES_DASHES[pool % SERIES_DASHES.size()];
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(1);
+            for (const auto &point : points) {
+                if (point.workload_ != workload || point.configuration_ != SWEEP_CONFIGURATIONS[configuration].name_ ||
+                    point.accounts_ != contention_accounts[pool]) {
+                    continue;
+                }
+                const auto &estimate = point.*metric.estimate_;
+                double x = x_of(static_cast<double>(point.threads_));
+                line << x << "," << y_of(estimate.mean_) << " ";
+                if (estimate.interval_ > 0) {
+                    out << "<line x1=\"" << x << "\" y1=\"" << y_of(estimate.mean_ - estimate.interval_)
+                        << "\" x2=\"" << x << "\" y2=\"" << y_of(estimate.mean_ + estimate.interval_)
+                        << "\" stroke=\"" << color << "\"/>" << std::endl;
+                }
+                out << "<circle cx=\"" << x << "\" cy=\"" << y_of(estimate.mean_) << "\" r=\"2.5\" fill=\"" << color
+                    << "\"/>" << std::endl;
+            }
+            out << "<polyline fill=\"none\" stroke=\"" << color << "\" stroke-width=\"1.5\" stroke-dasharray=\""
+                << dash << "\" points=\"" << line.str() << "\"/>" << std::endl;
+
+            double legend_y = SVG_MARGIN + static_cast<double>(series) * 18;
+            double legend_x = SVG_WIDTH - SVG_MARGIN - SVG_LEGEND_WIDTH + 24;
+            out << "<line x1=\"" << legend_x << "\" y1=\"" << legend_y << "\" x2=\"" << legend_x + 28 << "\" y2=\""
+                << legend_y << "\" stroke=\"" << color << "\" stroke-width=\"1.5\" stroke-dasharray=\"" << dash
+                << "\"/>" << std::endl;
+            out << "<text x=\"" << legend_x + 34 << "\" y=\"" << legend_y + 4 << "\">"
+                << SWEEP_CONFIGURATIONS[configuration].name_ << ", " << contention_accounts[pool] << " accounts</text>"
+                << std::endl;
+        }
+    }
+    out << "</svg>" << std::endl;
+}
+
+}
+
+std::vector<size_t> SweepThreadCounts(size_t max_threads) {
+    std::vector<size_t> counts;
+    for (size_t threads = 1; threads <= max_threads; threads = threads < 8 ? threads + 1 : threads * 2) {
+        counts.push_back(threads);
+    }
+    if (counts.empty() || counts.back() != max_threads) {
+        counts.push_back(max_threads);
+    }
+    return counts;
+}
+
+SweepEstimate EstimateOf(const std::vector<double> &samples) {
+    SweepEstimate estimate;
+    if (samples.empty()) {
+        return estimate;
+    }
+    for (double sample : samples) {
+        estimate.mean_ += sample;
+    }
+    estimate.mean_ /= static_cast<double>(samples.size());
+    if (samples.size() < 2) {
+        return estimate;
+    }
+    double squares = 0;
+    for (double sample : samples) {
+        squares += (sample - estimate.mean_) * (sample - estimate.mean_);
+    }
+    double deviation = std::sqrt(squares / static_cast<double>(samples.size() - 1));
+    estimate.interval_ = StudentT95(samples.size() - 1) * deviation / std::sqrt(static_cast<double>(samples.size()));
+    return estimate;
+}
+
+std::vector<SweepPoint> RunScalabilitySweep(const SweepConfig &config, const SweepManagerFactory &make_manager,
+                                            VirtualTimeScheduler *scheduler) {
+    size_t max_threads = scheduler != nullptr ? std::min(config.max_threads_, scheduler->GetCores())
+                                              : config.max_threads_;
+    auto thread_counts = SweepThreadCounts(std::max<size_t>(max_threads, 1));
+    const char *throughput_unit = scheduler != nullptr ? "per million cycles" : "per second";
+    auto workloads = SweepWorkloads();
+
+    std::vector<SweepPoint> points;
+    for (const auto &configuration : SWEEP_CONFIGURATIONS) {
+        auto transaction_manager = make_manager(configuration.use_lazy_versioning_,
+                                                configuration.use_pessimistic_conflict_detection_);
+        for (const auto &workload : workloads) {
+            for (size_t accounts : config.contention_accounts_) {
+                std::cout << "Sweep " << configuration.name_ << ", " << workload.name_ << ", " << accounts
+                          << " accounts" << std::endl;
+                std::vector<double> pool(std::max<size_t>(accounts, 2), 0);
+
+                std::vector<double> single_thread_throughput;
+                for (size_t threads : thread_counts) {
+                    std::vector<double> throughput;
+                    std::vector<double> speedup;
+                    std::vector<double> efficiency;
+                    std::vector<double> abort_rate;
+                    for (size_t repeat = 0; repeat < config.repeats_; repeat++) {
+                        auto details = RunSweepPoint(transaction_manager.get(), scheduler, workload, &pool, threads,
+                                                     config.transactions_per_thread_);
+                        double commits = static_cast<double>(threads * config.transactions_per_thread_);
+                        throughput.push_back(commits * 1e6 / static_cast<double>(details.time_taken_));
+                        abort_rate.push_back(static_cast<double>(details.aborts_) /
+                                             (static_cast<double>(details.aborts_) + commits));
+                        // Repeats are paired with the single thread repeat of the same index
+                        if (threads == 1) {
+                            single_thread_throughput.push_back(throughput.back());
+                        }
+                        speedup.push_back(throughput.back() / single_thread_throughput[repeat]);
+                        efficiency.push_back(speedup.back() / static_cast<double>(threads));
+                    }
+
+                    SweepPoint point{configuration.name_, workload.name_, accounts, threads, EstimateOf(throughput),
+                                     EstimateOf(speedup), EstimateOf(efficiency), EstimateOf(abort_rate)};
+                    std::cout << "Threads: " << threads << ", throughput " << throughput_unit << ": "
+                              << point.throughput_.mean_ << " +/- " << point.throughput_.interval_ << ", speedup: "
+                              << point.speedup_.mean_ << " +/- " << point.speedup_.interval_ << ", efficiency: "
+                              << point.efficiency_.mean_ << ", abort rate: " << point.abort_rate_.mean_ << std::endl;
+                    points.push_back(std::move(point));
+                }
+            }
+        }
+    }
+
+    WriteCsv(config.output_prefix_ + ".csv", points, throughput_unit);
+    for (const auto &workload : workloads) {
+        for (const auto &metric : SWEEP_METRICS) {
+            WritePlot(PlotPath(config.output_prefix_, workload.name_, metric.name_), points, workload.name_, metric,
+                      config.contention_accounts_, thread_counts.back());
+        }
+    }
+    std::cout << "Wrote " << points.size() << " sweep points to " << config.output_prefix_ << ".csv and plots to "
+              << PlotPath(config.output_prefix_, "WORKLOAD", "METRIC") << std::endl;
+    return points;
+}
@@ -0,0 +1,102 @@
+#include "include/shared_memory_region.h"
+
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+#include "include/invalid_state_exception.h"
+
+static void ThrowErrno(const std::string &what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+SharedMemoryRegion::SharedMemoryRegion(const std::string &name, size_t data_size, size_t orecs) : name_(name) {
+    size_t orec_count = OrecTable::RoundOrecCount(orecs);
+    size_t size = Align(sizeof(Header)) + Align(sizeof(SlotTable::State)) + Align(orec_count * sizeof(Orec)) +
+                  data_size;
+
+    fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    creator_ = fd_ >= 0;
+    if (!creator_) {
+        if (errno != EEXIST) {
+            ThrowErrno("shm_open " + name);
+        }
+        fd_ = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd_ < 0) {
+            ThrowErrno("shm_open " + name);
+        }
+    }
+
+    if (creator_) {
+        if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+            ThrowErrno("truncate " + name);
+        }
+        mapped_size_ = size;
+    } else {
+        // The creator may not have sized the segment yet
+        struct stat stat_buf{};
+        do {
+            if (fstat(fd_, &stat_buf) != 0) {
+                ThrowErrno("stat " + name);
+            }
+            if (stat_buf.st_size == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        } while (stat_buf.st_size == 0);
+        mapped_size_ = static_cast<size_t>(stat_buf.st_size);
+    }
+
+    void *base = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED) {
+        ThrowErrno("mmap " + name);
+    }
+    base_ = static_cast<char *>(base);
+    header_ = reinterpret_cast<Header *>(base_);
+
+    if (creator_) {
+        // ftruncate zeroed the segment, which leaves every orec free and the data zeroed
+        new (header_) Header{};
+        header_->data_size_ = data_size;
+        header_->orec_count_ = orec_count;
+        Locate(orec_count);
+        new (slots_) SlotTable::State{};
+        SlotTable::InitializeState(slots_);
+        // Attaching processes wait for the magic, so it is published last
+        header_->magic_.store(MAGIC, std::memory_order_release);
+        return;
+    }
+
+    while (header_->magic_.load(std::memory_order_acquire) != MAGIC) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (header_->data_size_ != data_size || header_->orec_count_ != orec_count || mapped_size_ != size) {
+        munmap(base_, mapped_size_);
+        close(fd_);
+        throw InvalidStateException("Shared memory segment was created with a different data size or orec count.");
+    }
+    Locate(orec_count);
+}
+
+SharedMemoryRegion::~SharedMemoryRegion() {
+    munmap(base_, mapped_size_);
+    close(fd_);
+}
+
+void SharedMemoryRegion::Unlink(const std::string &name) {
+    shm_unlink(name.c_str());
+}
+
+void SharedMemoryRegion::Locate(size_t orec_count) {
+    char *slots = base_ + Align(sizeof(Header));
+    char *orecs = slots + Align(sizeof(SlotTable::State));
+    slots_ = reinterpret_cast<SlotTable::State *>(slots);
+    orecs_ = reinterpret_cast<Orec *>(orecs);
+    data_ = orecs + Align(orec_count * sizeof(Orec));
+}
@@ -1,13 +1,31 @@
 #include "include/simulator_main.h"
 
+#include <array>
 #include <iostream>
 #include <thread>
 #include <future>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "include/transaction_manager.h"
 #include "include/transaction.h"
-#include "include/abort_exception.h"
+#include "include/account_layout.h"
+#include "include/atomically.h"
+#include "include/conflict_aware_scheduler.h"
+#include "include/coroutine_scheduler.h"
+#include "include/perf_counters.h"
+#include "include/persistent_region.h"
+#include "include/profiler.h"
+#include "include/random.h"
+#include "include/scalability_sweep.h"
+#include "include/shared_memory_region.h"
+#include "include/stamp_benchmarks.h"
+#include "include/tmap.h"
+#include "include/tqueue.h"
 #include "include/transaction_memory_test.h"
+#include "include/tracer.h"
+#include "include/tvector.h"
+#include "include/virtual_time_scheduler.h"
 
 static constexpr int READ_CONCURRENT_TRANSACTIONS = 1000;
 static constexpr int READ_ITERATIONS = 10;
@@ -15,20 +33,42 @@ static constexpr int WRITE_CONCURRENT_TRANSACTIONS = 20;
 static constexpr int WRITE_ITERATIONS = 1000;
 static constexpr int READ_WRITE_CONCURRENT_TRANSACTIONS = 20;
 static constexpr int READ_WRITE_ITERATIONS = 1000;
+static constexpr int CONTAINER_CONCURRENT_TRANSACTIONS = 20;
+static constexpr int CONTAINER_ITERATIONS = 1000;
+static constexpr int CONTAINER_OPERATIONS = 10;
+static constexpr int CONTAINER_KEYS = 4096;
+static constexpr int HOT_COUNTERS = 4;
+static constexpr size_t ACCOUNT_GENERATION_CHUNK = 4096;
+static constexpr int DURABLE_ITERATIONS = 100;
+static constexpr int COROUTINE_CONCURRENT_TRANSACTIONS = 256;
+static constexpr int COROUTINE_ITERATIONS = 20;
+static constexpr int ADAPTIVE_PHASES = 4;
+static constexpr int ADAPTIVE_PHASE_ITERATIONS = 200;
+static constexpr size_t LARGE_KEY_SPACE_ACCOUNTS = 10000000;
+static constexpr size_t LARGE_KEY_SPACE_AUDITED_ACCOUNTS = 1000000;
+static constexpr int LARGE_KEY_SPACE_CONCURRENT_TRANSACTIONS = 20;
+static constexpr int LARGE_KEY_SPACE_ITERATIONS = 500;
+static constexpr int LARGE_KEY_SPACE_TRANSFERS = 8;
+static constexpr size_t SHARED_MEMORY_ACCOUNTS = 64;
+static constexpr size_t SHARED_MEMORY_ORECS = 1 << 16;
+static constexpr size_t SHARED_MEMORY_DEFAULT_PROCESSES = 4;
+static constexpr int SHARED_MEMORY_CONCURRENT_TRANSACTIONS = 8;
+static constexpr int SHARED_MEMORY_ITERATIONS = 200;
 
-int RunTransaction(TransactionManager *transaction_manager, const std::function<void(Transaction *)> &func) {
+static std::unique_ptr<VirtualTimeScheduler> simulation_scheduler;
+static AccountLayout account_layout = AccountLayout::MAP;
+static bool use_conflict_aware_scheduling = false;
+
+int RunTransaction(TransactionManager *transaction_manager, const std::function<void(Transaction *)> &func,
+                   const std::function<void(const Transaction &)> &on_abort) {
     int aborts = 0;
-    bool success = false;
-    while (!success) {
-        Transaction transaction = transaction_manager->XBegin();
-        try {
-            func(&transaction);
-            transaction.XEnd();
-            success = true;
-        } catch (const AbortException &e) {
-            aborts++;
-        }
-    }
+    Atomically(transaction_manager, [&](Transaction &transaction) { func(&transaction); }, RetryPolicy(),
+               [&](const Transaction &transaction) {
+                   aborts++;
+                   if (on_abort) {
+                       on_abort(transaction);
+                   }
+               });
     return aborts;
 }
 
@@ -41,9 +81,13 @@ RunAsyncTransactions(TransactionManager *transaction_manager, std::vector<std::f
     for (int i = 0; i < iterations; i++) {
         std::vector<std::future<int>> futures;
         futures.reserve(funcs.size());
+        uint64_t first_stream = Random::ReserveStreams(funcs.size());
         auto start = std::chrono::high_resolution_clock::now();
-        for (const auto &func : funcs) {
-            futures.push_back(std::async(RunTransaction, transaction_manager, func));
+        for (size_t f = 0; f < funcs.size(); f++) {
+            futures.push_back(std::async([transaction_manager, &func = funcs[f], stream = first_stream + f] {
+                Random::SetStream(stream);
+                return RunTransaction(transaction_manager, func);
+            }));
         }
 
 
@@ -57,40 +101,212 @@ RunAsyncTransactions(TransactionManager *transaction_manager, std::vector<std::f
     return {aborts, time};
 }
 
+TransactionRunDetails
+RunSimulatedTransactions(TransactionManager *transaction_manager, VirtualTimeScheduler *scheduler,
+                         const std::vector<std::function<void(Transaction *)>> &funcs, size_t iterations) {
+    size_t cores = std::min(scheduler->GetCores(), funcs.size());
+    std::vector<size_t> core_aborts(cores, 0);
+    uint64_t first_stream = 0;
+    std::vector<std::function<void()>> bodies;
+    bodies.reserve(cores);
+    for (size_t core = 0; core < cores; core++) {
+        bodies.emplace_back([&, core] {
+            for (size_t i = core; i < funcs.size(); i += cores) {
+                Random::SetStream(first_stream + i);
+                core_aborts[core] += RunTransaction(transaction_manager, funcs[i]);
+            }
+        });
+    }
+
+    size_t aborts = 0;
+    size_t cycles = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        first_stream = Random::ReserveStreams(funcs.size());
+        cycles += scheduler->Run(bodies);
+    }
+    for (auto core_abort : core_aborts) {
+        aborts += core_abort;
+    }
+    return {aborts, cycles};
+}
+
+TransactionRunDetails
+RunScheduledTransactions(TransactionManager *transaction_manager, ConflictAwareScheduler *scheduler,
+                         const std::vector<std::function<void(Transaction *)>> &funcs, size_t iterations) {
+    size_t aborts = 0;
+    size_t time = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        auto queues = scheduler->Assign(funcs.size());
+        std::vector<size_t> worker_aborts(queues.size(), 0);
+        uint64_t first_stream = Random::ReserveStreams(funcs.size());
+        std::vector<std::function<void()>> bodies;
+        bodies.reserve(queues.size());
+        for (size_t worker = 0; worker < queues.size(); worker++) {
+            bodies.emplace_back([&, worker] {
+                for (auto site : queues[worker]) {
+                    Random::SetStream(first_stream + site);
+                    worker_aborts[worker] += RunTransaction(
+                            transaction_manager,
+                            [&](Transaction *transaction) {
+                                funcs[site](transaction);
+                                scheduler->RecordAccesses(site, *transaction);
+                            },
+                            [&](const Transaction &transaction) { scheduler->RecordAbort(site, transaction); });
+                }
+            });
+        }
+
+        if (simulation_scheduler != nullptr) {
+            time += simulation_scheduler->Run(bodies);
+        } else {
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> threads;
+            threads.reserve(bodies.size());
+            for (auto &body : bodies) {
+                threads.emplace_back(body);
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            time += static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count());
+        }
+        for (auto worker_abort : worker_aborts) {
+            aborts += worker_abort;
+        }
+    }
+    return {aborts, time};
+}
+
+TransactionRunDetails
+RunCoroutineTransactions(TransactionManager *transaction_manager, const std::vector<CoroutineScheduler::Body> &bodies,
+                         size_t workers, size_t iterations) {
+    CoroutineScheduler scheduler(transaction_manager, workers);
+    size_t aborts = 0;
+    size_t time = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        aborts += scheduler.Run(bodies);
+        time += static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() - start).count());
+    }
+    return {aborts, time};
+}
+
+/**
+ * Run a workload on host threads, or on simulated cores when a virtual time scheduler was requested
+ */
+TransactionRunDetails RunWorkload(TransactionManager *transaction_manager,
+                                  const std::vector<std::function<void(Transaction *)>> &funcs, size_t iterations) {
+    transaction_manager->ResetHtmStats();
+    if (use_conflict_aware_scheduling) {
+        size_t workers = simulation_scheduler != nullptr ? simulation_scheduler->GetCores()
+                                                         : std::max(1u, std::thread::hardware_concurrency());
+        ConflictAwareScheduler scheduler(std::min(workers, funcs.size()));
+        auto details = RunScheduledTransactions(transaction_manager, &scheduler, funcs, iterations);
+        std::cout << "Sites queued behind predicted conflicts: " << scheduler.GetSerializedSites() << std::endl;
+        return details;
+    }
+    if (simulation_scheduler != nullptr) {
+        return RunSimulatedTransactions(transaction_manager, simulation_scheduler.get(), funcs, iterations);
+    }
+    return RunAsyncTransactions(transaction_manager, funcs, iterations);
+}
+
+void PrintRunDetails(TransactionManager *transaction_manager, const TransactionRunDetails &details) {
+    std::cout << "Aborts: " << details.aborts_ << std::endl;
+    if (transaction_manager->IsHtmEmulationEnabled()) {
+        auto stats = transaction_manager->GetHtmStats();
+        std::cout << "HTM commits: " << stats.hardware_commits_ << ", software fallback commits: "
+                  << stats.software_commits_ << ", capacity aborts: " << stats.capacity_aborts_
+                  << ", conflict aborts: " << stats.conflict_aborts_ << std::endl;
+    }
+    if (simulation_scheduler != nullptr) {
+        std::cout << "Time (virtual cycles): " << details.time_taken_ << std::endl;
+    } else {
+        std::cout << "Time (micro seconds): " << details.time_taken_ << std::endl;
+    }
+}
+
 /*
  * Adapted from https://stackoverflow.com/questions/440133/how-do-i-create-a-random-alpha-numeric-string-in-c to generate random map keys
  */
-std::string RandomString() {
+std::string RandomString(Xoshiro256 *generator) {
     size_t length = 100;
-    auto randchar = []() -> char {
+    auto randchar = [generator]() -> char {
         const char charset[] =
                 "0123456789"
                 "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
                 "abcdefghijklmnopqrstuvwxyz";
         const size_t max_index = (sizeof(charset) - 1);
-        return charset[rand() % max_index];
+        return charset[generator->Uniform(max_index)];
     };
     std::string str(length, 0);
     std::generate_n(str.begin(), length, randchar);
     return str;
 }
 
+double RandomFloat(Xoshiro256 *generator) {
+    return generator->UniformDouble() * 10000.0;
+}
+
 double RandomFloat() {
-    return static_cast<double>(rand()) / (static_cast<double>(RAND_MAX / 10000.0));
+    return RandomFloat(&Random::Generator());
 }
 
 
+void ReportProfile(const std::string &configuration) {
+    if (!Profiler::ENABLED) {
+        return;
+    }
+    std::cout << std::endl;
+    Profiler::Report(std::cout, configuration);
+    Profiler::Reset();
+}
+
 std::unordered_map<std::string, double> GetTestAccounts(size_t size) {
-    std::unordered_map<std::string, double> map;
+    // Every chunk has its own generator, so the accounts only depend on the seed and not on the number of threads
+    size_t chunks = (size + ACCOUNT_GENERATION_CHUNK - 1) / ACCOUNT_GENERATION_CHUNK;
+    uint64_t first_stream = Random::ReserveStreams(chunks + 1);
+    std::vector<std::vector<std::pair<std::string, double>>> generated(chunks);
+    auto generate = [&](size_t worker, size_t workers) {
+        for (size_t chunk = worker; chunk < chunks; chunk += workers) {
+            Xoshiro256 generator(Random::GetSeed(), first_stream + chunk);
+            size_t chunk_size = std::min(ACCOUNT_GENERATION_CHUNK, size - chunk * ACCOUNT_GENERATION_CHUNK);
+            generated[chunk].reserve(chunk_size);
+            for (size_t i = 0; i < chunk_size; i++) {
+                auto key = RandomString(&generator);
+                generated[chunk].emplace_back(std::move(key), RandomFloat(&generator));
+            }
+        }
+    };
+    size_t workers = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), chunks));
+    std::vector<std::thread> threads;
+    for (size_t worker = 1; worker < workers; worker++) {
+        threads.emplace_back(generate, worker, workers);
+    }
+    generate(0, workers);
+    for (auto &thread : threads) {
+        thread.join();
+    }
 
+    std::unordered_map<std::string, double> map;
+    map.reserve(size);
+    for (auto &chunk : generated) {
+        for (auto &account : chunk) {
+            map.emplace(std::move(account.first), account.second);
+        }
+    }
+    // Only reached if two keys collide
+    Xoshiro256 generator(Random::GetSeed(), first_stream + chunks);
     while (map.size() < size) {
-        map[RandomString()] = RandomFloat();
+        map[RandomString(&generator)] = RandomFloat(&generator);
     }
 
     return map;
 }
 
-std::vector<double *> GetAccountAddresses(std::unordered_map<std::string, double> map) {
+std::vector<double *> GetAccountAddresses(std::unordered_map<std::string, double> &map) {
     std::vector<double *> res;
     res.reserve(map.size());
     for (auto &account : map) {
@@ -101,8 +317,8 @@ std::vector<double *> GetAccountAddresses(std::unordered_map<std::string, double
 
 void ReadOnlyNonConflicting(TransactionManager *transaction_manager) {
     std::cout << "Read only non conflicting" << std::endl;
-    auto accounts_map = GetTestAccounts(2 * READ_CONCURRENT_TRANSACTIONS);
-    auto accounts = GetAccountAddresses(accounts_map);
+    AccountStorage storage(GetTestAccounts(2 * READ_CONCURRENT_TRANSACTIONS), account_layout);
+    auto accounts = storage.GetAddresses();
     std::vector<std::function<void(Transaction *)>> funcs;
     funcs.reserve(READ_CONCURRENT_TRANSACTIONS);
     size_t len = accounts.size();
@@ -113,16 +329,13 @@ void ReadOnlyNonConflicting(TransactionManager *transaction_manager) {
         });
     }
 
-    auto[aborts, time] = RunAsyncTransactions(transaction_manager, funcs, READ_ITERATIONS);
-
-    std::cout << "Aborts: " << aborts << std::endl;
-    std::cout << "Time (micro seconds): " << time << std::endl;
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, READ_ITERATIONS));
 }
 
 void ReadOnlyConflicting(TransactionManager *transaction_manager) {
     std::cout << "Read only conflicting" << std::endl;
-    auto accounts_map = GetTestAccounts(2 * READ_CONCURRENT_TRANSACTIONS);
-    auto accounts = GetAccountAddresses(accounts_map);
+    AccountStorage storage(GetTestAccounts(2 * READ_CONCURRENT_TRANSACTIONS), account_layout);
+    auto accounts = storage.GetAddresses();
     std::vector<std::function<void(Transaction *)>> funcs;
     funcs.reserve(READ_CONCURRENT_TRANSACTIONS);
     for (size_t i = 0; i < accounts.size() - 1; i += 2) {
@@ -133,16 +346,13 @@ void ReadOnlyConflicting(TransactionManager *transaction_manager) {
         });
     }
 
-    auto[aborts, time] = RunAsyncTransactions(transaction_manager, funcs, READ_ITERATIONS);
-
-    std::cout << "Aborts: " << aborts << std::endl;
-    std::cout << "Time (micro seconds): " << time << std::endl;
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, READ_ITERATIONS));
 }
 
 void WriteOnlyNonConflicting(TransactionManager *transaction_manager) {
     std::cout << "Write only non conflicting" << std::endl;
-    auto accounts_map = GetTestAccounts(2 * WRITE_CONCURRENT_TRANSACTIONS);
-    auto accounts = GetAccountAddresses(accounts_map);
+    AccountStorage storage(GetTestAccounts(2 * WRITE_CONCURRENT_TRANSACTIONS), account_layout);
+    auto accounts = storage.GetAddresses();
     std::vector<std::function<void(Transaction *)>> funcs;
     funcs.reserve(WRITE_CONCURRENT_TRANSACTIONS);
     for (size_t i = 0; i < accounts.size() - 1; i += 2) {
@@ -152,16 +362,13 @@ void WriteOnlyNonConflicting(TransactionManager *transaction_manager) {
         });
     }
 
-    auto[aborts, time] = RunAsyncTransactions(transaction_manager, funcs, WRITE_ITERATIONS);
-
-    std::cout << "Aborts: " << aborts << std::endl;
-    std::cout << "Time (micro seconds): " << time << std::endl;
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, WRITE_ITERATIONS));
 }
 
 void WriteOnlyConflicting(TransactionManager *transaction_manager) {
     std::cout << "Write only conflicting" << std::endl;
-    auto accounts_map = GetTestAccounts(2 * WRITE_CONCURRENT_TRANSACTIONS);
-    auto accounts = GetAccountAddresses(accounts_map);
+    AccountStorage storage(GetTestAccounts(2 * WRITE_CONCURRENT_TRANSACTIONS), account_layout);
+    auto accounts = storage.GetAddresses();
     std::vector<std::function<void(Transaction *)>> funcs;
     funcs.reserve(WRITE_CONCURRENT_TRANSACTIONS);
     for (size_t i = 0; i < accounts.size() - 1; i += 2) {
@@ -172,42 +379,44 @@ void WriteOnlyConflicting(TransactionManager *transaction_manager) {
         });
     }
 
-    auto[aborts, time] = RunAsyncTransactions(transaction_manager, funcs, WRITE_ITERATIONS);
-
-    std::cout << "Aborts: " << aborts << std::endl;
-    std::cout << "Time (micro seconds): " << time << std::endl;
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, WRITE_ITERATIONS));
 }
 
-void ReadWriteNonConflicting(TransactionManager *transaction_manager) {
-    std::cout << "Read write non conflicting" << std::endl;
-
-    auto accounts_map = GetTestAccounts(2 * READ_WRITE_CONCURRENT_TRANSACTIONS);
-    auto accounts = GetAccountAddresses(accounts_map);
+/**
+ * @param accounts account balances
+ * @return one transaction per pair of neighbouring accounts, moving money between the pair
+ */
+std::vector<std::function<void(Transaction *)>> NonConflictingTransfers(const std::vector<double *> &accounts) {
     std::vector<std::function<void(Transaction *)>> funcs;
-    funcs.reserve(READ_WRITE_CONCURRENT_TRANSACTIONS);
+    funcs.reserve(accounts.size() / 2);
     for (size_t i = 0; i < accounts.size() - 1; i += 2) {
-        funcs.emplace_back([=](Transaction *transaction) {
+        funcs.emplace_back([a = accounts[i], b = accounts[i + 1]](Transaction *transaction) {
             double diff = RandomFloat();
 
-            auto a_balance = transaction->Load(accounts[i]);
-            transaction->Store(accounts[i], a_balance - diff);
+            auto a_balance = transaction->Load(a);
+            transaction->Store(a, a_balance - diff);
 
-            auto b_balance = transaction->Load(accounts[i + 1]);
-            transaction->Store(accounts[i + 1], b_balance + diff);
+            auto b_balance = transaction->Load(b);
+            transaction->Store(b, b_balance + diff);
         });
     }
+    return funcs;
+}
+
+void ReadWriteNonConflicting(TransactionManager *transaction_manager) {
+    std::cout << "Read write non conflicting" << std::endl;
 
-    auto[aborts, time] = RunAsyncTransactions(transaction_manager, funcs, READ_WRITE_ITERATIONS);
+    AccountStorage storage(GetTestAccounts(2 * READ_WRITE_CONCURRENT_TRANSACTIONS), account_layout);
+    auto funcs = NonConflictingTransfers(storage.GetAddresses());
 
-    std::cout << "Aborts: " << aborts << std::endl;
-    std::cout << "Time (micro seconds): " << time << std::endl;
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, READ_WRITE_ITERATIONS));
 }
 
 void ReadWriteConflicting(TransactionManager *transaction_manager) {
     std::cout << "Read write conflicting" << std::endl;
 
-    auto accounts_map = GetTestAccounts(2 * READ_WRITE_CONCURRENT_TRANSACTIONS);
-    auto accounts = GetAccountAddresses(accounts_map);
+    AccountStorage storage(GetTestAccounts(2 * READ_WRITE_CONCURRENT_TRANSACTIONS), account_layout);
+    auto accounts = storage.GetAddresses();
     std::vector<std::function<void(Transaction *)>> funcs;
     funcs.reserve(READ_WRITE_CONCURRENT_TRANSACTIONS);
     for (size_t i = 0; i < accounts.size() - 1; i += 2) {
@@ -224,10 +433,7 @@ void ReadWriteConflicting(TransactionManager *transaction_manager) {
         });
     }
 
-    auto[aborts, time] = RunAsyncTransactions(transaction_manager, funcs, READ_WRITE_ITERATIONS);
-
-    std::cout << "Aborts: " << aborts << std::endl;
-    std::cout << "Time (micro seconds): " << time << std::endl;
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, READ_WRITE_ITERATIONS));
 }
 
 void EmptyWorkload(TransactionManager *transaction_manager, size_t concurrent_transaction, size_t iterations) {
@@ -239,51 +445,795 @@ void EmptyWorkload(TransactionManager *transaction_manager, size_t concurrent_tr
         funcs.emplace_back([&](Transaction *transaction) {});
     }
 
-    auto[aborts, time] = RunAsyncTransactions(transaction_manager, funcs, iterations);
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, iterations));
+}
+
+void TMapWorkload(TransactionManager *transaction_manager, size_t concurrent_transactions) {
+    std::cout << "TMap with " << concurrent_transactions << " concurrent transactions" << std::endl;
+
+    TMap<int, double> map;
+    for (int key = 0; key < CONTAINER_KEYS; key += 2) {
+        RunTransaction(transaction_manager, [&](Transaction *transaction) { map.Put(transaction, key, RandomFloat()); });
+    }
+    std::vector<std::function<void(Transaction *)>> funcs;
+    funcs.reserve(concurrent_transactions);
+    for (size_t i = 0; i < concurrent_transactions; i++) {
+        funcs.emplace_back([&](Transaction *transaction) {
+            // 80% lookups, 10% inserts and 10% erases
+            for (int op = 0; op < CONTAINER_OPERATIONS; op++) {
+                int key = Random::Uniform(CONTAINER_KEYS);
+                int action = Random::Uniform(10);
+                if (action == 0) {
+                    map.Put(transaction, key, RandomFloat());
+                } else if (action == 1) {
+                    map.Erase(transaction, key);
+                } else {
+                    double value;
+                    map.Get(transaction, key, &value);
+                }
+            }
+        });
+    }
+
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, CONTAINER_ITERATIONS));
+}
+
+void TVectorWorkload(TransactionManager *transaction_manager, size_t concurrent_transactions) {
+    std::cout << "TVector with " << concurrent_transactions << " concurrent transactions" << std::endl;
+
+    TVector<double> vector;
+    RunTransaction(transaction_manager, [&](Transaction *transaction) {
+        for (int i = 0; i < CONTAINER_KEYS; i++) {
+            vector.PushBack(transaction, RandomFloat());
+        }
+    });
+    std::vector<std::function<void(Transaction *)>> funcs;
+    funcs.reserve(concurrent_transactions);
+    for (size_t i = 0; i < concurrent_transactions; i++) {
+        funcs.emplace_back([&](Transaction *transaction) {
+            // Updates of existing elements plus one append per transaction
+            for (int op = 0; op < CONTAINER_OPERATIONS; op++) {
+                size_t index = Random::Uniform(CONTAINER_KEYS);
+                vector.Set(transaction, index, vector.Get(transaction, index) + 1);
+            }
+            vector.PushBack(transaction, RandomFloat());
+        });
+    }
+
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, CONTAINER_ITERATIONS));
+}
+
+void TQueueWorkload(TransactionManager *transaction_manager, size_t concurrent_transactions) {
+    std::cout << "TQueue with " << concurrent_transactions << " concurrent transactions" << std::endl;
 
+    TQueue<double> queue(CONTAINER_KEYS);
+    std::vector<std::function<void(Transaction *)>> funcs;
+    funcs.reserve(concurrent_transactions);
+    for (size_t i = 0; i < concurrent_transactions; i++) {
+        // Alternate producers and consumers, a single transaction does both
+        bool produce = i % 2 == 0;
+        bool consume = i % 2 == 1 || concurrent_transactions == 1;
+        funcs.emplace_back([&, produce, consume](Transaction *transaction) {
+            for (int op = 0; op < CONTAINER_OPERATIONS; op++) {
+                if (produce) {
+                    queue.Enqueue(transaction, RandomFloat());
+                }
+                double value;
+                if (consume) {
+                    queue.Dequeue(transaction, &value);
+                }
+            }
+        });
+    }
+
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, CONTAINER_ITERATIONS));
+}
+
+void ContainerWorkloads(TransactionManager *transaction_manager) {
+    TMapWorkload(transaction_manager, 1);
+    TMapWorkload(transaction_manager, CONTAINER_CONCURRENT_TRANSACTIONS);
+    TVectorWorkload(transaction_manager, 1);
+    TVectorWorkload(transaction_manager, CONTAINER_CONCURRENT_TRANSACTIONS);
+    TQueueWorkload(transaction_manager, 1);
+    TQueueWorkload(transaction_manager, CONTAINER_CONCURRENT_TRANSACTIONS);
+}
+
+void HotCounterWorkload(TransactionManager *transaction_manager) {
+    std::cout << "Hot counters through raw pointers" << std::endl;
+
+    std::array<int64_t, HOT_COUNTERS> counters{};
+    std::vector<std::function<void(Transaction *)>> funcs;
+    funcs.reserve(CONTAINER_CONCURRENT_TRANSACTIONS);
+    for (size_t i = 0; i < CONTAINER_CONCURRENT_TRANSACTIONS; i++) {
+        funcs.emplace_back([&, i](Transaction *transaction) {
+            int64_t total = 0;
+            for (auto &counter : counters) {
+                total += transaction->Load(&counter);
+            }
+            transaction->Store(&counters[i % HOT_COUNTERS], total + 1);
+        });
+    }
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, CONTAINER_ITERATIONS));
+
+    std::cout << "Hot counters through TVars" << std::endl;
+
+    std::array<TVar<int64_t>, HOT_COUNTERS> tvars;
+    funcs.clear();
+    for (size_t i = 0; i < CONTAINER_CONCURRENT_TRANSACTIONS; i++) {
+        funcs.emplace_back([&, i](Transaction *transaction) {
+            int64_t total = 0;
+            for (auto &tvar : tvars) {
+                total += transaction->Load(&tvar);
+            }
+            transaction->Store(&tvars[i % HOT_COUNTERS], total + 1);
+        });
+    }
+    PrintRunDetails(transaction_manager, RunWorkload(transaction_manager, funcs, CONTAINER_ITERATIONS));
+}
+
+/**
+ * Many transactions reading every hot counter and writing one, first with a host thread per transaction and then as
+ * coroutines on one worker per core. Readers that stall on a writer suspend instead of blocking their thread, so the
+ * coroutines keep every in flight transaction without paying for hundreds of threads.
+ */
+void CoroutineStallWorkload(TransactionManager *transaction_manager) {
+    std::cout << "Hot counters with a thread per transaction" << std::endl;
+
+    std::array<int64_t, HOT_COUNTERS> counters{};
+    std::vector<std::function<void(Transaction *)>> funcs;
+    funcs.reserve(COROUTINE_CONCURRENT_TRANSACTIONS);
+    for (size_t i = 0; i < COROUTINE_CONCURRENT_TRANSACTIONS; i++) {
+        funcs.emplace_back([&, i](Transaction *transaction) {
+            int64_t total = 0;
+            for (auto &counter : counters) {
+                total += transaction->Load(&counter);
+            }
+            transaction->Store(&counters[i % HOT_COUNTERS], total + 1);
+        });
+    }
+    PrintRunDetails(transaction_manager, RunAsyncTransactions(transaction_manager, funcs, COROUTINE_ITERATIONS));
+
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Hot counters as coroutines on " << workers << " workers" << std::endl;
+
+    std::vector<CoroutineScheduler::Body> bodies;
+    bodies.reserve(COROUTINE_CONCURRENT_TRANSACTIONS);
+    for (size_t i = 0; i < COROUTINE_CONCURRENT_TRANSACTIONS; i++) {
+        bodies.emplace_back([&, i](Transaction *transaction) -> TransactionTask {
+            int64_t total = 0;
+            for (auto &counter : counters) {
+                total += co_await transaction->AsyncLoad(&counter);
+            }
+            transaction->Store(&counters[i % HOT_COUNTERS], total + 1);
+        });
+    }
+    PrintRunDetails(transaction_manager,
+                    RunCoroutineTransactions(transaction_manager, bodies, workers, COROUTINE_ITERATIONS));
+}
+
+/**
+ * Alternate read mostly and write heavy phases on every static mode and on an adaptive manager. No static mode is
+ * best for both phases, the adaptive manager should come close to the best one in each.
+ */
+void AdaptiveModeWorkload() {
+    std::cout << "Alternating read mostly and write heavy phases" << std::endl;
+
+    AccountStorage storage(GetTestAccounts(2 * READ_WRITE_CONCURRENT_TRANSACTIONS), account_layout);
+    auto accounts = storage.GetAddresses();
+    std::vector<std::function<void(Transaction *)>> read_mostly;
+    std::vector<std::function<void(Transaction *)>> write_heavy;
+    for (size_t i = 0; i < accounts.size() - 1; i += 2) {
+        read_mostly.emplace_back([&, i](Transaction *transaction) {
+            double total = 0;
+            for (auto *account : accounts) {
+                total += transaction->Load(account);
+            }
+            // One transaction in a phase moves money
+            if (i == 0) {
+                double diff = RandomFloat();
+                transaction->Store(accounts[0], transaction->Load(accounts[0]) - diff);
+                transaction->Store(accounts[1], transaction->Load(accounts[1]) + diff);
+            }
+        });
+        write_heavy.emplace_back([&](Transaction *transaction) {
+            for (auto *account : accounts) {
+                transaction->Store(account, RandomFloat());
+            }
+        });
+    }
+
+    for (auto mode : {TransactionMode::LAZY_PESSIMISTIC, TransactionMode::LAZY_OPTIMISTIC,
+                      TransactionMode::EAGER_PESSIMISTIC}) {
+        TransactionManager transaction_manager(mode != TransactionMode::EAGER_PESSIMISTIC,
+                                               mode != TransactionMode::LAZY_OPTIMISTIC);
+        std::cout << "Mode: " << TransactionModeName(mode) << std::endl;
+        size_t aborts = 0;
+        size_t time = 0;
+        for (int phase = 0; phase < ADAPTIVE_PHASES; phase++) {
+            auto details = RunWorkload(&transaction_manager, phase % 2 == 0 ? read_mostly : write_heavy,
+                                       ADAPTIVE_PHASE_ITERATIONS);
+            aborts += details.aborts_;
+            time += details.time_taken_;
+        }
+        PrintRunDetails(&transaction_manager, {aborts, time});
+    }
+
+    TransactionManager transaction_manager(true, true);
+    transaction_manager.EnableAdaptiveMode();
+    std::cout << "Mode: adaptive" << std::endl;
+    size_t aborts = 0;
+    size_t time = 0;
+    for (int phase = 0; phase < ADAPTIVE_PHASES; phase++) {
+        auto details = RunWorkload(&transaction_manager, phase % 2 == 0 ? read_mostly : write_heavy,
+                                   ADAPTIVE_PHASE_ITERATIONS);
+        aborts += details.aborts_;
+        time += details.time_taken_;
+        std::cout << "Phase " << phase << " ended " << TransactionModeName(transaction_manager.GetMode())
+                  << std::endl;
+    }
+    PrintRunDetails(&transaction_manager, {aborts, time});
+    std::cout << "Mode switches: " << transaction_manager.GetModeSwitches() << std::endl;
+}
+
+/**
+ * Non conflicting transfers between accounts in a persistent region, every commit waits for its log record to be
+ * synced so the number of commits per sync shows how well group commit batches concurrent committers
+ */
+void DurableTransfersWorkload(TransactionManager *transaction_manager, const std::string &path) {
+    std::cout << "Durable read write non conflicting" << std::endl;
+
+    PersistentRegion region(path, 2 * READ_WRITE_CONCURRENT_TRANSACTIONS * sizeof(double));
+    std::vector<double *> accounts;
+    for (int i = 0; i < 2 * READ_WRITE_CONCURRENT_TRANSACTIONS; i++) {
+        accounts.push_back(static_cast<double *>(region.GetBase()) + i);
+    }
+    transaction_manager->EnablePersistence(&region);
+    PrintRunDetails(transaction_manager,
+                    RunWorkload(transaction_manager, NonConflictingTransfers(accounts), DURABLE_ITERATIONS));
+    transaction_manager->EnablePersistence(nullptr);
+
+    auto stats = region.GetPersistenceStats();
+    std::cout << "Commits: " << stats.commits_ << ", log syncs: " << stats.syncs_ << std::endl;
+}
+
+/**
+ * Run the same non conflicting transfers with every account layout. Packed accounts share cache lines between
+ * transactions that never conflict, so their slowdown over padded accounts is lost to false sharing, and scattered
+ * accounts show the cost of missing spatial locality.
+ */
+void AccountLayoutStudy(TransactionManager *transaction_manager) {
+    std::cout << "Account layouts, read write non conflicting" << std::endl;
+
+    double padded_time = 0;
+    for (auto layout : {AccountLayout::PADDED, AccountLayout::PACKED, AccountLayout::SCATTERED, AccountLayout::MAP}) {
+        std::cout << "Layout: " << AccountLayoutName(layout) << std::endl;
+        AccountStorage storage(GetTestAccounts(2 * READ_WRITE_CONCURRENT_TRANSACTIONS), layout);
+        auto funcs = NonConflictingTransfers(storage.GetAddresses());
+
+        PerfCounters counters;
+        counters.Start();
+        auto details = RunWorkload(transaction_manager, funcs, READ_WRITE_ITERATIONS);
+        auto misses = counters.Stop();
+
+        PrintRunDetails(transaction_manager, details);
+        if (misses.available_) {
+            std::cout << "Cache misses: " << misses.cache_misses_ << ", L1D read misses: " << misses.l1d_read_misses_
+                      << std::endl;
+        } else {
+            std::cout << "Cache misses: unavailable" << std::endl;
+        }
+        if (layout == AccountLayout::PADDED) {
+            padded_time = static_cast<double>(details.time_taken_);
+        } else if (padded_time > 0) {
+            std::cout << "Slowdown over padded: " << static_cast<double>(details.time_taken_) / padded_time << "x"
+                      << std::endl;
+        }
+    }
+}
+
+/**
+ * Run transfers between random accounts of a key space far larger than the other benchmarks with every kind of
+ * pessimistic conflict metadata. An audit holding a large read set shows how the metadata grows with the addresses
+ * it tracks.
+ */
+void LargeKeySpaceStudy() {
+    std::cout << "Transfers over " << LARGE_KEY_SPACE_ACCOUNTS << " accounts" << std::endl;
+
+    std::vector<double> accounts(LARGE_KEY_SPACE_ACCOUNTS, 1000);
+    std::vector<std::function<void(Transaction *)>> funcs;
+    funcs.reserve(LARGE_KEY_SPACE_CONCURRENT_TRANSACTIONS);
+    for (int i = 0; i < LARGE_KEY_SPACE_CONCURRENT_TRANSACTIONS; i++) {
+        funcs.emplace_back([&](Transaction *transaction) {
+            for (int transfer = 0; transfer < LARGE_KEY_SPACE_TRANSFERS; transfer++) {
+                double diff = RandomFloat();
+                size_t from = Random::Uniform(accounts.size());
+                size_t to = Random::Uniform(accounts.size());
+                transaction->Store(&accounts[from], transaction->Load(&accounts[from]) - diff);
+                transaction->Store(&accounts[to], transaction->Load(&accounts[to]) + diff);
+            }
+        });
+    }
+
+    for (auto conflict_metadata : {ConflictMetadata::HASH_SETS, ConflictMetadata::READER_BITMAPS,
+                                   ConflictMetadata::ORECS}) {
+        std::cout << "Conflict metadata: " << ConflictMetadataName(conflict_metadata) << std::endl;
+        TransactionManager transaction_manager(true, true, conflict_metadata);
+
+        size_t idle_bytes = transaction_manager.GetMetadataBytes();
+        size_t audit_bytes = 0;
+        RunTransaction(&transaction_manager, [&](Transaction *transaction) {
+            size_t stride = accounts.size() / LARGE_KEY_SPACE_AUDITED_ACCOUNTS;
+            for (size_t account = 0; account < accounts.size(); account += stride) {
+                transaction->Load(&accounts[account]);
+            }
+            audit_bytes = transaction_manager.GetMetadataBytes();
+        });
+        std::cout << "Metadata bytes: " << idle_bytes << " idle, " << audit_bytes << " while auditing "
+                  << LARGE_KEY_SPACE_AUDITED_ACCOUNTS << " accounts" << std::endl;
+
+        auto details = RunWorkload(&transaction_manager, funcs, LARGE_KEY_SPACE_ITERATIONS);
+        PrintRunDetails(&transaction_manager, details);
+        double commits = static_cast<double>(funcs.size()) * LARGE_KEY_SPACE_ITERATIONS;
+        std::cout << "Throughput: " << commits * 1e6 / static_cast<double>(std::max<size_t>(details.time_taken_, 1))
+                  << (simulation_scheduler != nullptr ? " commits per million cycles" : " commits per second")
+                  << std::endl;
+    }
+}
+
+/**
+ * Transfers between the accounts of a shared memory segment by several processes at once. Every process attaches to
+ * the segment by name and runs its own manager and threads, so conflicts between processes are only detected through
+ * the orecs and slots of the segment. The balance total shows whether any update was lost between processes.
+ */
+void SharedTransfersWorkload(bool use_lazy_versioning, const std::string &name, size_t processes) {
+    std::cout << "Shared memory read write conflicting, " << (use_lazy_versioning ? "lazy" : "eager")
+              << " versioning, " << processes << " processes" << std::endl;
+
+    size_t data_size = SHARED_MEMORY_ACCOUNTS * sizeof(double) + processes * sizeof(uint64_t);
+    SharedMemoryRegion::Unlink(name);
+    SharedMemoryRegion region(name, data_size, SHARED_MEMORY_ORECS);
+    auto *accounts = static_cast<double *>(region.GetData());
+    auto *process_aborts = reinterpret_cast<uint64_t *>(accounts + SHARED_MEMORY_ACCOUNTS);
+    std::fill(accounts, accounts + SHARED_MEMORY_ACCOUNTS, 1000.0);
+
+    auto transfer = [&](size_t process) {
+        SharedMemoryRegion attached(name, data_size, SHARED_MEMORY_ORECS);
+        TransactionManager transaction_manager(use_lazy_versioning, true, ConflictMetadata::ORECS);
+        transaction_manager.EnableSharedMemory(&attached);
+        auto *balances = static_cast<double *>(attached.GetData());
+        std::vector<std::function<void(Transaction *)>> funcs;
+        for (int i = 0; i < SHARED_MEMORY_CONCURRENT_TRANSACTIONS; i++) {
+            funcs.emplace_back([=](Transaction *transaction) {
+                double diff = RandomFloat() / 1000;
+                size_t from = Random::Uniform(SHARED_MEMORY_ACCOUNTS);
+                size_t to = Random::Uniform(SHARED_MEMORY_ACCOUNTS);
+                transaction->Store(&balances[from], transaction->Load(&balances[from]) - diff);
+                transaction->Store(&balances[to], transaction->Load(&balances[to]) + diff);
+            });
+        }
+        auto details = RunAsyncTransactions(&transaction_manager, funcs, SHARED_MEMORY_ITERATIONS);
+        // Every process owns its counter, no transaction needed
+        reinterpret_cast<uint64_t *>(balances + SHARED_MEMORY_ACCOUNTS)[process] = details.aborts_;
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<pid_t> children;
+    for (size_t process = 1; process < processes; process++) {
+        pid_t child = fork();
+        if (child == 0) {
+            // Children inherit the random state, so every one of them needs its own sequence
+            Random::Seed(Random::GetSeed() + process);
+            try {
+                transfer(process);
+            } catch (const std::exception &e) {
+                std::cerr << "Process " << process << " failed: " << e.what() << std::endl;
+                _exit(1);
+            }
+            _exit(0);
+        }
+        children.push_back(child);
+    }
+    transfer(0);
+    bool failed = false;
+    for (auto child : children) {
+        int status = 0;
+        waitpid(child, &status, 0);
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    auto time = static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start).count());
+    SharedMemoryRegion::Unlink(name);
+
+    size_t aborts = 0;
+    for (size_t process = 0; process < processes; process++) {
+        aborts += process_aborts[process];
+    }
+    double total = 0;
+    for (size_t account = 0; account < SHARED_MEMORY_ACCOUNTS; account++) {
+        total += accounts[account];
+    }
     std::cout << "Aborts: " << aborts << std::endl;
     std::cout << "Time (micro seconds): " << time << std::endl;
+    double commits = static_cast<double>(processes) * SHARED_MEMORY_CONCURRENT_TRANSACTIONS * SHARED_MEMORY_ITERATIONS;
+    std::cout << "Throughput: " << commits * 1e6 / static_cast<double>(std::max<size_t>(time, 1))
+              << " commits per second" << std::endl;
+    if (failed || std::abs(total - 1000.0 * SHARED_MEMORY_ACCOUNTS) > 0.01) {
+        std::cout << "Lost updates between processes, total " << total << std::endl;
+    }
+}
+
+void PrintUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [options]" << std::endl
+              << "  --trace FILE                 record events, write FILE and FILE.json at exit" << std::endl
+              << "  --trace-capacity EVENTS      events kept per thread when tracing" << std::endl
+              << "  --simulate CORES             run workloads on CORES simulated cores in virtual time" << std::endl
+              << "  --seed SEED                  seed for workload data and the simulated scheduler" << std::endl
+              << "  --load-cycles CYCLES         simulated cost of a load" << std::endl
+              << "  --store-cycles CYCLES        simulated cost of a store" << std::endl
+              << "  --commit-cycles CYCLES       simulated cost of a commit" << std::endl
+              << "  --abort-cycles CYCLES        simulated cost of an abort" << std::endl
+              << "  --htm ATTEMPTS               emulate best effort HTM, retry ATTEMPTS times before software"
+              << std::endl
+              << "  --htm-sets SETS              sets in the simulated L1" << std::endl
+              << "  --htm-ways WAYS              ways in the simulated L1" << std::endl
+              << "  --htm-line-size BYTES        line size of the simulated L1" << std::endl
+              << "  --conflict-metadata hash|bitmap|orec" << std::endl
+              << "                               conflict metadata of the pessimistic managers" << std::endl
+              << "  --suite micro|stamp|layout|scale|all" << std::endl
+              << "                               account and container microbenchmarks, application benchmarks, the"
+              << std::endl
+              << "                               account layout study, conflict metadata at 10M accounts or all of"
+              << std::endl
+              << "                               them" << std::endl
+              << "  --account-layout map|packed|padded|scattered" << std::endl
+              << "                               where the microbenchmark account balances live" << std::endl
+              << "  --update-rate PERCENT        percentage of intset operations that insert or remove" << std::endl
+              << "  --commit-path locked|combining" << std::endl
+              << "                               remove finished transactions one at a time or in combined batches"
+              << std::endl
+              << "  --persist FILE               run durable transfers on a region backed by FILE and FILE.log"
+              << std::endl
+              << "  --shared-memory NAME         run transfers of several processes on the shared memory segment NAME"
+              << std::endl
+              << "  --processes PROCESSES        processes sharing the segment" << std::endl
+              << "  --byte-ranges GRANULE        detect conflicts between overlapping byte ranges of GRANULE bytes"
+              << std::endl
+              << "  --scheduler spread|conflict-aware" << std::endl
+              << "                               run every transaction on its own thread or queue transactions"
+              << std::endl
+              << "                               predicted to conflict on the same worker" << std::endl
+              << "  --sweep PREFIX               run every configuration and workload across thread counts and"
+              << std::endl
+              << "                               contention levels, write PREFIX.csv and speedup, efficiency and"
+              << std::endl
+              << "                               abort rate plots instead of running the suites" << std::endl
+              << "  --sweep-threads THREADS      largest thread count of the sweep" << std::endl
+              << "  --sweep-repeats REPEATS      runs of every sweep point, for confidence intervals" << std::endl
+              << "  --sweep-transactions COUNT   transactions every thread commits per sweep run" << std::endl;
 }
 
 int main(int argc, char *argv[]) {
+    std::string trace_path;
+    size_t trace_capacity = Tracer::DEFAULT_LANE_CAPACITY;
+    size_t simulated_cores = 0;
+    uint64_t seed = 0;
+    SimulationCosts costs;
+    bool use_htm = false;
+    HtmConfig htm_config;
+    ConflictMetadata conflict_metadata = ConflictMetadata::HASH_SETS;
+    bool use_flat_combining = false;
+    size_t granule_size = 0;
+    std::string persist_path;
+    std::string shared_memory_name;
+    size_t processes = SHARED_MEMORY_DEFAULT_PROCESSES;
+    bool run_micro = true;
+    bool run_stamp = false;
+    bool run_layout = false;
+    bool run_scale = false;
+    size_t intset_update_rate = DEFAULT_INTSET_UPDATE_RATE;
+    bool run_sweep = false;
+    SweepConfig sweep_config;
+    sweep_config.max_threads_ = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--trace") {
+            trace_path = argv[++i];
+        } else if (arg == "--trace-capacity") {
+            trace_capacity = std::stoul(argv[++i]);
+        } else if (arg == "--simulate") {
+            simulated_cores = std::stoul(argv[++i]);
+        } else if (arg == "--seed") {
+            seed = std::stoull(argv[++i]);
+        } else if (arg == "--load-cycles") {
+            costs.load_cycles_ = std::stoull(argv[++i]);
+        } else if (arg == "--store-cycles") {
+            costs.store_cycles_ = std::stoull(argv[++i]);
+        } else if (arg == "--commit-cycles") {
+            costs.commit_cycles_ = std::stoull(argv[++i]);
+        } else if (arg == "--abort-cycles") {
+            costs.abort_cycles_ = std::stoull(argv[++i]);
+        } else if (arg == "--htm") {
+            use_htm = true;
+            htm_config.max_attempts_ = std::stoul(argv[++i]);
+        } else if (arg == "--htm-sets") {
+            htm_config.sets_ = std::stoul(argv[++i]);
+        } else if (arg == "--htm-ways") {
+            htm_config.ways_ = std::stoul(argv[++i]);
+        } else if (arg == "--htm-line-size") {
+            htm_config.line_size_ = std::stoul(argv[++i]);
+        } else if (arg == "--conflict-metadata") {
+            std::string metadata = argv[++i];
+            if (metadata == "hash") {
+                conflict_metadata = ConflictMetadata::HASH_SETS;
+            } else if (metadata == "bitmap") {
+                conflict_metadata = ConflictMetadata::READER_BITMAPS;
+            } else if (metadata == "orec") {
+                conflict_metadata = ConflictMetadata::ORECS;
+            } else {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--suite") {
+            std::string suite = argv[++i];
+            run_micro = suite == "micro" || suite == "all";
+            run_stamp = suite == "stamp" || suite == "all";
+            run_layout = suite == "layout" || suite == "all";
+            run_scale = suite == "scale" || suite == "all";
+            if (!run_micro && !run_stamp && !run_layout && !run_scale) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--update-rate") {
+            intset_update_rate = std::stoul(argv[++i]);
+        } else if (arg == "--commit-path") {
+            std::string commit_path = argv[++i];
+            if (commit_path == "locked") {
+                use_flat_combining = false;
+            } else if (commit_path == "combining") {
+                use_flat_combining = true;
+            } else {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--account-layout") {
+            std::string layout = argv[++i];
+            if (layout == "map") {
+                account_layout = AccountLayout::MAP;
+            } else if (layout == "packed") {
+                account_layout = AccountLayout::PACKED;
+            } else if (layout == "padded") {
+                account_layout = AccountLayout::PADDED;
+            } else if (layout == "scattered") {
+                account_layout = AccountLayout::SCATTERED;
+            } else {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--scheduler") {
+            std::string scheduler = argv[++i];
+            if (scheduler == "spread") {
+                use_conflict_aware_scheduling = false;
+            } else if (scheduler == "conflict-aware") {
+                use_conflict_aware_scheduling = true;
+            } else {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--persist") {
+            persist_path = argv[++i];
+        } else if (arg == "--shared-memory") {
+            shared_memory_name = argv[++i];
+        } else if (arg == "--processes") {
+            processes = std::stoul(argv[++i]);
+            if (processes == 0) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--byte-ranges") {
+            granule_size = std::stoul(argv[++i]);
+        } else if (arg == "--sweep") {
+            run_sweep = true;
+            sweep_config.output_prefix_ = argv[++i];
+        } else if (arg == "--sweep-threads") {
+            sweep_config.max_threads_ = std::stoul(argv[++i]);
+        } else if (arg == "--sweep-repeats") {
+            sweep_config.repeats_ = std::stoul(argv[++i]);
+        } else if (arg == "--sweep-transactions") {
+            sweep_config.transactions_per_thread_ = std::stoul(argv[++i]);
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    Random::Seed(seed);
+    std::cout << "Seed " << seed << std::endl;
 
     TestCorrectness();
+    Profiler::Reset();
+
+    if (simulated_cores > 0) {
+        simulation_scheduler = std::make_unique<VirtualTimeScheduler>(simulated_cores, seed, costs);
+        std::cout << "Simulating " << simulated_cores << " cores" << std::endl;
+    }
+
+    if (run_sweep) {
+        if (sweep_config.repeats_ == 0 || sweep_config.transactions_per_thread_ == 0) {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        if (sweep_config.max_threads_ == 0) {
+            sweep_config.max_threads_ = simulation_scheduler != nullptr
+                                        ? simulated_cores : std::max(1u, std::thread::hardware_concurrency());
+        }
+        RunScalabilitySweep(sweep_config, [&](bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+            auto metadata = use_pessimistic_conflict_detection ? conflict_metadata : ConflictMetadata::HASH_SETS;
+            auto transaction_manager = std::make_unique<TransactionManager>(use_lazy_versioning,
+                                                                            use_pessimistic_conflict_detection,
+                                                                            metadata);
+            if (use_htm) {
+                transaction_manager->EnableHtmEmulation(htm_config);
+            }
+            if (use_flat_combining && metadata == ConflictMetadata::HASH_SETS) {
+                transaction_manager->EnableFlatCombining();
+            }
+            if (granule_size > 0) {
+                transaction_manager->EnableByteRanges(granule_size);
+            }
+            return transaction_manager;
+        }, simulation_scheduler.get());
+        return 0;
+    }
 
-    TransactionManager transaction_manager1(true, true);
+    if (!trace_path.empty()) {
+        Tracer::Enable(trace_capacity);
+    }
+
+    TransactionManager transaction_manager1(true, true, conflict_metadata);
+    if (use_htm) {
+        transaction_manager1.EnableHtmEmulation(htm_config);
+    }
+    if (use_flat_combining && conflict_metadata == ConflictMetadata::HASH_SETS) {
+        transaction_manager1.EnableFlatCombining();
+    }
+    if (granule_size > 0) {
+        transaction_manager1.EnableByteRanges(granule_size);
+    }
 
     std::cout << std::endl << "LAZY VERSIONING and PESSIMISTIC CONFLICT DETECTION" << std::endl;
 
-    ReadOnlyNonConflicting(&transaction_manager1);
-    ReadOnlyConflicting(&transaction_manager1);
-    EmptyWorkload(&transaction_manager1, READ_CONCURRENT_TRANSACTIONS, READ_ITERATIONS);
-    WriteOnlyNonConflicting(&transaction_manager1);
-    WriteOnlyConflicting(&transaction_manager1);
-    EmptyWorkload(&transaction_manager1, WRITE_CONCURRENT_TRANSACTIONS, WRITE_ITERATIONS);
-    ReadWriteNonConflicting(&transaction_manager1);
-    ReadWriteConflicting(&transaction_manager1);
-    EmptyWorkload(&transaction_manager1, READ_WRITE_CONCURRENT_TRANSACTIONS, READ_WRITE_ITERATIONS);
+    if (run_micro) {
+        ReadOnlyNonConflicting(&transaction_manager1);
+        ReadOnlyConflicting(&transaction_manager1);
+        EmptyWorkload(&transaction_manager1, READ_CONCURRENT_TRANSACTIONS, READ_ITERATIONS);
+        WriteOnlyNonConflicting(&transaction_manager1);
+        WriteOnlyConflicting(&transaction_manager1);
+        EmptyWorkload(&transaction_manager1, WRITE_CONCURRENT_TRANSACTIONS, WRITE_ITERATIONS);
+        ReadWriteNonConflicting(&transaction_manager1);
+        ReadWriteConflicting(&transaction_manager1);
+        EmptyWorkload(&transaction_manager1, READ_WRITE_CONCURRENT_TRANSACTIONS, READ_WRITE_ITERATIONS);
+        ContainerWorkloads(&transaction_manager1);
+        HotCounterWorkload(&transaction_manager1);
+        if (simulation_scheduler == nullptr) {
+            CoroutineStallWorkload(&transaction_manager1);
+        }
+        if (!persist_path.empty()) {
+            DurableTransfersWorkload(&transaction_manager1, persist_path);
+        }
+    }
+    if (run_stamp) {
+        StampWorkloads(&transaction_manager1, intset_update_rate);
+    }
+    if (run_layout) {
+        AccountLayoutStudy(&transaction_manager1);
+    }
+    ReportProfile("lazy versioning and pessimistic conflict detection");
 
     TransactionManager transaction_manager2(true, false);
+    if (use_htm) {
+        transaction_manager2.EnableHtmEmulation(htm_config);
+    }
+    if (use_flat_combining) {
+        transaction_manager2.EnableFlatCombining();
+    }
+    if (granule_size > 0) {
+        transaction_manager2.EnableByteRanges(granule_size);
+    }
 
     std::cout << std::endl << "LAZY VERSIONING and OPTIMISTIC CONFLICT DETECTION" << std::endl;
 
-    ReadOnlyNonConflicting(&transaction_manager2);
-    ReadOnlyConflicting(&transaction_manager2);
-    EmptyWorkload(&transaction_manager2, READ_CONCURRENT_TRANSACTIONS, READ_ITERATIONS);
-    WriteOnlyNonConflicting(&transaction_manager2);
-    WriteOnlyConflicting(&transaction_manager2);
-    ReadWriteNonConflicting(&transaction_manager2);
-    ReadWriteConflicting(&transaction_manager2);
+    if (run_micro) {
+        ReadOnlyNonConflicting(&transaction_manager2);
+        ReadOnlyConflicting(&transaction_manager2);
+        EmptyWorkload(&transaction_manager2, READ_CONCURRENT_TRANSACTIONS, READ_ITERATIONS);
+        WriteOnlyNonConflicting(&transaction_manager2);
+        WriteOnlyConflicting(&transaction_manager2);
+        ReadWriteNonConflicting(&transaction_manager2);
+        ReadWriteConflicting(&transaction_manager2);
+        ContainerWorkloads(&transaction_manager2);
+        HotCounterWorkload(&transaction_manager2);
+        if (simulation_scheduler == nullptr) {
+            CoroutineStallWorkload(&transaction_manager2);
+        }
+        if (!persist_path.empty()) {
+            DurableTransfersWorkload(&transaction_manager2, persist_path);
+        }
+    }
+    if (run_stamp) {
+        StampWorkloads(&transaction_manager2, intset_update_rate);
+    }
+    if (run_layout) {
+        AccountLayoutStudy(&transaction_manager2);
+    }
+    ReportProfile("lazy versioning and optimistic conflict detection");
 
-    TransactionManager transaction_manager3(false, true);
+    TransactionManager transaction_manager3(false, true, conflict_metadata);
+    if (use_htm) {
+        transaction_manager3.EnableHtmEmulation(htm_config);
+    }
+    if (use_flat_combining && conflict_metadata == ConflictMetadata::HASH_SETS) {
+        transaction_manager3.EnableFlatCombining();
+    }
+    if (granule_size > 0) {
+        transaction_manager3.EnableByteRanges(granule_size);
+    }
 
     std::cout << std::endl << "EAGER VERSIONING and PESSIMISTIC CONFLICT DETECTION" << std::endl;
 
-    ReadOnlyNonConflicting(&transaction_manager3);
-    ReadOnlyConflicting(&transaction_manager3);
-    EmptyWorkload(&transaction_manager3, READ_CONCURRENT_TRANSACTIONS, READ_ITERATIONS);
-    WriteOnlyNonConflicting(&transaction_manager3);
-    WriteOnlyConflicting(&transaction_manager3);
-    ReadWriteNonConflicting(&transaction_manager3);
-    ReadWriteConflicting(&transaction_manager3);
+    if (run_micro) {
+        ReadOnlyNonConflicting(&transaction_manager3);
+        ReadOnlyConflicting(&transaction_manager3);
+        EmptyWorkload(&transaction_manager3, READ_CONCURRENT_TRANSACTIONS, READ_ITERATIONS);
+        WriteOnlyNonConflicting(&transaction_manager3);
+        WriteOnlyConflicting(&transaction_manager3);
+        ReadWriteNonConflicting(&transaction_manager3);
+        ReadWriteConflicting(&transaction_manager3);
+        ContainerWorkloads(&transaction_manager3);
+        HotCounterWorkload(&transaction_manager3);
+        if (simulation_scheduler == nullptr) {
+            CoroutineStallWorkload(&transaction_manager3);
+        }
+        if (!persist_path.empty()) {
+            DurableTransfersWorkload(&transaction_manager3, persist_path);
+        }
+    }
+    if (run_stamp) {
+        StampWorkloads(&transaction_manager3, intset_update_rate);
+    }
+    if (run_layout) {
+        AccountLayoutStudy(&transaction_manager3);
+    }
+    ReportProfile("eager versioning and pessimistic conflict detection");
+
+    if (run_micro) {
+        std::cout << std::endl << "ADAPTIVE VERSIONING and CONFLICT DETECTION" << std::endl;
+        AdaptiveModeWorkload();
+        ReportProfile("adaptive versioning and conflict detection");
+    }
+
+    if (run_scale) {
+        std::cout << std::endl << "CONFLICT METADATA at LARGE KEY SPACES" << std::endl;
+        LargeKeySpaceStudy();
+        ReportProfile("conflict metadata at large key spaces");
+    }
+
+    // Processes can't share simulated cores
+    if (!shared_memory_name.empty() && simulation_scheduler == nullptr) {
+        std::cout << std::endl << "PROCESSES SHARING MEMORY" << std::endl;
+        SharedTransfersWorkload(true, shared_memory_name, processes);
+        SharedTransfersWorkload(false, shared_memory_name, processes);
+        ReportProfile("processes sharing memory");
+    }
+
+    if (!trace_path.empty()) {
+        Tracer::Disable();
+        size_t events = Tracer::DumpBinary(trace_path);
+        Tracer::ConvertToChromeJson(trace_path, trace_path + ".json");
+        std::cout << std::endl << "Wrote " << events << " trace events to " << trace_path << " and " << trace_path
+                  << ".json" << std::endl;
+    }
 }
\ No newline at end of file
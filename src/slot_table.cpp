@@ -0,0 +1,77 @@
+#include "include/slot_table.h"
+
+#include "include/transaction.h"
+#include "include/tracer.h"
+#include "include/virtual_time_scheduler.h"
+
+SlotTable::SlotTable() : owned_state_(std::make_unique<State>()), state_(owned_state_.get()) {
+    InitializeState(state_);
+}
+
+SlotTable::SlotTable(State *state) : state_(state) {}
+
+void SlotTable::InitializeState(State *state) {
+    for (auto &free_slots : state->free_slots_) {
+        free_slots.store(~uint64_t{0});
+    }
+    for (auto &slot_state : state->slot_states_) {
+        slot_state.store(Transaction::ABORTED);
+    }
+}
+
+uint32_t SlotTable::AcquireSlot(uint64_t transaction_id) {
+    while (true) {
+        for (size_t word = 0; word < state_->free_slots_.size(); word++) {
+            uint64_t free_slots = state_->free_slots_[word].load();
+            while (free_slots != 0) {
+                uint64_t bit = free_slots & -free_slots;
+                if (state_->free_slots_[word].compare_exchange_weak(free_slots, free_slots & ~bit)) {
+                    auto slot = static_cast<uint32_t>(word * 64 + __builtin_ctzll(bit));
+                    state_->slot_states_[slot].store(transaction_id << 2 | Transaction::RUNNING);
+                    return slot;
+                }
+            }
+        }
+        VirtualTimeScheduler::Pause();
+    }
+}
+
+void SlotTable::ReleaseSlot(uint32_t slot) {
+    state_->slot_states_[slot].store(Transaction::ABORTED);
+    state_->free_slots_[slot / 64].fetch_or(uint64_t{1} << (slot % 64));
+}
+
+bool SlotTable::MarkCommitting(uint32_t slot) {
+    uint64_t state = state_->slot_states_[slot].load();
+    return (state & STATE_MASK) == Transaction::RUNNING &&
+           state_->slot_states_[slot].compare_exchange_strong(state, (state & ~STATE_MASK) | Transaction::COMMITTING);
+}
+
+bool SlotTable::WaitForWriter(uint32_t slot, uint32_t writer_slot, const std::function<bool()> &still_writing) {
+    auto &slot_state = state_->slot_states_[slot];
+    uint64_t transaction_id = slot_state.load() >> 2;
+
+    auto &other_state = state_->slot_states_[writer_slot];
+    uint64_t other = other_state.load();
+    if ((other & STATE_MASK) == Transaction::STALLED) {
+        if (other_state.compare_exchange_strong(other, (other & ~STATE_MASK) | Transaction::ABORTED)) {
+            Tracer::Record(TraceEventType::KILL, transaction_id, other >> 2);
+        }
+        VirtualTimeScheduler::Pause();
+        return true;
+    }
+
+    uint64_t running = transaction_id << 2 | Transaction::RUNNING;
+    uint64_t stalled = transaction_id << 2 | Transaction::STALLED;
+    if (slot_state.compare_exchange_strong(running, stalled)) {
+        Tracer::Record(TraceEventType::STALL_BEGIN, transaction_id, other >> 2);
+        while (still_writing() && slot_state.load() == stalled) {
+            VirtualTimeScheduler::Pause();
+        }
+        Tracer::Record(TraceEventType::STALL_END, transaction_id, other >> 2);
+        if (slot_state.compare_exchange_strong(stalled, running)) {
+            return true;
+        }
+    }
+    return false;
+}
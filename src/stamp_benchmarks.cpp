@@ -0,0 +1,824 @@
+#include "include/stamp_benchmarks.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "include/atomically.h"
+#include "include/random.h"
+#include "include/simulator_main.h"
+#include "include/tmap.h"
+#include "include/transaction.h"
+#include "include/transactional_allocator.h"
+
+static constexpr int STAMP_CONCURRENT_TRANSACTIONS = 16;
+static constexpr int STAMP_ITERATIONS = 500;
+
+static constexpr int64_t INTSET_LIST_RANGE = 256;
+static constexpr int64_t INTSET_RANGE = 8192;
+static constexpr int INTSET_OPERATIONS = 4;
+
+static constexpr int64_t VACATION_RELATIONS = 1024;
+static constexpr int64_t VACATION_CUSTOMERS = 1024;
+static constexpr int64_t VACATION_ITEM_CAPACITY = 10;
+static constexpr int VACATION_QUERIES = 4;
+static constexpr size_t VACATION_MAX_CUSTOMER_RESERVATIONS = 16;
+
+static constexpr int KMEANS_POINTS = 4096;
+static constexpr int KMEANS_CLUSTERS = 8;
+static constexpr int KMEANS_PASSES = 4;
+
+static constexpr int BANK_ACCOUNTS = 1024;
+static constexpr double BANK_INITIAL_BALANCE = 1000;
+static constexpr int BANK_AUDIT_PERCENT = 5;
+
+namespace {
+
+void ReportViolation(const char *workload, const char *msg) {
+    std::cerr << workload << " invariant violated: " << msg << std::endl;
+}
+
+/**
+ * Sorted singly linked list with a sentinel head. Keys never change once a node is published so they're read
+ * without the transaction.
+ */
+class TListSet {
+public:
+    /**
+     * @param elastic search hand over hand in an elastic section, so only the links next to the result stay read
+     */
+    explicit TListSet(bool elastic = false) : elastic_(elastic) {}
+
+    ~TListSet() {
+        Node *node = head_.next_;
+        while (node != nullptr) {
+            Node *next = node->next_;
+            TransactionalAllocator::Deallocate(node);
+            node = next;
+        }
+    }
+
+    bool Contains(Transaction *transaction, int64_t key) {
+        Node *prev;
+        Node *curr = Find(transaction, key, &prev);
+        return curr != nullptr && curr->key_ == key;
+    }
+
+    bool Add(Transaction *transaction, int64_t key) {
+        Node *prev;
+        Node *curr = Find(transaction, key, &prev);
+        if (curr != nullptr && curr->key_ == key) {
+            return false;
+        }
+        auto *node = static_cast<Node *>(transaction->Alloc(sizeof(Node)));
+        node->key_ = key;
+        node->next_ = curr;
+        transaction->Store(&prev->next_, node);
+        return true;
+    }
+
+    bool Remove(Transaction *transaction, int64_t key) {
+        Node *prev;
+        Node *curr = Find(transaction, key, &prev);
+        if (curr == nullptr || curr->key_ != key) {
+            return false;
+        }
+        transaction->Store(&prev->next_, transaction->Load(&curr->next_));
+        transaction->Free(curr);
+        return true;
+    }
+
+private:
+    struct Node {
+        int64_t key_;
+        Node *next_;
+    };
+
+    Node head_{std::numeric_limits<int64_t>::min(), nullptr};
+    bool elastic_;
+
+    /**
+     * @return first node with a key not less than key, nullptr if there is none
+     */
+    Node *Find(Transaction *transaction, int64_t key, Node **prev) {
+        // The links into prev and into the result are the last two reads, they keep both nodes linked until commit
+        if (elastic_) {
+            transaction->BeginElastic(2);
+        }
+        *prev = &head_;
+        Node *curr = transaction->Load(&head_.next_);
+        while (curr != nullptr && curr->key_ < key) {
+            *prev = curr;
+            curr = transaction->Load(&curr->next_);
+        }
+        if (elastic_) {
+            transaction->EndElastic();
+        }
+        return curr;
+    }
+};
+
+/**
+ * Red-black tree following the algorithm of STAMP's rbtree, which treats missing children as black leaves so no
+ * shared sentinel is ever written. Deleting a node with two children moves its successor's key into it, so keys are
+ * transactional.
+ */
+class TRbTreeSet {
+public:
+    ~TRbTreeSet() {
+        FreeSubtree(root_);
+    }
+
+    bool Contains(Transaction *transaction, int64_t key) {
+        return Lookup(transaction, key) != nullptr;
+    }
+
+    bool Add(Transaction *transaction, int64_t key) {
+        Node *parent = nullptr;
+        Node *curr = transaction->Load(&root_);
+        bool left = false;
+        while (curr != nullptr) {
+            int64_t curr_key = transaction->Load(&curr->key_);
+            if (key == curr_key) {
+                return false;
+            }
+            parent = curr;
+            left = key < curr_key;
+            curr = transaction->Load(left ? &curr->left_ : &curr->right_);
+        }
+
+        auto *node = static_cast<Node *>(transaction->Alloc(sizeof(Node)));
+        *node = {key, nullptr, nullptr, parent, false};
+        if (parent == nullptr) {
+            transaction->Store(&root_, node);
+        } else {
+            transaction->Store(left ? &parent->left_ : &parent->right_, node);
+        }
+        FixAfterInsertion(transaction, node);
+        return true;
+    }
+
+    bool Remove(Transaction *transaction, int64_t key) {
+        Node *node = Lookup(transaction, key);
+        if (node == nullptr) {
+            return false;
+        }
+
+        if (Left(transaction, node) != nullptr && Right(transaction, node) != nullptr) {
+            Node *successor = Right(transaction, node);
+            while (Left(transaction, successor) != nullptr) {
+                successor = Left(transaction, successor);
+            }
+            transaction->Store(&node->key_, transaction->Load(&successor->key_));
+            node = successor;
+        }
+
+        Node *replacement = Left(transaction, node) != nullptr ? Left(transaction, node) : Right(transaction, node);
+        Node *parent = Parent(transaction, node);
+        if (replacement != nullptr) {
+            transaction->Store(&replacement->parent_, parent);
+            ReplaceChild(transaction, parent, node, replacement);
+            if (IsBlack(transaction, node)) {
+                FixAfterDeletion(transaction, replacement);
+            }
+        } else if (parent == nullptr) {
+            transaction->Store(&root_, static_cast<Node *>(nullptr));
+        } else {
+            // The node acts as the phantom leaf while rebalancing and is unlinked afterwards
+            if (IsBlack(transaction, node)) {
+                FixAfterDeletion(transaction, node);
+            }
+            ReplaceChild(transaction, Parent(transaction, node), node, nullptr);
+        }
+        transaction->Free(node);
+        return true;
+    }
+
+    /**
+     * Check ordering and the red-black properties, no transaction may be using the tree
+     *
+     * @return false if the tree is malformed
+     */
+    bool Validate() const {
+        return root_ == nullptr || (root_->black_ && BlackHeight(root_, std::numeric_limits<int64_t>::min(),
+                                                                  std::numeric_limits<int64_t>::max()) > 0);
+    }
+
+private:
+    struct Node {
+        int64_t key_;
+        Node *left_;
+        Node *right_;
+        Node *parent_;
+        bool black_;
+    };
+
+    Node *root_ = nullptr;
+
+    static void FreeSubtree(Node *node) {
+        if (node != nullptr) {
+            FreeSubtree(node->left_);
+            FreeSubtree(node->right_);
+            TransactionalAllocator::Deallocate(node);
+        }
+    }
+
+    /**
+     * @return black height of the subtree, 0 if it's malformed
+     */
+    static int BlackHeight(const Node *node, int64_t low, int64_t high) {
+        if (node == nullptr) {
+            return 1;
+        }
+        if (node->key_ <= low || node->key_ >= high ||
+            (!node->black_ && ((node->left_ != nullptr && !node->left_->black_) ||
+                               (node->right_ != nullptr && !node->right_->black_)))) {
+            return 0;
+        }
+        int left = BlackHeight(node->left_, low, node->key_);
+        int right = BlackHeight(node->right_, node->key_, high);
+        if (left == 0 || left != right) {
+            return 0;
+        }
+        return left + (node->black_ ? 1 : 0);
+    }
+
+    Node *Lookup(Transaction *transaction, int64_t key) {
+        Node *curr = transaction->Load(&root_);
+        while (curr != nullptr) {
+            int64_t curr_key = transaction->Load(&curr->key_);
+            if (key == curr_key) {
+                return curr;
+            }
+            curr = transaction->Load(key < curr_key ? &curr->left_ : &curr->right_);
+        }
+        return nullptr;
+    }
+
+    Node *Left(Transaction *transaction, Node *node) {
+        return node == nullptr ? nullptr : transaction->Load(&node->left_);
+    }
+
+    Node *Right(Transaction *transaction, Node *node) {
+        return node == nullptr ? nullptr : transaction->Load(&node->right_);
+    }
+
+    Node *Parent(Transaction *transaction, Node *node) {
+        return node == nullptr ? nullptr : transaction->Load(&node->parent_);
+    }
+
+    bool IsBlack(Transaction *transaction, Node *node) {
+        return node == nullptr || transaction->Load(&node->black_);
+    }
+
+    void SetBlack(Transaction *transaction, Node *node, bool black) {
+        if (node != nullptr) {
+            transaction->Store(&node->black_, black);
+        }
+    }
+
+    /**
+     * Point parent, or the root if parent is nullptr, at replacement instead of child
+     */
+    void ReplaceChild(Transaction *transaction, Node *parent, Node *child, Node *replacement) {
+        if (parent == nullptr) {
+            transaction->Store(&root_, replacement);
+        } else if (Left(transaction, parent) == child) {
+            transaction->Store(&parent->left_, replacement);
+        } else {
+            transaction->Store(&parent->right_, replacement);
+        }
+    }
+
+    void RotateLeft(Transaction *transaction, Node *node) {
+        if (node == nullptr) {
+            return;
+        }
+        Node *right = Right(transaction, node);
+        Node *right_left = Left(transaction, right);
+        transaction->Store(&node->right_, right_left);
+        if (right_left != nullptr) {
+            transaction->Store(&right_left->parent_, node);
+        }
+        Node *parent = Parent(transaction, node);
+        transaction->Store(&right->parent_, parent);
+        ReplaceChild(transaction, parent, node, right);
+        transaction->Store(&right->left_, node);
+        transaction->Store(&node->parent_, right);
+    }
+
+    void RotateRight(Transaction *transaction, Node *node) {
+        if (node == nullptr) {
+            return;
+        }
+        Node *left = Left(transaction, node);
+        Node *left_right = Right(transaction, left);
+        transaction->Store(&node->left_, left_right);
+        if (left_right != nullptr) {
+            transaction->Store(&left_right->parent_, node);
+        }
+        Node *parent = Parent(transaction, node);
+        transaction->Store(&left->parent_, parent);
+        ReplaceChild(transaction, parent, node, left);
+        transaction->Store(&left->right_, node);
+        transaction->Store(&node->parent_, left);
+    }
+
+    void FixAfterInsertion(Transaction *transaction, Node *node) {
+        while (node != nullptr && node != transaction->Load(&root_) && !IsBlack(transaction, Parent(transaction, node))) {
+            Node *parent = Parent(transaction, node);
+            Node *grandparent = Parent(transaction, parent);
+            if (parent == Left(transaction, grandparent)) {
+                Node *uncle = Right(transaction, grandparent);
+                if (!IsBlack(transaction, uncle)) {
+                    SetBlack(transaction, parent, true);
+                    SetBlack(transaction, uncle, true);
+                    SetBlack(transaction, grandparent, false);
+                    node = grandparent;
+                } else {
+                    if (node == Right(transaction, parent)) {
+                        node = parent;
+                        RotateLeft(transaction, node);
+                    }
+                    SetBlack(transaction, Parent(transaction, node), true);
+                    SetBlack(transaction, Parent(transaction, Parent(transaction, node)), false);
+                    RotateRight(transaction, Parent(transaction, Parent(transaction, node)));
+                }
+            } else {
+                Node *uncle = Left(transaction, grandparent);
+                if (!IsBlack(transaction, uncle)) {
+                    SetBlack(transaction, parent, true);
+                    SetBlack(transaction, uncle, true);
+                    SetBlack(transaction, grandparent, false);
+                    node = grandparent;
+                } else {
+                    if (node == Left(transaction, parent)) {
+                        node = parent;
+                        RotateRight(transaction, node);
+                    }
+                    SetBlack(transaction, Parent(transaction, node), true);
+                    SetBlack(transaction, Parent(transaction, Parent(transaction, node)), false);
+                    RotateLeft(transaction, Parent(transaction, Parent(transaction, node)));
+                }
+            }
+        }
+        SetBlack(transaction, transaction->Load(&root_), true);
+    }
+
+    void FixAfterDeletion(Transaction *transaction, Node *node) {
+        while (node != transaction->Load(&root_) && IsBlack(transaction, node)) {
+            Node *parent = Parent(transaction, node);
+            if (node == Left(transaction, parent)) {
+                Node *sibling = Right(transaction, parent);
+                if (!IsBlack(transaction, sibling)) {
+                    SetBlack(transaction, sibling, true);
+                    SetBlack(transaction, parent, false);
+                    RotateLeft(transaction, parent);
+                    parent = Parent(transaction, node);
+                    sibling = Right(transaction, parent);
+                }
+                if (IsBlack(transaction, Left(transaction, sibling)) && IsBlack(transaction, Right(transaction, sibling))) {
+                    SetBlack(transaction, sibling, false);
+                    node = parent;
+                } else {
+                    if (IsBlack(transaction, Right(transaction, sibling))) {
+                        SetBlack(transaction, Left(transaction, sibling), true);
+                        SetBlack(transaction, sibling, false);
+                        RotateRight(transaction, sibling);
+                        sibling = Right(transaction, parent);
+                    }
+                    SetBlack(transaction, sibling, IsBlack(transaction, parent));
+                    SetBlack(transaction, parent, true);
+                    SetBlack(transaction, Right(transaction, sibling), true);
+                    RotateLeft(transaction, parent);
+                    node = transaction->Load(&root_);
+                }
+            } else {
+                Node *sibling = Left(transaction, parent);
+                if (!IsBlack(transaction, sibling)) {
+                    SetBlack(transaction, sibling, true);
+                    SetBlack(transaction, parent, false);
+                    RotateRight(transaction, parent);
+                    parent = Parent(transaction, node);
+                    sibling = Left(transaction, parent);
+                }
+                if (IsBlack(transaction, Right(transaction, sibling)) && IsBlack(transaction, Left(transaction, sibling))) {
+                    SetBlack(transaction, sibling, false);
+                    node = parent;
+                } else {
+                    if (IsBlack(transaction, Left(transaction, sibling))) {
+                        SetBlack(transaction, Right(transaction, sibling), true);
+                        SetBlack(transaction, sibling, false);
+                        RotateLeft(transaction, sibling);
+                        sibling = Left(transaction, parent);
+                    }
+                    SetBlack(transaction, sibling, IsBlack(transaction, parent));
+                    SetBlack(transaction, parent, true);
+                    SetBlack(transaction, Left(transaction, sibling), true);
+                    RotateRight(transaction, parent);
+                    node = transaction->Load(&root_);
+                }
+            }
+        }
+        SetBlack(transaction, node, true);
+    }
+};
+
+/**
+ * Hash set on top of TMap, every bucket is a conflict unit
+ */
+class THashSet {
+public:
+    bool Contains(Transaction *transaction, int64_t key) {
+        return map_.Contains(transaction, key);
+    }
+
+    bool Add(Transaction *transaction, int64_t key) {
+        return map_.Put(transaction, key, true);
+    }
+
+    bool Remove(Transaction *transaction, int64_t key) {
+        return map_.Erase(transaction, key);
+    }
+
+private:
+    TMap<int64_t, bool> map_;
+};
+
+/**
+ * Fill the set to half of range, run a mix of lookups, inserts and removes and check that the set's size matches the
+ * successful inserts and removes
+ */
+template<typename Set>
+TransactionRunDetails RunIntSet(TransactionManager *transaction_manager, const char *name, Set *set, int64_t range,
+                                size_t update_rate) {
+    std::cout << name << " with " << update_rate << "% updates" << std::endl;
+
+    int64_t initial_size = Atomically(transaction_manager, [&](Transaction &transaction) {
+        int64_t added = 0;
+        for (int64_t key = 0; key < range; key += 2) {
+            added += set->Add(&transaction, key) ? 1 : 0;
+        }
+        return added;
+    });
+
+    // Only the owning function touches its counter, so it's exact even when transactions retry
+    std::vector<int64_t> size_changes(STAMP_CONCURRENT_TRANSACTIONS, 0);
+    std::vector<std::function<void(Transaction *)>> funcs;
+    funcs.reserve(STAMP_CONCURRENT_TRANSACTIONS);
+    for (size_t i = 0; i < STAMP_CONCURRENT_TRANSACTIONS; i++) {
+        funcs.emplace_back([&, i](Transaction *transaction) {
+            int64_t size_change = transaction->Load(&size_changes[i]);
+            for (int op = 0; op < INTSET_OPERATIONS; op++) {
+                int64_t key = Random::Uniform(range);
+                size_t action = Random::Uniform(100);
+                if (action < update_rate / 2) {
+                    size_change += set->Add(transaction, key) ? 1 : 0;
+                } else if (action < update_rate) {
+                    size_change -= set->Remove(transaction, key) ? 1 : 0;
+                } else {
+                    set->Contains(transaction, key);
+                }
+            }
+            transaction->Store(&size_changes[i], size_change);
+        });
+    }
+
+    auto details = RunWorkload(transaction_manager, funcs, STAMP_ITERATIONS);
+
+    int64_t expected_size = initial_size;
+    for (auto size_change : size_changes) {
+        expected_size += size_change;
+    }
+    int64_t size = Atomically(transaction_manager, [&](Transaction &transaction) {
+        int64_t contained = 0;
+        for (int64_t key = 0; key < range; key++) {
+            contained += set->Contains(&transaction, key) ? 1 : 0;
+        }
+        return contained;
+    });
+    if (size != expected_size) {
+        ReportViolation(name, "size doesn't match successful inserts and removes");
+    }
+    return details;
+}
+
+enum VacationItemType {
+    CAR, FLIGHT, ROOM, NUM_ITEM_TYPES
+};
+
+struct VacationItem {
+    int64_t total_;
+    int64_t used_;
+    int64_t price_;
+};
+
+struct VacationCustomer {
+    int64_t bill_;
+    size_t num_reservations_;
+    /** type * VACATION_RELATIONS + id of every reserved item */
+    std::array<int64_t, VACATION_MAX_CUSTOMER_RESERVATIONS> reservations_;
+};
+
+struct Vacation {
+    std::array<TMap<int64_t, VacationItem>, NUM_ITEM_TYPES> items_;
+    TMap<int64_t, VacationCustomer> customers_;
+
+    /**
+     * Query random items and reserve the most expensive available one of each type for a customer
+     */
+    void MakeReservation(Transaction *transaction) {
+        std::array<int64_t, NUM_ITEM_TYPES> best_ids;
+        std::array<int64_t, NUM_ITEM_TYPES> best_prices;
+        best_ids.fill(-1);
+        best_prices.fill(-1);
+        for (int query = 0; query < VACATION_QUERIES; query++) {
+            int type = Random::Uniform(NUM_ITEM_TYPES);
+            int64_t id = Random::Uniform(VACATION_RELATIONS);
+            VacationItem item;
+            if (items_[type].Get(transaction, id, &item) && item.used_ < item.total_ &&
+                item.price_ > best_prices[type]) {
+                best_ids[type] = id;
+                best_prices[type] = item.price_;
+            }
+        }
+
+        int64_t customer_id = Random::Uniform(VACATION_CUSTOMERS);
+        VacationCustomer customer{};
+        customers_.Get(transaction, customer_id, &customer);
+        bool reserved = false;
+        for (int type = 0; type < NUM_ITEM_TYPES; type++) {
+            if (best_ids[type] < 0 || customer.num_reservations_ == VACATION_MAX_CUSTOMER_RESERVATIONS) {
+                continue;
+            }
+            VacationItem item;
+            items_[type].Get(transaction, best_ids[type], &item);
+            item.used_++;
+            items_[type].Put(transaction, best_ids[type], item);
+            customer.reservations_[customer.num_reservations_++] = type * VACATION_RELATIONS + best_ids[type];
+            customer.bill_ += item.price_;
+            reserved = true;
+        }
+        if (reserved) {
+            customers_.Put(transaction, customer_id, customer);
+        }
+    }
+
+    /**
+     * Cancel all of a customer's reservations
+     */
+    void DeleteCustomer(Transaction *transaction) {
+        int64_t customer_id = Random::Uniform(VACATION_CUSTOMERS);
+        VacationCustomer customer;
+        if (!customers_.Get(transaction, customer_id, &customer)) {
+            return;
+        }
+        for (size_t i = 0; i < customer.num_reservations_; i++) {
+            int64_t type = customer.reservations_[i] / VACATION_RELATIONS;
+            int64_t id = customer.reservations_[i] % VACATION_RELATIONS;
+            VacationItem item;
+            items_[type].Get(transaction, id, &item);
+            item.used_--;
+            items_[type].Put(transaction, id, item);
+        }
+        customers_.Erase(transaction, customer_id);
+    }
+
+    /**
+     * Add capacity to random items or remove items nobody reserved
+     */
+    void UpdateTables(Transaction *transaction) {
+        for (int query = 0; query < VACATION_QUERIES; query++) {
+            int type = Random::Uniform(NUM_ITEM_TYPES);
+            int64_t id = Random::Uniform(VACATION_RELATIONS);
+            VacationItem item;
+            bool exists = items_[type].Get(transaction, id, &item);
+            if (Random::Uniform(2) == 0) {
+                if (!exists) {
+                    item = {0, 0, static_cast<int64_t>(Random::Uniform(5)) * 10 + 50};
+                }
+                item.total_ += VACATION_ITEM_CAPACITY;
+                items_[type].Put(transaction, id, item);
+            } else if (exists && item.used_ == 0) {
+                items_[type].Erase(transaction, id);
+            }
+        }
+    }
+
+    /**
+     * Check that no item is overbooked and reservations match what customers hold
+     */
+    void Validate(Transaction *transaction) {
+        std::array<std::vector<int64_t>, NUM_ITEM_TYPES> held;
+        for (auto &type_held : held) {
+            type_held.assign(VACATION_RELATIONS, 0);
+        }
+        for (int64_t customer_id = 0; customer_id < VACATION_CUSTOMERS; customer_id++) {
+            VacationCustomer customer;
+            if (customers_.Get(transaction, customer_id, &customer)) {
+                for (size_t i = 0; i < customer.num_reservations_; i++) {
+                    held[customer.reservations_[i] / VACATION_RELATIONS][customer.reservations_[i] %
+                                                                        VACATION_RELATIONS]++;
+                }
+            }
+        }
+        for (int type = 0; type < NUM_ITEM_TYPES; type++) {
+            for (int64_t id = 0; id < VACATION_RELATIONS; id++) {
+                VacationItem item{0, 0, 0};
+                items_[type].Get(transaction, id, &item);
+                if (item.used_ < 0 || item.used_ > item.total_ || item.used_ != held[type][id]) {
+                    ReportViolation("Vacation", "item reservations don't match customers");
+                    return;
+                }
+            }
+        }
+    }
+};
+
+struct KMeansAccumulator {
+    double x_;
+    double y_;
+    int64_t count_;
+};
+
+}
+
+void IntSetListWorkload(TransactionManager *transaction_manager, size_t update_rate) {
+    TListSet set;
+    PrintRunDetails(transaction_manager,
+                    RunIntSet(transaction_manager, "IntSet linked list", &set, INTSET_LIST_RANGE, update_rate));
+    TListSet elastic_set(true);
+    PrintRunDetails(transaction_manager, RunIntSet(transaction_manager, "IntSet elastic linked list", &elastic_set,
+                                                   INTSET_LIST_RANGE, update_rate));
+}
+
+void IntSetRbTreeWorkload(TransactionManager *transaction_manager, size_t update_rate) {
+    TRbTreeSet set;
+    auto details = RunIntSet(transaction_manager, "IntSet red-black tree", &set, INTSET_RANGE, update_rate);
+    if (!set.Validate()) {
+        ReportViolation("IntSet red-black tree", "tree is unbalanced or out of order");
+    }
+    PrintRunDetails(transaction_manager, details);
+}
+
+void IntSetHashWorkload(TransactionManager *transaction_manager, size_t update_rate) {
+    THashSet set;
+    PrintRunDetails(transaction_manager,
+                    RunIntSet(transaction_manager, "IntSet hash set", &set, INTSET_RANGE, update_rate));
+}
+
+void VacationWorkload(TransactionManager *transaction_manager) {
+    std::cout << "Vacation" << std::endl;
+
+    Vacation vacation;
+    for (int type = 0; type < NUM_ITEM_TYPES; type++) {
+        RunTransaction(transaction_manager, [&](Transaction *transaction) {
+            for (int64_t id = 0; id < VACATION_RELATIONS; id++) {
+                vacation.items_[type].Put(transaction, id, {VACATION_ITEM_CAPACITY, 0, static_cast<int64_t>(Random::Uniform(5)) * 10 + 50});
+            }
+        });
+    }
+
+    std::vector<std::function<void(Transaction *)>> funcs;
+    funcs.reserve(STAMP_CONCURRENT_TRANSACTIONS);
+    for (size_t i = 0; i < STAMP_CONCURRENT_TRANSACTIONS; i++) {
+        funcs.emplace_back([&](Transaction *transaction) {
+            // Same mix as STAMP's low contention configuration
+            int action = Random::Uniform(100);
+            if (action < 90) {
+                vacation.MakeReservation(transaction);
+            } else if (action < 95) {
+                vacation.DeleteCustomer(transaction);
+            } else {
+                vacation.UpdateTables(transaction);
+            }
+        });
+    }
+
+    auto details = RunWorkload(transaction_manager, funcs, STAMP_ITERATIONS);
+    RunTransaction(transaction_manager, [&](Transaction *transaction) { vacation.Validate(transaction); });
+    PrintRunDetails(transaction_manager, details);
+}
+
+void KMeansWorkload(TransactionManager *transaction_manager) {
+    std::cout << "K-means with " << KMEANS_CLUSTERS << " clusters" << std::endl;
+
+    // Points scattered around evenly spaced true centers
+    std::vector<std::pair<double, double>> points;
+    points.reserve(KMEANS_POINTS);
+    for (int i = 0; i < KMEANS_POINTS; i++) {
+        double center = Random::Uniform(KMEANS_CLUSTERS) * 100.0;
+        points.emplace_back(center + Random::Uniform(50), center - Random::Uniform(50));
+    }
+    std::vector<std::pair<double, double>> centers(points.begin(), points.begin() + KMEANS_CLUSTERS);
+
+    size_t aborts = 0;
+    size_t time_taken = 0;
+    for (int pass = 0; pass < KMEANS_PASSES; pass++) {
+        std::vector<KMeansAccumulator> accumulators(KMEANS_CLUSTERS, {0, 0, 0});
+        // Next point of each function, advanced only when the transaction commits
+        std::vector<uint64_t> cursors(STAMP_CONCURRENT_TRANSACTIONS, 0);
+        std::vector<std::function<void(Transaction *)>> funcs;
+        funcs.reserve(STAMP_CONCURRENT_TRANSACTIONS);
+        for (size_t i = 0; i < STAMP_CONCURRENT_TRANSACTIONS; i++) {
+            funcs.emplace_back([&, i](Transaction *transaction) {
+                uint64_t cursor = transaction->Load(&cursors[i]);
+                size_t point = i + cursor * STAMP_CONCURRENT_TRANSACTIONS;
+                if (point >= points.size()) {
+                    return;
+                }
+                size_t nearest = 0;
+                double nearest_distance = std::numeric_limits<double>::max();
+                for (size_t cluster = 0; cluster < centers.size(); cluster++) {
+                    double distance = std::hypot(points[point].first - centers[cluster].first,
+                                                 points[point].second - centers[cluster].second);
+                    if (distance < nearest_distance) {
+                        nearest = cluster;
+                        nearest_distance = distance;
+                    }
+                }
+                // Concurrent points of the same cluster commute instead of conflicting
+                transaction->Add(&accumulators[nearest].x_, points[point].first);
+                transaction->Add(&accumulators[nearest].y_, points[point].second);
+                transaction->Add(&accumulators[nearest].count_, int64_t{1});
+                transaction->Store(&cursors[i], cursor + 1);
+            });
+        }
+
+        auto details = RunWorkload(transaction_manager, funcs,
+                                   (KMEANS_POINTS + STAMP_CONCURRENT_TRANSACTIONS - 1) / STAMP_CONCURRENT_TRANSACTIONS);
+        aborts += details.aborts_;
+        time_taken += details.time_taken_;
+
+        int64_t assigned = 0;
+        for (size_t cluster = 0; cluster < centers.size(); cluster++) {
+            assigned += accumulators[cluster].count_;
+            if (accumulators[cluster].count_ > 0) {
+                centers[cluster] = {accumulators[cluster].x_ / accumulators[cluster].count_,
+                                    accumulators[cluster].y_ / accumulators[cluster].count_};
+            }
+        }
+        if (assigned != KMEANS_POINTS) {
+            ReportViolation("K-means", "points were lost or assigned twice");
+        }
+    }
+
+    PrintRunDetails(transaction_manager, {aborts, time_taken});
+}
+
+void BankWorkload(TransactionManager *transaction_manager) {
+    std::cout << "Bank with " << BANK_AUDIT_PERCENT << "% audits" << std::endl;
+
+    std::vector<double> accounts(BANK_ACCOUNTS, BANK_INITIAL_BALANCE);
+    double expected_total = BANK_ACCOUNTS * BANK_INITIAL_BALANCE;
+    // Last audited total of each function, checked once the run is over since doomed transactions may see anything
+    std::vector<double> audits(STAMP_CONCURRENT_TRANSACTIONS, expected_total);
+    std::vector<std::function<void(Transaction *)>> funcs;
+    funcs.reserve(STAMP_CONCURRENT_TRANSACTIONS);
+    for (size_t i = 0; i < STAMP_CONCURRENT_TRANSACTIONS; i++) {
+        funcs.emplace_back([&, i](Transaction *transaction) {
+            if (Random::Uniform(100) < BANK_AUDIT_PERCENT) {
+                double total = 0;
+                for (auto &account : accounts) {
+                    total += transaction->Load(&account);
+                }
+                transaction->Store(&audits[i], total);
+            } else {
+                size_t from = Random::Uniform(BANK_ACCOUNTS);
+                size_t to = Random::Uniform(BANK_ACCOUNTS);
+                double amount = Random::Uniform(100);
+                // Transfers only move money, so concurrent transfers touching an account commute
+                transaction->Add(&accounts[from], -amount);
+                transaction->Add(&accounts[to], amount);
+            }
+        });
+    }
+
+    auto details = RunWorkload(transaction_manager, funcs, STAMP_ITERATIONS);
+
+    double total = 0;
+    for (auto account : accounts) {
+        total += account;
+    }
+    if (std::abs(total - expected_total) > 0.01) {
+        ReportViolation("Bank", "money was created or destroyed");
+    }
+    for (auto audit : audits) {
+        if (std::abs(audit - expected_total) > 0.01) {
+            ReportViolation("Bank", "an audit saw an inconsistent total");
+        }
+    }
+    PrintRunDetails(transaction_manager, details);
+}
+
+void StampWorkloads(TransactionManager *transaction_manager, size_t update_rate) {
+    IntSetListWorkload(transaction_manager, update_rate);
+    IntSetRbTreeWorkload(transaction_manager, update_rate);
+    IntSetHashWorkload(transaction_manager, update_rate);
+    VacationWorkload(transaction_manager);
+    KMeansWorkload(transaction_manager);
+    BankWorkload(transaction_manager);
+}
@@ -0,0 +1,221 @@
+#include "include/tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr char TRACE_MAGIC[8] = {'T', 'M', 'T', 'R', 'A', 'C', 'E', '1'};
+
+struct TraceFileHeader {
+    char magic_[8];
+    uint64_t event_count_;
+};
+
+/**
+ * Single producer ring buffer. Only the owning thread writes, DumpBinary reads once the owner is quiescent.
+ */
+struct TraceLane {
+    TraceLane(uint32_t id, size_t capacity) : id_(id), events_(capacity), head_(0) {}
+
+    const uint32_t id_;
+    std::vector<TraceEvent> events_;
+    std::atomic<uint64_t> head_;
+};
+
+std::mutex lanes_mutex;
+std::vector<std::unique_ptr<TraceLane>> lanes;
+std::vector<TraceLane *> free_lanes;
+size_t lane_capacity = Tracer::DEFAULT_LANE_CAPACITY;
+std::chrono::steady_clock::time_point trace_start;
+
+/**
+ * Hands the lane back to the free list when the owning thread exits
+ */
+struct LaneHandle {
+    ~LaneHandle() {
+        if (lane_ != nullptr) {
+            std::lock_guard<std::mutex> lock(lanes_mutex);
+            free_lanes.push_back(lane_);
+        }
+    }
+
+    TraceLane *lane_ = nullptr;
+};
+
+thread_local LaneHandle lane_handle;
+
+TraceLane *AcquireLane() {
+    std::lock_guard<std::mutex> lock(lanes_mutex);
+    if (!free_lanes.empty()) {
+        auto *lane = free_lanes.back();
+        free_lanes.pop_back();
+        return lane;
+    }
+    lanes.push_back(std::make_unique<TraceLane>(static_cast<uint32_t>(lanes.size()), lane_capacity));
+    return lanes.back().get();
+}
+
+const char *TransactionOutcome(TraceEventType type) {
+    return type == TraceEventType::COMMIT ? "commit" : "abort";
+}
+
+void WriteCommonFields(std::ofstream &out, const char *phase, uint64_t timestamp, uint32_t lane) {
+    out << "\"ph\":\"" << phase << "\",\"ts\":" << static_cast<double>(timestamp) / 1000.0
+        << ",\"pid\":1,\"tid\":" << lane;
+}
+
+}
+
+void Tracer::Enable(size_t capacity) {
+    {
+        std::lock_guard<std::mutex> lock(lanes_mutex);
+        lane_capacity = std::max<size_t>(capacity, 1);
+    }
+    trace_start = std::chrono::steady_clock::now();
+    enabled_.store(true, std::memory_order_release);
+}
+
+void Tracer::Disable() {
+    enabled_.store(false, std::memory_order_release);
+}
+
+void Tracer::RecordSlow(TraceEventType type, uint64_t transaction_id, uint64_t arg) {
+    if (lane_handle.lane_ == nullptr) {
+        lane_handle.lane_ = AcquireLane();
+    }
+    auto *lane = lane_handle.lane_;
+    auto timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - trace_start).count());
+
+    uint64_t head = lane->head_.load(std::memory_order_relaxed);
+    auto &event = lane->events_[head % lane->events_.size()];
+    event.timestamp_ = timestamp;
+    event.transaction_id_ = transaction_id;
+    event.arg_ = arg;
+    event.lane_ = lane->id_;
+    event.type_ = type;
+    lane->head_.store(head + 1, std::memory_order_release);
+}
+
+size_t Tracer::DumpBinary(const std::string &path) {
+    std::vector<TraceEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(lanes_mutex);
+        for (const auto &lane : lanes) {
+            uint64_t head = lane->head_.load(std::memory_order_acquire);
+            uint64_t capacity = lane->events_.size();
+            for (uint64_t i = head > capacity ? head - capacity : 0; i < head; i++) {
+                events.push_back(lane->events_[i % capacity]);
+            }
+        }
+    }
+
+    TraceFileHeader header{};
+    std::memcpy(header.magic_, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.event_count_ = events.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(events.data()),
+              static_cast<std::streamsize>(events.size() * sizeof(TraceEvent)));
+    return events.size();
+}
+
+/*
+ * Transactions and stalls become complete ("X") slices on the lane that ran them so nesting shows up in the viewer.
+ * Loads, stores and kills are instant events. Events whose begin was overwritten in the ring buffer are dropped.
+ */
+void Tracer::ConvertToChromeJson(const std::string &binary_path, const std::string &json_path) {
+    std::ifstream in(binary_path, std::ios::binary);
+    TraceFileHeader header{};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic_, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        throw std::runtime_error("Not a transactional memory trace file: " + binary_path);
+    }
+    std::vector<TraceEvent> events(header.event_count_);
+    if (!in.read(reinterpret_cast<char *>(events.data()),
+                 static_cast<std::streamsize>(events.size() * sizeof(TraceEvent)))) {
+        throw std::runtime_error("Truncated transactional memory trace file: " + binary_path);
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const TraceEvent &a, const TraceEvent &b) {
+        return a.lane_ != b.lane_ ? a.lane_ < b.lane_ : a.timestamp_ < b.timestamp_;
+    });
+
+    std::ofstream out(json_path, std::ios::trunc);
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() -> std::ofstream & {
+        if (!first) {
+            out << ",\n";
+        }
+        first = false;
+        return out;
+    };
+
+    const TraceEvent *open_transaction = nullptr;
+    const TraceEvent *open_stall = nullptr;
+    uint32_t current_lane = UINT32_MAX;
+    for (const auto &event : events) {
+        if (event.lane_ != current_lane) {
+            current_lane = event.lane_;
+            open_transaction = nullptr;
+            open_stall = nullptr;
+            separator() << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << current_lane
+                        << R"(,"args":{"name":"lane )" << current_lane << "\"}}";
+        }
+
+        switch (event.type_) {
+            case TraceEventType::BEGIN:
+                open_transaction = &event;
+                break;
+            case TraceEventType::COMMIT:
+            case TraceEventType::ABORT:
+                if (open_transaction != nullptr && open_transaction->transaction_id_ == event.transaction_id_) {
+                    separator() << "{\"name\":\"txn " << event.transaction_id_ << "\",\"cat\":\"transaction\",";
+                    WriteCommonFields(out, "X", open_transaction->timestamp_, event.lane_);
+                    out << ",\"dur\":" << static_cast<double>(event.timestamp_ - open_transaction->timestamp_) / 1000.0
+                        << ",\"args\":{\"id\":" << event.transaction_id_ << ",\"outcome\":\""
+                        << TransactionOutcome(event.type_) << "\"}}";
+                }
+                open_transaction = nullptr;
+                break;
+            case TraceEventType::STALL_BEGIN:
+                open_stall = &event;
+                break;
+            case TraceEventType::STALL_END:
+                if (open_stall != nullptr && open_stall->transaction_id_ == event.transaction_id_) {
+                    separator() << R"({"name":"stall","cat":"stall",)";
+                    WriteCommonFields(out, "X", open_stall->timestamp_, event.lane_);
+                    out << ",\"dur\":" << static_cast<double>(event.timestamp_ - open_stall->timestamp_) / 1000.0
+                        << ",\"args\":{\"txn\":" << event.transaction_id_ << ",\"blocked_on\":" << open_stall->arg_
+                        << "}}";
+                }
+                open_stall = nullptr;
+                break;
+            case TraceEventType::LOAD:
+            case TraceEventType::STORE:
+                separator() << "{\"name\":\"" << (event.type_ == TraceEventType::LOAD ? "load" : "store")
+                            << "\",\"cat\":\"access\",\"s\":\"t\",";
+                WriteCommonFields(out, "i", event.timestamp_, event.lane_);
+                out << ",\"args\":{\"txn\":" << event.transaction_id_ << ",\"address\":\"0x" << std::hex
+                    << event.arg_ << std::dec << "\"}}";
+                break;
+            case TraceEventType::KILL:
+                separator() << R"({"name":"kill","cat":"abort","s":"t",)";
+                WriteCommonFields(out, "i", event.timestamp_, event.lane_);
+                out << ",\"args\":{\"txn\":" << event.transaction_id_ << ",\"victim\":" << event.arg_ << "}}";
+                break;
+        }
+    }
+    out << "]}\n";
+}
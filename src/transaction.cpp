@@ -1,25 +1,283 @@
+#include <chrono>
 #include <iostream>
 #include "include/transaction.h"
 #include "include/abort_exception.h"
 #include "include/invalid_state_exception.h"
+#include "include/transactional_allocator.h"
+#include "include/range_lazy_version_manager.h"
+
+/**
+ *
+ * @return nanoseconds since an arbitrary point, or the virtual clock on a simulated core
+ */
+static uint64_t AdaptiveClock() {
+    if (VirtualTimeScheduler::IsSimulating()) {
+        return VirtualTimeScheduler::Now();
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
 
 Transaction::Transaction(uint64_t transaction_id, TransactionManager *transaction_manager,
-                         bool use_lazy_versioning) :
-        transaction_id_(transaction_id), transaction_manager_(transaction_manager), state_(0) {
-    if (use_lazy_versioning) {
-        version_manager_ = std::make_unique<LazyVersionManager>();
+                         bool use_lazy_versioning, const HtmConfig *htm_config, uint32_t slot) :
+        transaction_id_(transaction_id), slot_(slot), transaction_manager_(transaction_manager), state_(0) {
+    auto *region = transaction_manager->GetPersistentRegion();
+    if (use_lazy_versioning && transaction_manager->GetGranuleSize() != 0) {
+        version_manager_ = std::make_unique<RangeLazyVersionManager>(region, transaction_id);
+    } else if (use_lazy_versioning) {
+        version_manager_ = std::make_unique<LazyVersionManager>(region, transaction_id);
     } else {
-        version_manager_ = std::make_unique<EagerVersionManager>();
+        version_manager_ = std::make_unique<EagerVersionManager>(region, transaction_id);
+    }
+    if (htm_config != nullptr) {
+        htm_cache_ = std::make_unique<HtmCacheModel>(*htm_config);
+    }
+    if (transaction_manager->IsAdaptiveModeEnabled()) {
+        timed_ = true;
+        begin_time_ = AdaptiveClock();
     }
+    TransactionalAllocator::Pin();
+}
+
+Transaction::~Transaction() {
+    TransactionalAllocator::Unpin();
+    if (timed_) {
+        transaction_manager_->FinishAdaptiveTransaction(
+                {state_ == COMMITTING, read_set_.size() + write_set_.size(), write_set_.size(), stall_time_,
+                 AdaptiveClock() - begin_time_});
+    }
+}
+
+void *Transaction::Alloc(size_t size) {
+    void *block = TransactionalAllocator::Allocate(size);
+    allocations_.push_back(block);
+    return block;
+}
+
+void Transaction::Free(void *block) {
+    frees_.push_back(block);
 }
 
 void Transaction::Abort() {
     state_ = ABORTED;
+    Tracer::Record(TraceEventType::ABORT, transaction_id_);
     version_manager_->Abort();
+    // Nothing outside this transaction ever saw these blocks
+    for (auto *block : allocations_) {
+        TransactionalAllocator::Deallocate(block);
+    }
+    allocations_.clear();
+    frees_.clear();
+    updates_.clear();
     abort_cv_.notify_all();
 }
 
+void Transaction::TrackStore(void *address, size_t len, ReaderBitmap *metadata) {
+    size_t granule_size = transaction_manager_->GetGranuleSize();
+    // Embedded metadata already covers the whole value
+    if (granule_size == 0 || metadata != nullptr) {
+        TrackStoreUnit(address, metadata);
+        return;
+    }
+    auto end = reinterpret_cast<uintptr_t>(address) + len;
+    for (auto granule = reinterpret_cast<uintptr_t>(address) & ~(granule_size - 1); granule < end;
+         granule += granule_size) {
+        TrackStoreUnit(reinterpret_cast<void *>(granule), nullptr);
+    }
+}
+
+bool Transaction::TrackLoad(void *address, size_t len, ReaderBitmap *metadata, bool may_suspend) {
+    size_t granule_size = transaction_manager_->GetGranuleSize();
+    if (granule_size == 0 || metadata != nullptr) {
+        return TrackLoadUnit(address, metadata, may_suspend);
+    }
+    auto end = reinterpret_cast<uintptr_t>(address) + len;
+    for (auto granule = reinterpret_cast<uintptr_t>(address) & ~(granule_size - 1); granule < end;
+         granule += granule_size) {
+        if (!TrackLoadUnit(reinterpret_cast<void *>(granule), nullptr, may_suspend)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Transaction::ReleaseRange(void *address, size_t len) {
+    size_t granule_size = transaction_manager_->GetGranuleSize();
+    if (granule_size == 0 || GetEmbeddedMetadata(address) != nullptr) {
+        ReleaseUnit(address);
+        return;
+    }
+    auto end = reinterpret_cast<uintptr_t>(address) + len;
+    for (auto granule = reinterpret_cast<uintptr_t>(address) & ~(granule_size - 1); granule < end;
+         granule += granule_size) {
+        ReleaseUnit(reinterpret_cast<void *>(granule));
+    }
+}
+
+void Transaction::ReleaseUnit(void *address) {
+    if (write_set_.count(address) > 0 || read_set_.erase(address) == 0) {
+        return;
+    }
+    for (auto &scope : nested_scopes_) {
+        scope.read_set_.erase(address);
+    }
+    transaction_manager_->ReleaseRead(address, this);
+    embedded_metadata_.erase(address);
+}
+
+bool Transaction::RemoveOrecRead(Orec *orec) {
+    auto reads = orec_reads_.find(orec);
+    if (reads == orec_reads_.end() || --reads->second > 0) {
+        return false;
+    }
+    orec_reads_.erase(reads);
+    return true;
+}
+
+void Transaction::BeginElastic(size_t window) {
+    if (window == 0) {
+        throw InvalidStateException("An elastic section has to keep at least one read");
+    }
+    elastic_window_ = window;
+    elastic_reads_.clear();
+}
+
+void Transaction::EndElastic() {
+    elastic_window_ = 0;
+    elastic_reads_.clear();
+}
+
+void Transaction::TrackStoreUnit(void *address, ReaderBitmap *metadata) {
+    last_access_ = address;
+    transaction_manager_->Store(address, this, metadata);
+    if (write_set_.emplace(address).second) {
+        if (metadata != nullptr) {
+            embedded_metadata_.emplace(address, metadata);
+        }
+        if (!nested_scopes_.empty()) {
+            nested_scopes_.back().write_set_.emplace(address);
+        }
+    }
+}
+
+void Transaction::TrackUpdate(void *address, size_t len, CommutativeOp op) {
+    size_t granule_size = transaction_manager_->GetGranuleSize();
+    if (granule_size == 0) {
+        TrackUpdateUnit(address, op);
+        return;
+    }
+    auto end = reinterpret_cast<uintptr_t>(address) + len;
+    for (auto granule = reinterpret_cast<uintptr_t>(address) & ~(granule_size - 1); granule < end;
+         granule += granule_size) {
+        TrackUpdateUnit(reinterpret_cast<void *>(granule), op);
+    }
+}
+
+void Transaction::TrackUpdateUnit(void *address, CommutativeOp op) {
+    last_access_ = address;
+    transaction_manager_->Update(address, this, op);
+    if (write_set_.emplace(address).second && !nested_scopes_.empty()) {
+        nested_scopes_.back().write_set_.emplace(address);
+    }
+}
+
+void Transaction::ApplyPendingUpdates(void *address, void *value) const {
+    // Only updates after the last store to address are still pending
+    size_t first = updates_.size();
+    while (first > 0 && !(updates_[first - 1].address_ == address && updates_[first - 1].op_ == CommutativeOp::NONE)) {
+        first--;
+    }
+    for (size_t i = first; i < updates_.size(); i++) {
+        if (updates_[i].address_ == address) {
+            updates_[i].apply_(updates_[i], value, false);
+        }
+    }
+}
+
+void Transaction::CancelPendingUpdates(void *address) {
+    for (auto update = updates_.rbegin(); update != updates_.rend(); ++update) {
+        if (update->address_ != address) {
+            continue;
+        }
+        // Nothing pending if an earlier store already cancelled the updates
+        if (update->op_ != CommutativeOp::NONE) {
+            // Nested aborts truncate updates_, which also drops the cancellation of a rolled back store
+            updates_.push_back({address, CommutativeOp::NONE, {}, nullptr});
+        }
+        return;
+    }
+}
+
+void Transaction::ApplyUpdates() {
+    // Addresses stored to after the update being looked at, walking backwards
+    std::unordered_set<void *> cancelled;
+    std::vector<bool> applied(updates_.size());
+    for (size_t i = updates_.size(); i > 0; i--) {
+        auto &update = updates_[i - 1];
+        if (update.op_ == CommutativeOp::NONE) {
+            cancelled.emplace(update.address_);
+        } else {
+            applied[i - 1] = cancelled.count(update.address_) == 0;
+        }
+    }
+    for (size_t i = 0; i < updates_.size(); i++) {
+        if (applied[i]) {
+            updates_[i].apply_(updates_[i], updates_[i].address_, true);
+        }
+    }
+}
+
+bool Transaction::TrackLoadUnit(void *address, ReaderBitmap *metadata, bool may_suspend) {
+    last_access_ = address;
+    if (may_suspend && metadata == nullptr) {
+        if (!transaction_manager_->TryLoad(address, this)) {
+            return false;
+        }
+    } else {
+        transaction_manager_->Load(address, this, metadata);
+    }
+    if (read_set_.emplace(address).second) {
+        if (metadata != nullptr) {
+            embedded_metadata_.emplace(address, metadata);
+        }
+        if (!nested_scopes_.empty()) {
+            nested_scopes_.back().read_set_.emplace(address);
+        }
+        if (elastic_window_ > 0) {
+            elastic_reads_.push_back(address);
+            if (elastic_reads_.size() > elastic_window_) {
+                void *oldest = elastic_reads_.front();
+                elastic_reads_.pop_front();
+                ReleaseUnit(oldest);
+            }
+        }
+    }
+    return true;
+}
+
+void Transaction::XBegin() {
+    VirtualTimeScheduler::Charge(SimulatedOperation::BEGIN);
+    nested_scopes_.push_back({{}, {}, allocations_.size(), frees_.size(), updates_.size()});
+    version_manager_->BeginNested();
+}
+
 void Transaction::XEnd() {
+    OperationProfileScope operation_scope(ProfileOperation::COMMIT);
+    VirtualTimeScheduler::Charge(SimulatedOperation::COMMIT);
+    if (!nested_scopes_.empty()) {
+        auto child = std::move(nested_scopes_.back());
+        nested_scopes_.pop_back();
+        {
+            ProfileScope version_scope(ProfilePhase::VERSION_MANAGER);
+            version_manager_->CommitNested();
+        }
+        if (!nested_scopes_.empty()) {
+            auto &parent = nested_scopes_.back();
+            parent.write_set_.insert(child.write_set_.begin(), child.write_set_.end());
+            parent.read_set_.insert(child.read_set_.begin(), child.read_set_.end());
+        }
+        return;
+    }
     int cur_val = RUNNING;
     bool exchanged = state_.compare_exchange_strong(cur_val, COMMITTING);
     if (!exchanged && cur_val == ABORTED) {
@@ -28,11 +286,43 @@ void Transaction::XEnd() {
         std::cerr << "Tried to commit an already committing transaction" << std::endl;
     } else if (exchanged) {
         transaction_manager_->ResolveConflictsAtCommit(this);
-        version_manager_->XEnd();
+        {
+            ProfileScope version_scope(ProfilePhase::VERSION_MANAGER);
+            version_manager_->XEnd();
+            // After the transaction's own writes, which they were combined with
+            ApplyUpdates();
+        }
         transaction_manager_->XEnd(this);
+        for (auto *block : frees_) {
+            TransactionalAllocator::Retire(block);
+        }
+        Tracer::Record(TraceEventType::COMMIT, transaction_id_);
     }
 }
 
+void Transaction::AbortNested() {
+    if (nested_scopes_.empty()) {
+        throw InvalidStateException("No nested transaction to abort");
+    }
+    auto child = std::move(nested_scopes_.back());
+    nested_scopes_.pop_back();
+    // Restore memory before giving up ownership of the addresses
+    version_manager_->AbortNested();
+    for (auto *address : child.write_set_) {
+        write_set_.erase(address);
+    }
+    for (auto *address : child.read_set_) {
+        read_set_.erase(address);
+    }
+    for (size_t i = child.allocations_begin_; i < allocations_.size(); i++) {
+        TransactionalAllocator::Deallocate(allocations_[i]);
+    }
+    allocations_.resize(child.allocations_begin_);
+    frees_.resize(child.frees_begin_);
+    updates_.resize(child.updates_begin_);
+    transaction_manager_->AbortNested(this, child.write_set_, child.read_set_);
+}
+
 uint64_t Transaction::GetTransactionId() const {
     return transaction_id_;
 }
@@ -43,25 +333,45 @@ bool Transaction::MarkAborted() {
     return exchanged || cur_val == ABORTED;
 }
 
-bool Transaction::MarkStalledTransactionAborted(std::unique_lock<std::shared_mutex> *exclusive_write_lock,
-                                                std::condition_variable_any *read_stall_cv) {
+bool Transaction::MarkStalledTransactionAborted(std::unique_lock<std::shared_mutex> *exclusive_write_lock) {
     int cur_val = STALLED;
     bool exchanged = state_.compare_exchange_strong(cur_val, ABORTED);
     if (exchanged) {
-        read_stall_cv->notify_all();
-        abort_cv_.wait(*exclusive_write_lock);
+        // Other transactions may share the queue, they recheck their predicate and go back to sleep
+        stall_queue_->notify_all();
+        // A simulated or suspended stalled transaction can only clean up after we yield, so don't wait for it
+        if (!VirtualTimeScheduler::IsSimulating() && !suspended_) {
+            ProfileScope stall_scope(ProfilePhase::STALL_WAIT);
+            abort_cv_.wait(*exclusive_write_lock);
+        }
     }
     return exchanged;
 }
 
-bool Transaction::MarkStalled() {
+bool Transaction::MarkStalled(std::condition_variable_any *stall_queue, bool suspended) {
+    stall_queue_ = stall_queue;
+    suspended_ = suspended;
+    if (timed_) {
+        stall_begin_time_ = AdaptiveClock();
+    }
     int cur_val = RUNNING;
     bool exchanged = state_.compare_exchange_strong(cur_val, STALLED);
     return exchanged;
 }
 
 bool Transaction::MarkUnstalled() {
+    if (timed_) {
+        stall_time_ += AdaptiveClock() - stall_begin_time_;
+    }
     int cur_val = STALLED;
     bool exchanged = state_.compare_exchange_strong(cur_val, RUNNING);
     return exchanged;
+}
+
+void Transaction::ResumeAfterStall() {
+    Tracer::Record(TraceEventType::STALL_END, transaction_id_);
+    if (!MarkUnstalled()) {
+        transaction_manager_->Abort(this);
+    }
+    suspended_ = false;
 }
\ No newline at end of file
@@ -1,58 +1,341 @@
 #include "include/transaction_manager.h"
 
+
 #include "include/transaction.h"
 #include "include/invalid_state_exception.h"
 #include "include/abort_exception.h"
+#include "include/capacity_abort_exception.h"
+#include "include/nested_abort_exception.h"
+#include "include/profiler.h"
+#include "include/tracer.h"
+#include "include/virtual_time_scheduler.h"
+
+/** transactions begun and not yet destroyed on this thread, by any adaptive manager */
+static thread_local size_t adaptive_transactions_on_thread = 0;
+
+/**
+ * Estimate the memory taken by a map of transaction sets, every node of an unordered container holds a next pointer
+ * besides its value
+ *
+ * @param address_map map of transaction sets
+ * @return bytes of the map, its entries and their sets
+ */
+static size_t TransactionSetBytes(const std::unordered_map<void *, TransactionManager::TransactionSet> &address_map) {
+    size_t bytes = address_map.bucket_count() * sizeof(void *);
+    for (const auto &[address, transaction_set] : address_map) {
+        bytes += sizeof(void *) + sizeof(std::pair<void *const, TransactionManager::TransactionSet>);
+        bytes += transaction_set.transaction_set_.bucket_count() * sizeof(void *);
+        bytes += transaction_set.transaction_set_.size() * (sizeof(void *) + sizeof(Transaction *));
+    }
+    return bytes;
+}
 
+const char *ConflictMetadataName(ConflictMetadata conflict_metadata) {
+    switch (conflict_metadata) {
+        case ConflictMetadata::HASH_SETS:
+            return "hash";
+        case ConflictMetadata::READER_BITMAPS:
+            return "bitmap";
+        case ConflictMetadata::ORECS:
+            return "orec";
+    }
+    return "unknown";
+}
 
-TransactionManager::TransactionManager(bool use_lazy_versioning, bool use_pessimistic_conflict_detection)
+TransactionManager::TransactionManager(bool use_lazy_versioning, bool use_pessimistic_conflict_detection,
+                                       ConflictMetadata conflict_metadata)
         : use_lazy_versioning_(use_lazy_versioning),
           use_pessimistic_conflict_detection_(use_pessimistic_conflict_detection),
+          use_htm_emulation_(false),
+          use_flat_combining_(false),
+          granule_size_(0),
+          persistent_region_(nullptr),
+          htm_commits_(0),
+          software_commits_(0),
+          htm_capacity_aborts_(0),
+          htm_conflict_aborts_(0),
           next_txn_id_(0) {
 
     if (!use_lazy_versioning && !use_pessimistic_conflict_detection) {
         throw InvalidStateException("Impossible to have eager data versioning and optimistic conflict detection.");
     }
+    if (conflict_metadata == ConflictMetadata::READER_BITMAPS) {
+        if (!use_pessimistic_conflict_detection) {
+            throw InvalidStateException("Reader bitmaps only support pessimistic conflict detection.");
+        }
+        reader_bitmaps_ = std::make_unique<ReaderBitmapTable>();
+        slots_ = reader_bitmaps_.get();
+    }
+    if (conflict_metadata == ConflictMetadata::ORECS) {
+        if (!use_pessimistic_conflict_detection) {
+            throw InvalidStateException("Orecs only support pessimistic conflict detection.");
+        }
+        orecs_ = std::make_unique<OrecTable>();
+        slots_ = orecs_.get();
+    }
+}
+
+void TransactionManager::EnableHtmEmulation(const HtmConfig &config) {
+    if (config.sets_ == 0 || config.ways_ == 0 || config.line_size_ == 0) {
+        throw InvalidStateException("Simulated cache needs at least one set, way and byte per line.");
+    }
+    htm_config_ = config;
+    use_htm_emulation_ = true;
 }
 
-Transaction TransactionManager::XBegin() {
-    return Transaction(next_txn_id_++, this, use_lazy_versioning_);
+void TransactionManager::EnableFlatCombining() {
+    if (slots_ != nullptr) {
+        throw InvalidStateException("Reader bitmaps and orecs don't take global locks to commit, there is nothing to "
+                                    "combine.");
+    }
+    use_flat_combining_ = true;
 }
 
-void TransactionManager::Store(void *address, Transaction *transaction) {
-    if (use_pessimistic_conflict_detection_) {
-        std::unique_lock<std::shared_mutex> exclusive_write_lock(write_set_mutex_);
+void TransactionManager::EnableByteRanges(size_t granule_size) {
+    if (granule_size == 0 || (granule_size & (granule_size - 1)) != 0) {
+        throw InvalidStateException("Granule size must be a power of two.");
+    }
+    granule_size_ = granule_size;
+}
+
+void TransactionManager::EnablePersistence(PersistentRegion *region) {
+    if (region != nullptr && shared_memory_region_ != nullptr) {
+        throw InvalidStateException("Persistent regions are logged by a single process.");
+    }
+    persistent_region_ = region;
+}
+
+void TransactionManager::EnableSharedMemory(SharedMemoryRegion *region) {
+    if (orecs_ == nullptr) {
+        throw InvalidStateException("Only orecs can be shared between processes.");
+    }
+    if (persistent_region_ != nullptr) {
+        throw InvalidStateException("Persistent regions are logged by a single process.");
+    }
+    orecs_ = std::make_unique<OrecTable>(region->GetOrecs(), region->GetOrecCount(), region->GetSlots(),
+                                         region->GetData());
+    slots_ = orecs_.get();
+    shared_memory_region_ = region;
+}
+
+void TransactionManager::EnableAdaptiveMode(const AdaptiveConfig &config) {
+    if (slots_ != nullptr) {
+        throw InvalidStateException("Reader bitmaps and orecs only support pessimistic conflict detection, there is "
+                                    "nothing to adapt.");
+    }
+    if (config.window_transactions_ == 0 || config.low_abort_rate_ > config.high_abort_rate_ ||
+        config.low_stall_fraction_ > config.high_stall_fraction_) {
+        throw InvalidStateException("Adaptive windows need at least one transaction and low thresholds below high "
+                                    "ones.");
+    }
+    adaptive_policy_ = std::make_unique<AdaptivePolicy>(config);
+}
+
+TransactionMode TransactionManager::GetMode() {
+    std::unique_lock<std::mutex> lock(adaptive_mutex_);
+    return GetModeWithoutLocking();
+}
+
+TransactionMode TransactionManager::GetModeWithoutLocking() const {
+    if (!use_lazy_versioning_) {
+        return TransactionMode::EAGER_PESSIMISTIC;
+    }
+    return use_pessimistic_conflict_detection_ ? TransactionMode::LAZY_PESSIMISTIC : TransactionMode::LAZY_OPTIMISTIC;
+}
+
+size_t TransactionManager::GetModeSwitches() {
+    std::unique_lock<std::mutex> lock(adaptive_mutex_);
+    return mode_switches_;
+}
+
+void TransactionManager::AdmitAdaptiveTransaction() {
+    std::unique_lock<std::mutex> lock(adaptive_mutex_);
+    // Waiting while this thread runs another transaction could wait on ourselves
+    if (adaptive_transactions_on_thread == 0) {
+        VirtualTimeScheduler::Wait(adaptive_cv_, lock, [&] { return !switch_pending_; });
+    }
+    active_transactions_++;
+    adaptive_transactions_on_thread++;
+}
+
+void TransactionManager::FinishAdaptiveTransaction(const TransactionSample &sample) {
+    std::unique_lock<std::mutex> lock(adaptive_mutex_);
+    active_transactions_--;
+    adaptive_transactions_on_thread--;
+    if (!switch_pending_ && adaptive_policy_->Record(sample)) {
+        auto current = GetModeWithoutLocking();
+        auto next = adaptive_policy_->Decide(current);
+        if (next != current) {
+            switch_pending_ = true;
+            pending_mode_ = next;
+        }
+    }
+    if (switch_pending_ && active_transactions_ == 0) {
+        use_lazy_versioning_ = pending_mode_ != TransactionMode::EAGER_PESSIMISTIC;
+        use_pessimistic_conflict_detection_ = pending_mode_ != TransactionMode::LAZY_OPTIMISTIC;
+        mode_switches_++;
+        switch_pending_ = false;
+        adaptive_policy_->Reset();
+        adaptive_cv_.notify_all();
+    }
+}
+
+HtmStats TransactionManager::GetHtmStats() const {
+    return {htm_commits_, software_commits_, htm_capacity_aborts_, htm_conflict_aborts_};
+}
+
+void TransactionManager::ResetHtmStats() {
+    htm_commits_ = 0;
+    software_commits_ = 0;
+    htm_capacity_aborts_ = 0;
+    htm_conflict_aborts_ = 0;
+}
+
+Transaction TransactionManager::XBegin(bool use_htm) {
+    VirtualTimeScheduler::Charge(SimulatedOperation::BEGIN);
+    if (adaptive_policy_ != nullptr) {
+        AdmitAdaptiveTransaction();
+    }
+    uint64_t transaction_id =
+            shared_memory_region_ != nullptr ? shared_memory_region_->NextTransactionId() : next_txn_id_++;
+    Tracer::Record(TraceEventType::BEGIN, transaction_id);
+    return Transaction(transaction_id, this, use_lazy_versioning_,
+                       use_htm && use_htm_emulation_ ? &htm_config_ : nullptr,
+                       slots_ != nullptr ? slots_->AcquireSlot(transaction_id) : SlotTable::NO_SLOT);
+}
+
+void TransactionManager::Store(void *address, Transaction *transaction, ReaderBitmap *metadata) {
+    if (reader_bitmaps_ != nullptr) {
+        auto &entry = metadata != nullptr ? *metadata : reader_bitmaps_->StripeFor(address);
+        ProfileScope conflict_scope(ProfilePhase::CONFLICT_CHECK);
+        if (!reader_bitmaps_->AcquireWrite(entry, transaction->GetSlot())) {
+            if (transaction->IsNested()) {
+                throw NestedAbortException("Nested transaction aborted");
+            }
+            Abort(transaction);
+        }
+    } else if (orecs_ != nullptr) {
+        auto &orec = orecs_->OrecFor(address);
+        ProfileScope conflict_scope(ProfilePhase::CONFLICT_CHECK);
+        if (!orecs_->AcquireWrite(orec, transaction->GetSlot(), transaction->ReadsOrec(&orec))) {
+            if (transaction->IsNested()) {
+                throw NestedAbortException("Nested transaction aborted");
+            }
+            Abort(transaction);
+        }
+    } else if (use_pessimistic_conflict_detection_) {
+        auto exclusive_write_lock = ProfiledUniqueLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
 
         // Check for write conflicts - Writer loses
         if (CheckForConflictWithoutLocking(address, write_sets_, transaction)) {
-            std::unique_lock<std::shared_mutex> exclusive_read_lock(read_set_mutex_);
+            if (transaction->IsNested()) {
+                throw NestedAbortException("Nested transaction aborted");
+            }
+            auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
             AbortWithoutLocks(transaction);
             return;
         }
 
         // Check for read conflicts - Writer loses
-        std::shared_lock<std::shared_mutex> shared_read_lock(read_set_mutex_);
+        auto shared_read_lock = ProfiledSharedLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
         if (CheckForConflictWithoutLocking(address, read_sets_, transaction)) {
+            if (transaction->IsNested()) {
+                throw NestedAbortException("Nested transaction aborted");
+            }
             shared_read_lock.unlock();
-            std::unique_lock<std::shared_mutex> exclusive_read_lock(read_set_mutex_);
+            auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
             AbortWithoutLocks(transaction);
             return;
         }
 
         AddTransactionToAddressSetWithoutLocking(address, write_sets_, transaction);
+        RecordUpdateOpWithoutLocking(address, transaction, CommutativeOp::NONE);
     } else {
-        std::unique_lock<std::shared_mutex> exclusive_write_lock(write_set_mutex_);
+        auto exclusive_write_lock = ProfiledUniqueLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
         AddTransactionToAddressSetWithoutLocking(address, write_sets_, transaction);
+        RecordUpdateOpWithoutLocking(address, transaction, CommutativeOp::NONE);
     }
 }
 
-void TransactionManager::Load(void *address, Transaction *transaction) {
+void TransactionManager::Update(void *address, Transaction *transaction, CommutativeOp op) {
+    auto exclusive_write_lock = ProfiledUniqueLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
     if (use_pessimistic_conflict_detection_) {
-        std::unique_lock<std::shared_mutex> exclusive_write_lock(write_set_mutex_);
+        // Check for write conflicts other than compatible updates - Writer loses
+        if (CheckForUpdateConflictWithoutLocking(address, transaction, op)) {
+            if (transaction->IsNested()) {
+                throw NestedAbortException("Nested transaction aborted");
+            }
+            auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+            AbortWithoutLocks(transaction);
+        }
+
+        // Check for read conflicts - Writer loses
+        auto shared_read_lock = ProfiledSharedLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+        if (CheckForConflictWithoutLocking(address, read_sets_, transaction)) {
+            if (transaction->IsNested()) {
+                throw NestedAbortException("Nested transaction aborted");
+            }
+            shared_read_lock.unlock();
+            auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+            AbortWithoutLocks(transaction);
+        }
+    }
+    // Record the kind before joining the write set, joining first would look like an earlier store
+    RecordUpdateOpWithoutLocking(address, transaction, op);
+    AddTransactionToAddressSetWithoutLocking(address, write_sets_, transaction);
+}
+
+void TransactionManager::Load(void *address, Transaction *transaction, ReaderBitmap *metadata) {
+    if (reader_bitmaps_ != nullptr) {
+        auto &entry = metadata != nullptr ? *metadata : reader_bitmaps_->StripeFor(address);
+        ProfileScope conflict_scope(ProfilePhase::CONFLICT_CHECK);
+        if (!reader_bitmaps_->AcquireRead(entry, transaction->GetSlot())) {
+            Abort(transaction);
+        }
+        return;
+    }
+    if (orecs_ != nullptr) {
+        // Orecs count readers, so an address is only counted the first time it's read
+        if (transaction->GetReadSet().count(address) > 0) {
+            return;
+        }
+        auto &orec = orecs_->OrecFor(address);
+        ProfileScope conflict_scope(ProfilePhase::CONFLICT_CHECK);
+        if (transaction->AddOrecRead(&orec) && !orecs_->AcquireRead(orec, transaction->GetSlot())) {
+            transaction->RemoveOrecRead(&orec);
+            Abort(transaction);
+        }
+        return;
+    }
+    if (use_pessimistic_conflict_detection_) {
+        auto exclusive_write_lock = ProfiledUniqueLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
         while (!HandlePessimisticReadConflicts(address, transaction, &exclusive_write_lock)) {}
     }
-    std::unique_lock<std::shared_mutex> exclusive_write_lock(read_set_mutex_);
+    auto exclusive_write_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+    AddTransactionToAddressSetWithoutLocking(address, read_sets_, transaction);
+}
+
+bool TransactionManager::TryLoad(void *address, Transaction *transaction) {
+    if (slots_ != nullptr || !use_pessimistic_conflict_detection_) {
+        Load(address, transaction);
+        return true;
+    }
+    bool suspended = false;
+    {
+        auto exclusive_write_lock = ProfiledUniqueLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+        while (!HandlePessimisticReadConflicts(address, transaction, &exclusive_write_lock, &suspended)) {}
+    }
+    if (suspended) {
+        return false;
+    }
+    auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
     AddTransactionToAddressSetWithoutLocking(address, read_sets_, transaction);
+    return true;
+}
+
+bool TransactionManager::IsStallOver(const Transaction *transaction) const {
+    return transaction->IsAborted() ||
+           stall_generations_[transaction->GetStallQueue() - stall_queues_.data()] != transaction->GetStallGeneration();
 }
 
 /* Greedy algorithm to avoid deadlocks on read stalls. T0 is transaction and T1 is
@@ -70,20 +353,42 @@ void TransactionManager::Load(void *address, Transaction *transaction) {
  * the first rule is applied).
  */
 bool TransactionManager::HandlePessimisticReadConflicts(void *address, Transaction *transaction,
-                                                        std::unique_lock<std::shared_mutex> *exclusive_write_lock) {
+                                                        std::unique_lock<std::shared_mutex> *exclusive_write_lock,
+                                                        bool *suspended) {
+    ProfileScope conflict_scope(ProfilePhase::CONFLICT_CHECK);
     if (write_sets_.count(address) > 0) {
         auto &transaction_set = write_sets_.at(address);
         for (auto *other_transaction : transaction_set.transaction_set_) {
             if (other_transaction != transaction) {
-                if (!other_transaction->MarkStalledTransactionAborted(exclusive_write_lock, &read_stall_cv_)) {
-                    if (!transaction->MarkStalled()) {
-                        std::unique_lock<std::shared_mutex> exclusive_read_lock(read_set_mutex_);
+                // other_transaction may be gone once we've waited on it
+                uint64_t other_transaction_id = other_transaction->GetTransactionId();
+                if (other_transaction->MarkStalledTransactionAborted(exclusive_write_lock)) {
+                    Tracer::Record(TraceEventType::KILL, transaction->GetTransactionId(), other_transaction_id);
+                } else {
+                    auto &stall_queue = StallQueueFor(address);
+                    if (!transaction->MarkStalled(&stall_queue, suspended != nullptr)) {
+                        auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
                         AbortWithoutLocks(transaction);
                     }
-                    read_stall_cv_.wait(*exclusive_write_lock,
-                                        [&] { return write_sets_.count(address) == 0 || transaction->IsAborted(); });
-                    if (transaction->IsAborted() || !transaction->MarkUnstalled()) {
-                        std::unique_lock<std::shared_mutex> exclusive_read_lock(read_set_mutex_);
+                    Tracer::Record(TraceEventType::STALL_BEGIN, transaction->GetTransactionId(), other_transaction_id);
+                    if (suspended != nullptr) {
+                        // Wakes bump the generation under the write set lock we hold, so none can be missed
+                        transaction->SetStallGeneration(stall_generations_[&stall_queue - stall_queues_.data()]);
+                        *suspended = true;
+                        return true;
+                    }
+                    {
+                        ProfileScope stall_scope(ProfilePhase::STALL_WAIT);
+                        VirtualTimeScheduler::Wait(stall_queue, *exclusive_write_lock,
+                                                   [&] {
+                                                       return write_sets_.count(address) == 0 ||
+                                                              transaction->IsAborted();
+                                                   });
+                    }
+                    Tracer::Record(TraceEventType::STALL_END, transaction->GetTransactionId(), other_transaction_id);
+                    // Fails if the transaction was aborted while stalled
+                    if (!transaction->MarkUnstalled()) {
+                        auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
                         AbortWithoutLocks(transaction);
                     }
                 }
@@ -95,18 +400,23 @@ bool TransactionManager::HandlePessimisticReadConflicts(void *address, Transacti
 }
 
 void TransactionManager::ResolveConflictsAtCommit(Transaction *transaction) {
-    if (!use_pessimistic_conflict_detection_) {
+    ProfileScope conflict_scope(ProfilePhase::CONFLICT_CHECK);
+    if (slots_ != nullptr) {
+        if (!slots_->MarkCommitting(transaction->GetSlot())) {
+            Abort(transaction);
+        }
+    } else if (!use_pessimistic_conflict_detection_) {
         {
-            std::shared_lock<std::shared_mutex> shared_write_lock(write_set_mutex_);
+            auto shared_write_lock = ProfiledSharedLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
 
-            if (!AbortTransactionsWithConflictsWithoutLocking(write_sets_, transaction)) {
+            if (!AbortTransactionsWithConflictsWithoutLocking(write_sets_, transaction, true)) {
                 shared_write_lock.unlock();
                 Abort(transaction);
                 return;
             }
         }
 
-        std::shared_lock<std::shared_mutex> shared_read_lock(read_set_mutex_);
+        auto shared_read_lock = ProfiledSharedLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
         if (!AbortTransactionsWithConflictsWithoutLocking(read_sets_, transaction)) {
             shared_read_lock.unlock();
             Abort(transaction);
@@ -116,36 +426,222 @@ void TransactionManager::ResolveConflictsAtCommit(Transaction *transaction) {
 }
 
 void TransactionManager::XEnd(Transaction *transaction) {
-    std::unique_lock<std::shared_mutex> exclusive_write_lock(write_set_mutex_);
-    std::unique_lock<std::shared_mutex> exclusive_read_lock(read_set_mutex_);
+    if (reader_bitmaps_ != nullptr) {
+        ReleaseReaderBitmaps(transaction->GetWriteSet(), transaction->GetReadSet(), transaction, false, true);
+        reader_bitmaps_->ReleaseSlot(transaction->GetSlot());
+    } else if (orecs_ != nullptr) {
+        ReleaseOrecs(transaction->GetWriteSet(), transaction->GetReadSet(), transaction, false);
+        orecs_->ReleaseSlot(transaction->GetSlot());
+    } else if (use_flat_combining_) {
+        RemoveTransactionCombined(transaction);
+    } else {
+        auto exclusive_write_lock = ProfiledUniqueLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+        auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
 
-    RemoveTransactionFromAddressSetWithoutLocking(transaction->GetWriteSet(), write_sets_, transaction);
-    RemoveTransactionFromAddressSetWithoutLocking(transaction->GetReadSet(), read_sets_, transaction);
+        RemoveTransactionFromAddressSetWithoutLocking(transaction->GetWriteSet(), write_sets_, transaction);
+        RemoveTransactionFromAddressSetWithoutLocking(transaction->GetReadSet(), read_sets_, transaction);
+        RemoveUpdateOpsWithoutLocking(transaction->GetWriteSet(), transaction);
 
-    read_stall_cv_.notify_all();
+        WakeStalledReadersWithoutLocking(transaction->GetWriteSet());
+    }
+
+    if (use_htm_emulation_) {
+        (transaction->IsHardware() ? htm_commits_ : software_commits_)++;
+    }
 }
 
 void TransactionManager::AbortWithoutLocks(Transaction *transaction) {
-    transaction->Abort();
-    RemoveTransactionFromAddressSetWithoutLocking(transaction->GetWriteSet(), write_sets_, transaction);
-    RemoveTransactionFromAddressSetWithoutLocking(transaction->GetReadSet(), read_sets_, transaction);
+    CleanUpAbortWithoutLocks(transaction);
+    ThrowConflictAbort(transaction);
+}
 
-    read_stall_cv_.notify_all();
+void TransactionManager::ThrowConflictAbort(Transaction *transaction) {
+    if (transaction->IsHardware()) {
+        htm_conflict_aborts_++;
+    }
     throw AbortException("Transaction aborted");
 }
 
 void TransactionManager::Abort(Transaction *transaction) {
-    std::unique_lock<std::shared_mutex> exclusive_write_lock(write_set_mutex_);
-    std::unique_lock<std::shared_mutex> exclusive_read_lock(read_set_mutex_);
+    if (slots_ != nullptr) {
+        AbortWithoutLocks(transaction);
+    }
+    if (use_flat_combining_) {
+        // Roll back while the write sets still keep other transactions away from our addresses
+        {
+            ProfileScope abort_scope(ProfilePhase::ABORT_CLEANUP);
+            transaction->Abort();
+            RemoveTransactionCombined(transaction);
+        }
+        ThrowConflictAbort(transaction);
+    }
+    auto exclusive_write_lock = ProfiledUniqueLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+    auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
     AbortWithoutLocks(transaction);
 }
 
+void TransactionManager::AbortNested(Transaction *transaction, const std::unordered_set<void *> &write_set,
+                                     const std::unordered_set<void *> &read_set) {
+    if (reader_bitmaps_ != nullptr) {
+        ReleaseReaderBitmaps(write_set, read_set, transaction, true, false);
+        return;
+    }
+    if (orecs_ != nullptr) {
+        ReleaseOrecs(write_set, read_set, transaction, true);
+        return;
+    }
+    auto exclusive_write_lock = ProfiledUniqueLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+    auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+    RemoveTransactionFromAddressSetWithoutLocking(write_set, write_sets_, transaction);
+    RemoveTransactionFromAddressSetWithoutLocking(read_set, read_sets_, transaction);
+    RemoveUpdateOpsWithoutLocking(write_set, transaction);
+
+    WakeStalledReadersWithoutLocking(write_set);
+}
+
+void TransactionManager::ReleaseRead(void *address, Transaction *transaction) {
+    if (reader_bitmaps_ != nullptr) {
+        // Addresses can share a stripe, keep it while another address the transaction still reads maps to it
+        auto &stripe = MetadataFor(address, transaction);
+        for (auto *other_address : transaction->GetReadSet()) {
+            if (&MetadataFor(other_address, transaction) == &stripe) {
+                return;
+            }
+        }
+        reader_bitmaps_->ReleaseRead(stripe, transaction->GetSlot());
+        return;
+    }
+    if (orecs_ != nullptr) {
+        auto &orec = orecs_->OrecFor(address);
+        if (transaction->RemoveOrecRead(&orec)) {
+            orecs_->ReleaseRead(orec);
+        }
+        return;
+    }
+    auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+    ProfileScope update_scope(ProfilePhase::SET_UPDATE);
+    RemoveTransactionFromAddressWithoutLocking(address, read_sets_, transaction);
+}
+
+size_t TransactionManager::GetMetadataBytes() {
+    if (reader_bitmaps_ != nullptr) {
+        return reader_bitmaps_->GetBytes();
+    }
+    if (orecs_ != nullptr) {
+        return orecs_->GetBytes();
+    }
+    auto shared_write_lock = ProfiledSharedLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+    auto shared_read_lock = ProfiledSharedLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+    return TransactionSetBytes(write_sets_) + TransactionSetBytes(read_sets_);
+}
+
+void TransactionManager::CapacityAbort(Transaction *transaction) {
+    std::unique_lock<std::shared_mutex> exclusive_write_lock(write_set_mutex_, std::defer_lock);
+    std::unique_lock<std::shared_mutex> exclusive_read_lock(read_set_mutex_, std::defer_lock);
+    if (slots_ == nullptr) {
+        ProfileScope lock_scope(ProfilePhase::GLOBAL_LOCK_WAIT);
+        exclusive_write_lock.lock();
+        exclusive_read_lock.lock();
+    }
+    CleanUpAbortWithoutLocks(transaction);
+    htm_capacity_aborts_++;
+    throw CapacityAbortException("Hardware transaction exceeded cache capacity");
+}
+
+void TransactionManager::CleanUpAbortWithoutLocks(Transaction *transaction) {
+    ProfileScope abort_scope(ProfilePhase::ABORT_CLEANUP);
+    transaction->Abort();
+    if (reader_bitmaps_ != nullptr) {
+        ReleaseReaderBitmaps(transaction->GetWriteSet(), transaction->GetReadSet(), transaction, false, false);
+        reader_bitmaps_->ReleaseSlot(transaction->GetSlot());
+        return;
+    }
+    if (orecs_ != nullptr) {
+        ReleaseOrecs(transaction->GetWriteSet(), transaction->GetReadSet(), transaction, false);
+        orecs_->ReleaseSlot(transaction->GetSlot());
+        return;
+    }
+    RemoveTransactionFromAddressSetWithoutLocking(transaction->GetWriteSet(), write_sets_, transaction);
+    RemoveTransactionFromAddressSetWithoutLocking(transaction->GetReadSet(), read_sets_, transaction);
+    RemoveUpdateOpsWithoutLocking(transaction->GetWriteSet(), transaction);
+
+    WakeStalledReadersWithoutLocking(transaction->GetWriteSet());
+}
+
+std::condition_variable_any &TransactionManager::StallQueueFor(const void *address) {
+    auto key = reinterpret_cast<uintptr_t>(address);
+    key ^= key >> 17;
+    key *= 0x9E3779B97F4A7C15ull;
+    return stall_queues_[(key >> 32) % STALL_QUEUES];
+}
+
+void TransactionManager::WakeStalledReadersWithoutLocking(const std::unordered_set<void *> &write_set) {
+    std::bitset<STALL_QUEUES> queues;
+    CollectStallQueues(write_set, &queues);
+    WakeStalledReadersWithoutLocking(queues);
+}
+
+void TransactionManager::WakeStalledReadersWithoutLocking(const std::bitset<STALL_QUEUES> &queues) {
+    for (size_t queue = 0; queue < STALL_QUEUES; queue++) {
+        if (queues.test(queue)) {
+            stall_generations_[queue]++;
+            stall_queues_[queue].notify_all();
+        }
+    }
+}
+
+void TransactionManager::CollectStallQueues(const std::unordered_set<void *> &write_set,
+                                            std::bitset<STALL_QUEUES> *queues) {
+    for (auto *address : write_set) {
+        queues->set(&StallQueueFor(address) - stall_queues_.data());
+    }
+}
+
+void TransactionManager::RemoveTransactionCombined(Transaction *transaction) {
+    CombiningRequest request{transaction, combining_requests_.load()};
+    while (!combining_requests_.compare_exchange_weak(request.next_, &request)) {}
+
+    while (!request.done_.load()) {
+        std::unique_lock<std::mutex> combiner_lock(combiner_mutex_, std::try_to_lock);
+        if (!combiner_lock.owns_lock()) {
+            ProfileScope lock_scope(ProfilePhase::GLOBAL_LOCK_WAIT);
+            VirtualTimeScheduler::Pause();
+            continue;
+        }
+        // Empty if the previous combiner already took our request
+        CombiningRequest *batch = combining_requests_.exchange(nullptr);
+        if (batch == nullptr) {
+            continue;
+        }
+
+        auto exclusive_write_lock = ProfiledUniqueLock(write_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+        auto exclusive_read_lock = ProfiledUniqueLock(read_set_mutex_, ProfilePhase::GLOBAL_LOCK_WAIT);
+        std::bitset<STALL_QUEUES> queues;
+        while (batch != nullptr) {
+            // The request is gone as soon as it's marked done
+            CombiningRequest *next = batch->next_;
+            auto *finished_transaction = batch->transaction_;
+            RemoveTransactionFromAddressSetWithoutLocking(finished_transaction->GetWriteSet(), write_sets_,
+                                                          finished_transaction);
+            RemoveTransactionFromAddressSetWithoutLocking(finished_transaction->GetReadSet(), read_sets_,
+                                                          finished_transaction);
+            RemoveUpdateOpsWithoutLocking(finished_transaction->GetWriteSet(), finished_transaction);
+            CollectStallQueues(finished_transaction->GetWriteSet(), &queues);
+            batch->done_.store(true);
+            batch = next;
+        }
+        WakeStalledReadersWithoutLocking(queues);
+    }
+}
+
 bool TransactionManager::CheckForConflictWithoutLocking(void *address,
                                                         std::unordered_map<void *, TransactionSet> &address_map,
                                                         Transaction *transaction) {
+    ProfileScope conflict_scope(ProfilePhase::CONFLICT_CHECK);
     if (address_map.count(address) > 0) {
         auto &transaction_set = address_map.at(address);
-        std::shared_lock<std::shared_mutex> transaction_set_lock(transaction_set.transaction_mutex_);
+        auto transaction_set_lock = ProfiledSharedLock(transaction_set.transaction_mutex_,
+                                                       ProfilePhase::SET_LOCK_WAIT);
         for (auto *other_transaction : transaction_set.transaction_set_) {
             if (other_transaction != transaction) {
                 return true;
@@ -155,16 +651,86 @@ bool TransactionManager::CheckForConflictWithoutLocking(void *address,
     return false;
 }
 
+bool TransactionManager::CheckForUpdateConflictWithoutLocking(void *address, Transaction *transaction,
+                                                              CommutativeOp op) {
+    ProfileScope conflict_scope(ProfilePhase::CONFLICT_CHECK);
+    if (write_sets_.count(address) > 0) {
+        auto &transaction_set = write_sets_.at(address);
+        auto transaction_set_lock = ProfiledSharedLock(transaction_set.transaction_mutex_,
+                                                       ProfilePhase::SET_LOCK_WAIT);
+        for (auto *other_transaction : transaction_set.transaction_set_) {
+            if (other_transaction != transaction && UpdateOpWithoutLocking(address, other_transaction) != op) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+CommutativeOp TransactionManager::UpdateOpWithoutLocking(void *address, Transaction *transaction) const {
+    auto ops = update_ops_.find(address);
+    if (ops == update_ops_.end()) {
+        return CommutativeOp::NONE;
+    }
+    auto op = ops->second.find(transaction);
+    return op != ops->second.end() ? op->second : CommutativeOp::NONE;
+}
+
+void TransactionManager::RecordUpdateOpWithoutLocking(void *address, Transaction *transaction, CommutativeOp op) {
+    if (op == CommutativeOp::NONE) {
+        // A store only has to demote an update that's already pending
+        if (update_ops_.empty() || update_ops_.count(address) == 0) {
+            return;
+        }
+        auto &ops = update_ops_.at(address);
+        if (ops.count(transaction) > 0) {
+            ops.at(transaction) = CommutativeOp::NONE;
+        }
+        return;
+    }
+    auto &ops = update_ops_[address];
+    auto pending = ops.find(transaction);
+    if (pending != ops.end()) {
+        if (pending->second != op) {
+            pending->second = CommutativeOp::NONE;
+        }
+        return;
+    }
+    bool stored = write_sets_.count(address) > 0 && write_sets_.at(address).transaction_set_.count(transaction) > 0;
+    ops.emplace(transaction, stored ? CommutativeOp::NONE : op);
+}
+
+void TransactionManager::RemoveUpdateOpsWithoutLocking(const std::unordered_set<void *> &write_set,
+                                                       Transaction *transaction) {
+    if (update_ops_.empty()) {
+        return;
+    }
+    for (auto *address : write_set) {
+        auto ops = update_ops_.find(address);
+        if (ops != update_ops_.end() && ops->second.erase(transaction) > 0 && ops->second.empty()) {
+            update_ops_.erase(ops);
+        }
+    }
+}
+
 bool TransactionManager::AbortTransactionsWithConflictsWithoutLocking(
         std::unordered_map<void *, TransactionSet> &address_map,
-        Transaction *transaction) {
+        Transaction *transaction, bool skip_compatible_updates) {
+    ProfileScope conflict_scope(ProfilePhase::CONFLICT_CHECK);
     for (const auto &address : transaction->GetWriteSet()) {
         if (address_map.count(address) > 0) {
             auto &transaction_set = address_map.at(address);
-            std::shared_lock<std::shared_mutex> transaction_set_lock(transaction_set.transaction_mutex_);
+            auto transaction_set_lock = ProfiledSharedLock(transaction_set.transaction_mutex_,
+                                                           ProfilePhase::SET_LOCK_WAIT);
+            auto op = skip_compatible_updates ? UpdateOpWithoutLocking(address, transaction) : CommutativeOp::NONE;
             for (auto *other_transaction : transaction_set.transaction_set_) {
-                if (other_transaction != transaction && !other_transaction->MarkAborted()) {
-                    return false;
+                if (other_transaction != transaction &&
+                    (op == CommutativeOp::NONE || UpdateOpWithoutLocking(address, other_transaction) != op)) {
+                    if (!other_transaction->MarkAborted()) {
+                        return false;
+                    }
+                    Tracer::Record(TraceEventType::KILL, transaction->GetTransactionId(),
+                                   other_transaction->GetTransactionId());
                 }
             }
         }
@@ -173,9 +739,79 @@ bool TransactionManager::AbortTransactionsWithConflictsWithoutLocking(
     return true;
 }
 
+void TransactionManager::ReleaseReaderBitmaps(const std::unordered_set<void *> &write_set,
+                                              const std::unordered_set<void *> &read_set,
+                                              Transaction *transaction,
+                                              bool keep_remaining,
+                                              bool committed) {
+    // Addresses can share a stripe, keep the stripes of everything the transaction still accesses
+    std::unordered_set<ReaderBitmap *> kept_writes;
+    std::unordered_set<ReaderBitmap *> kept_reads;
+    if (keep_remaining) {
+        for (auto *address : transaction->GetWriteSet()) {
+            kept_writes.emplace(&MetadataFor(address, transaction));
+        }
+        for (auto *address : transaction->GetReadSet()) {
+            kept_reads.emplace(&MetadataFor(address, transaction));
+        }
+    }
+
+    for (auto *address : write_set) {
+        auto &stripe = MetadataFor(address, transaction);
+        if (kept_writes.count(&stripe) == 0) {
+            reader_bitmaps_->ReleaseWrite(stripe, transaction->GetSlot(), committed);
+        }
+    }
+    for (auto *address : read_set) {
+        auto &stripe = MetadataFor(address, transaction);
+        if (kept_reads.count(&stripe) == 0) {
+            reader_bitmaps_->ReleaseRead(stripe, transaction->GetSlot());
+        }
+    }
+}
+
+void TransactionManager::ReleaseOrecs(const std::unordered_set<void *> &write_set,
+                                      const std::unordered_set<void *> &read_set,
+                                      Transaction *transaction,
+                                      bool keep_remaining) {
+    // Addresses can share an orec, keep the orecs of everything the transaction still writes
+    std::unordered_set<Orec *> kept_writes;
+    if (keep_remaining) {
+        for (auto *address : transaction->GetWriteSet()) {
+            kept_writes.emplace(&orecs_->OrecFor(address));
+        }
+    }
+    for (auto *address : write_set) {
+        auto &orec = orecs_->OrecFor(address);
+        if (kept_writes.count(&orec) == 0) {
+            orecs_->ReleaseWrite(orec, transaction->GetSlot());
+        }
+    }
+
+    if (!keep_remaining) {
+        for (const auto &[orec, addresses] : transaction->GetOrecReads()) {
+            orecs_->ReleaseRead(*orec);
+        }
+        transaction->GetOrecReads().clear();
+        return;
+    }
+    for (auto *address : read_set) {
+        auto &orec = orecs_->OrecFor(address);
+        if (transaction->RemoveOrecRead(&orec)) {
+            orecs_->ReleaseRead(orec);
+        }
+    }
+}
+
+ReaderBitmap &TransactionManager::MetadataFor(void *address, const Transaction *transaction) {
+    auto *metadata = transaction->GetEmbeddedMetadata(address);
+    return metadata != nullptr ? *metadata : reader_bitmaps_->StripeFor(address);
+}
+
 void TransactionManager::AddTransactionToAddressSetWithoutLocking(void *address,
                                                                   std::unordered_map<void *, TransactionSet> &address_map,
                                                                   Transaction *transaction) {
+    ProfileScope update_scope(ProfilePhase::SET_UPDATE);
     if (address_map.count(address) == 0) {
         address_map.emplace(
                 std::piecewise_construct,
@@ -189,16 +825,24 @@ void TransactionManager::AddTransactionToAddressSetWithoutLocking(void *address,
 void TransactionManager::RemoveTransactionFromAddressSetWithoutLocking(const std::unordered_set<void *> &address_set,
                                                                        std::unordered_map<void *, TransactionSet> &address_map,
                                                                        Transaction *transaction) {
+    ProfileScope update_scope(ProfilePhase::SET_UPDATE);
     for (const auto &address : address_set) {
-        auto &transaction_set = address_map.at(address);
-        bool clean_up = false;
-        {
-            std::unique_lock<std::shared_mutex> transaction_set_lock(transaction_set.transaction_mutex_);
-            transaction_set.transaction_set_.erase(transaction);
-            clean_up = transaction_set.transaction_set_.empty();
-        }
-        if (clean_up) {
-            address_map.erase(address);
-        }
+        RemoveTransactionFromAddressWithoutLocking(address, address_map, transaction);
     }
-}
\ No newline at end of file
+}
+
+void TransactionManager::RemoveTransactionFromAddressWithoutLocking(void *address,
+                                                                    std::unordered_map<void *, TransactionSet> &address_map,
+                                                                    Transaction *transaction) {
+    auto &transaction_set = address_map.at(address);
+    bool clean_up = false;
+    {
+        auto transaction_set_lock = ProfiledUniqueLock(transaction_set.transaction_mutex_,
+                                                       ProfilePhase::SET_LOCK_WAIT);
+        transaction_set.transaction_set_.erase(transaction);
+        clean_up = transaction_set.transaction_set_.empty();
+    }
+    if (clean_up) {
+        address_map.erase(address);
+    }
+}
@@ -1,11 +1,29 @@
 //TODO don't copy all from simulator main
 
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "include/transaction.h"
 #include "include/transaction_manager.h"
 #include "include/abort_exception.h"
+#include "include/atomically.h"
+#include "include/conflict_aware_scheduler.h"
+#include "include/coroutine_scheduler.h"
+#include "include/invalid_state_exception.h"
+#include "include/persistent_region.h"
+#include "include/profiler.h"
+#include "include/scalability_sweep.h"
+#include "include/shared_memory_region.h"
 #include "include/simulator_main.h"
+#include "include/tmap.h"
+#include "include/tqueue.h"
+#include "include/transactional_allocator.h"
+#include "include/tvector.h"
 
 void assert_double_equals(double a, double b, bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
     if (std::abs(a - b) > 0.01) {
@@ -277,6 +295,980 @@ void ReadWriteConflictingTest(TransactionManager *transaction_manager, bool use_
     assert_double_equals(map["Popo"], 500.68 + 3 * 5.42, use_lazy_versioning, use_pessimistic_conflict_detection);
 }
 
+void VirtualTimeDeterminismTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+    std::vector<TransactionRunDetails> runs;
+    for (int run = 0; run < 2; run++) {
+        TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+        VirtualTimeScheduler scheduler(4, 42);
+        auto map = GetTestMap();
+        auto deposit = [&](Transaction *transaction) {
+            for (const auto &name : {"Joe", "Mike", "Sam", "Aparna", "Nana", "Popo"}) {
+                auto balance = transaction->Load(&map.find(name)->second);
+                transaction->Store(&map.find(name)->second, balance + 1);
+            }
+        };
+
+        runs.push_back(RunSimulatedTransactions(&transaction_manager, &scheduler,
+                                                {deposit, deposit, deposit, deposit, deposit, deposit}, 5));
+
+        assert_double_equals(map["Joe"], 666.42 + 30, use_lazy_versioning, use_pessimistic_conflict_detection);
+        assert_double_equals(map["Popo"], 500.68 + 30, use_lazy_versioning, use_pessimistic_conflict_detection);
+    }
+
+    if (runs[0].aborts_ != runs[1].aborts_ || runs[0].time_taken_ != runs[1].time_taken_) {
+        std::cerr << "Use Lazy Versioning: " << (use_lazy_versioning ? "TRUE" : "FALSE") << std::endl;
+        std::cerr << "Use Pessimistic Conflict Detection: " << (use_pessimistic_conflict_detection ? "TRUE" : "FALSE")
+                  << std::endl;
+        std::cerr << "Simulated runs with the same seed diverged: " << runs[0].aborts_ << " aborts in "
+                  << runs[0].time_taken_ << " cycles vs " << runs[1].aborts_ << " aborts in " << runs[1].time_taken_
+                  << " cycles" << std::endl;
+    }
+}
+
+void HtmCapacityFallbackTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+    TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+    HtmConfig config;
+    config.sets_ = 1;
+    config.ways_ = 2;
+    transaction_manager.EnableHtmEmulation(config);
+
+    auto map = GetTestMap();
+    auto small = [&](Transaction *transaction) {
+        auto joe_balance = transaction->Load(&map.find("Joe")->second);
+        transaction->Store(&map.find("Joe")->second, joe_balance + 1);
+    };
+    auto large = [&](Transaction *transaction) {
+        for (const auto &name : {"Mike", "Sam", "Aparna", "Nana", "Popo"}) {
+            auto balance = transaction->Load(&map.find(name)->second);
+            transaction->Store(&map.find(name)->second, balance + 1);
+        }
+    };
+
+    RunAsyncTransactions(&transaction_manager, {small, large});
+
+    assert_double_equals(map["Joe"], 666.42 + 1, use_lazy_versioning, use_pessimistic_conflict_detection);
+    assert_double_equals(map["Mike"], 33.21 + 1, use_lazy_versioning, use_pessimistic_conflict_detection);
+    assert_double_equals(map["Popo"], 500.68 + 1, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    auto stats = transaction_manager.GetHtmStats();
+    if (stats.hardware_commits_ != 1 || stats.software_commits_ != 1 || stats.capacity_aborts_ != 1) {
+        std::cerr << "Use Lazy Versioning: " << (use_lazy_versioning ? "TRUE" : "FALSE") << std::endl;
+        std::cerr << "Use Pessimistic Conflict Detection: " << (use_pessimistic_conflict_detection ? "TRUE" : "FALSE")
+                  << std::endl;
+        std::cerr << "Expected one hardware commit, one capacity abort and one software commit, got "
+                  << stats.hardware_commits_ << ", " << stats.capacity_aborts_ << " and " << stats.software_commits_
+                  << std::endl;
+    }
+}
+
+void FlatCombiningTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+    TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+    transaction_manager.EnableFlatCombining();
+
+    ReadOnlyConflictingTest(&transaction_manager, use_lazy_versioning, use_pessimistic_conflict_detection);
+    WriteOnlyNonConflictingTest(&transaction_manager, use_lazy_versioning, use_pessimistic_conflict_detection);
+    WriteOnlyConflictingTest(&transaction_manager, use_lazy_versioning, use_pessimistic_conflict_detection);
+    ReadWriteConflictingTest(&transaction_manager, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    // Combined aborts must leave nothing behind in the sets
+    auto map = GetTestMap();
+    auto deposit = [&](Transaction *transaction) {
+        auto balance = transaction->Load(&map.find("Joe")->second);
+        transaction->Store(&map.find("Joe")->second, balance + 1);
+    };
+    RunAsyncTransactions(&transaction_manager, std::vector<std::function<void(Transaction *)>>(8, deposit), 25);
+    assert_double_equals(map["Joe"], 666.42 + 200, use_lazy_versioning, use_pessimistic_conflict_detection);
+}
+
+void NestedTransactionTest(TransactionManager *transaction_manager, bool use_lazy_versioning,
+                           bool use_pessimistic_conflict_detection) {
+    auto map = GetTestMap();
+    auto func = [&](Transaction *transaction) {
+        transaction->Store(&map.find("Joe")->second, 1.0);
+
+        transaction->XBegin();
+        transaction->Store(&map.find("Mike")->second, 2.0);
+        transaction->Store(&map.find("Joe")->second, 2.0);
+        transaction->AbortNested();
+
+        transaction->RunNested([&](Transaction *nested) {
+            auto joe_balance = nested->Load(&map.find("Joe")->second);
+            nested->Store(&map.find("Joe")->second, joe_balance + 3.0);
+            nested->RunNested([&](Transaction *inner) {
+                inner->Store(&map.find("Sam")->second, 5.0);
+            });
+        });
+    };
+
+    RunTransaction(transaction_manager, func);
+
+    assert_double_equals(map["Joe"], 4.0, use_lazy_versioning, use_pessimistic_conflict_detection);
+    assert_double_equals(map["Mike"], 33.21, use_lazy_versioning, use_pessimistic_conflict_detection);
+    assert_double_equals(map["Sam"], 5.0, use_lazy_versioning, use_pessimistic_conflict_detection);
+}
+
+void AllocatorTest(TransactionManager *transaction_manager, bool use_lazy_versioning,
+                   bool use_pessimistic_conflict_detection) {
+    auto report = [&](const char *msg) {
+        std::cerr << "Use Lazy Versioning: " << (use_lazy_versioning ? "TRUE" : "FALSE") << std::endl;
+        std::cerr << "Use Pessimistic Conflict Detection: " << (use_pessimistic_conflict_detection ? "TRUE" : "FALSE")
+                  << std::endl;
+        std::cerr << msg << std::endl;
+    };
+
+    // Allocations of aborted transactions go straight back to the pool
+    void *aborted_block;
+    {
+        Transaction transaction = transaction_manager->XBegin();
+        aborted_block = transaction.Alloc(sizeof(double));
+        transaction.Store(static_cast<double *>(aborted_block), 1.0);
+        try {
+            transaction_manager->Abort(&transaction);
+        } catch (const AbortException &e) {}
+    }
+
+    double *block = nullptr;
+    RunTransaction(transaction_manager, [&](Transaction *transaction) {
+        block = static_cast<double *>(transaction->Alloc(sizeof(double)));
+        transaction->Store(block, 42.0);
+    });
+    if (block != aborted_block) {
+        report("Block allocated by aborted transaction wasn't reused");
+    }
+    assert_double_equals(*block, 42.0, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    // Frees are deferred until no running transaction can reference the block
+    {
+        Transaction reader = transaction_manager->XBegin();
+        assert_double_equals(reader.Load(block), 42.0, use_lazy_versioning, use_pessimistic_conflict_detection);
+        reader.XEnd();
+
+        RunTransaction(transaction_manager, [&](Transaction *transaction) { transaction->Free(block); });
+        TransactionalAllocator::Reclaim();
+        TransactionalAllocator::Reclaim();
+
+        void *reused = nullptr;
+        RunTransaction(transaction_manager, [&](Transaction *transaction) {
+            reused = transaction->Alloc(sizeof(double));
+        });
+        if (reused == block) {
+            report("Block freed while a transaction that could reference it was running");
+        }
+    }
+
+    TransactionalAllocator::Reclaim();
+    TransactionalAllocator::Reclaim();
+    void *reused = nullptr;
+    RunTransaction(transaction_manager, [&](Transaction *transaction) {
+        reused = transaction->Alloc(sizeof(double));
+    });
+    if (reused != block) {
+        report("Freed block wasn't reclaimed once no transaction could reference it");
+    }
+}
+
+void ContainerTest(TransactionManager *transaction_manager, bool use_lazy_versioning,
+                   bool use_pessimistic_conflict_detection) {
+    auto report = [&](const char *msg) {
+        std::cerr << "Use Lazy Versioning: " << (use_lazy_versioning ? "TRUE" : "FALSE") << std::endl;
+        std::cerr << "Use Pessimistic Conflict Detection: " << (use_pessimistic_conflict_detection ? "TRUE" : "FALSE")
+                  << std::endl;
+        std::cerr << msg << std::endl;
+    };
+
+    // Few buckets so threads share them
+    TMap<int, double> map(4);
+    TVector<int> vector;
+    std::vector<std::function<void(Transaction *)>> funcs;
+    for (int thread = 0; thread < 4; thread++) {
+        funcs.emplace_back([&, thread](Transaction *transaction) {
+            for (int key = thread; key < 64; key += 4) {
+                double balance = 0;
+                map.Get(transaction, key, &balance);
+                map.Put(transaction, key, balance + 1);
+            }
+            map.Erase(transaction, 100 + thread);
+            vector.PushBack(transaction, thread);
+        });
+    }
+    RunTransaction(transaction_manager, [&](Transaction *transaction) {
+        for (int thread = 0; thread < 4; thread++) {
+            map.Put(transaction, 100 + thread, 1.0);
+        }
+    });
+    RunAsyncTransactions(transaction_manager, funcs, 10);
+
+    // Writes of an aborted transaction must not be visible
+    {
+        Transaction transaction = transaction_manager->XBegin();
+        map.Put(&transaction, 0, -1.0);
+        map.Put(&transaction, 200, -1.0);
+        vector.PushBack(&transaction, -1);
+        try {
+            transaction_manager->Abort(&transaction);
+        } catch (const AbortException &e) {}
+    }
+
+    RunTransaction(transaction_manager, [&](Transaction *transaction) {
+        for (int key = 0; key < 64; key++) {
+            double balance = 0;
+            if (!map.Get(transaction, key, &balance)) {
+                report("TMap lost a key");
+            }
+            assert_double_equals(balance, 10, use_lazy_versioning, use_pessimistic_conflict_detection);
+        }
+        if (map.Contains(transaction, 101) || map.Contains(transaction, 200)) {
+            report("TMap kept an erased key or a key of an aborted transaction");
+        }
+
+        int sum = 0;
+        for (size_t i = 0; i < vector.Size(transaction); i++) {
+            sum += vector.Get(transaction, i);
+        }
+        if (vector.Size(transaction) != 40 || sum != 60) {
+            report("TVector lost or duplicated appends");
+        }
+    });
+
+    TQueue<int> queue(2);
+    RunTransaction(transaction_manager, [&](Transaction *transaction) {
+        int value = 0;
+        if (!queue.Enqueue(transaction, 1) || !queue.Enqueue(transaction, 2) || queue.Enqueue(transaction, 3)) {
+            report("TQueue didn't respect its capacity");
+        }
+        if (!queue.Dequeue(transaction, &value) || value != 1 || !queue.Enqueue(transaction, 3)) {
+            report("TQueue isn't FIFO");
+        }
+    });
+    RunTransaction(transaction_manager, [&](Transaction *transaction) {
+        int first = 0;
+        int second = 0;
+        if (!queue.Dequeue(transaction, &first) || !queue.Dequeue(transaction, &second) || first != 2 ||
+            second != 3 || queue.Dequeue(transaction, &first)) {
+            report("TQueue lost elements across transactions");
+        }
+    });
+}
+
+void TVarTest(TransactionManager *transaction_manager, bool use_lazy_versioning,
+              bool use_pessimistic_conflict_detection) {
+    TVar<int64_t> counter(0);
+    TVar<double> balance(100);
+    std::vector<std::function<void(Transaction *)>> funcs;
+    for (int thread = 0; thread < 8; thread++) {
+        funcs.emplace_back([&](Transaction *transaction) {
+            transaction->Store(&counter, transaction->Load(&counter) + 1);
+            transaction->RunNested([&](Transaction *nested) {
+                nested->Store(&balance, nested->Load(&balance) + 0.5);
+            });
+        });
+    }
+    RunAsyncTransactions(transaction_manager, funcs, 25);
+
+    // Aborted writes are neither visible nor counted as versions
+    {
+        Transaction transaction = transaction_manager->XBegin();
+        transaction.Store(&counter, int64_t{-1});
+        try {
+            transaction_manager->Abort(&transaction);
+        } catch (const AbortException &e) {}
+    }
+
+    assert_double_equals(counter.UnsafeGet(), 200, use_lazy_versioning, use_pessimistic_conflict_detection);
+    assert_double_equals(balance.UnsafeGet(), 200, use_lazy_versioning, use_pessimistic_conflict_detection);
+    if (transaction_manager->UsesReaderBitmaps()) {
+        assert_double_equals(counter.GetVersion(), 200, use_lazy_versioning, use_pessimistic_conflict_detection);
+    }
+}
+
+void ByteRangeTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+    TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+    transaction_manager.EnableByteRanges();
+
+    struct Pair {
+        double first_;
+        double second_;
+    };
+    Pair pair{1, 2};
+
+    // Reads see the overlapping bytes of earlier writes
+    {
+        Transaction transaction = transaction_manager.XBegin();
+        transaction.Store(&pair, Pair{3, 4});
+        assert_double_equals(transaction.Load(&pair.second_), 4, use_lazy_versioning,
+                             use_pessimistic_conflict_detection);
+        transaction.Store(&pair.first_, 5.0);
+        auto read = transaction.Load(&pair);
+        assert_double_equals(read.first_, 5, use_lazy_versioning, use_pessimistic_conflict_detection);
+        assert_double_equals(read.second_, 4, use_lazy_versioning, use_pessimistic_conflict_detection);
+        transaction.XEnd();
+    }
+    assert_double_equals(pair.first_, 5, use_lazy_versioning, use_pessimistic_conflict_detection);
+    assert_double_equals(pair.second_, 4, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    // Overlapping writes roll back to the value before the first of them
+    {
+        Transaction transaction = transaction_manager.XBegin();
+        transaction.Store(&pair.second_, 7.0);
+        transaction.Store(&pair, Pair{8, 9});
+        try {
+            transaction_manager.Abort(&transaction);
+        } catch (const AbortException &e) {}
+    }
+    assert_double_equals(pair.first_, 5, use_lazy_versioning, use_pessimistic_conflict_detection);
+    assert_double_equals(pair.second_, 4, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    // A write of the whole struct conflicts with a read of its second field
+    bool conflicted = false;
+    {
+        Transaction reader = transaction_manager.XBegin();
+        reader.Load(&pair.second_);
+        try {
+            Transaction writer = transaction_manager.XBegin();
+            writer.Store(&pair, Pair{10, 11});
+            writer.XEnd();
+        } catch (const AbortException &e) {
+            conflicted = true;
+        }
+        try {
+            reader.XEnd();
+        } catch (const AbortException &e) {
+            conflicted = true;
+        }
+    }
+    if (!conflicted) {
+        std::cerr << "Use Lazy Versioning: " << (use_lazy_versioning ? "TRUE" : "FALSE") << std::endl;
+        std::cerr << "Use Pessimistic Conflict Detection: " << (use_pessimistic_conflict_detection ? "TRUE" : "FALSE")
+                  << std::endl;
+        std::cerr << "Overlapping byte ranges did not conflict" << std::endl;
+    }
+
+    // Whole struct updates must not lose concurrent updates of a single field
+    pair = {0, 0};
+    auto whole = [&](Transaction *transaction) {
+        auto read = transaction->Load(&pair);
+        transaction->Store(&pair, Pair{read.first_ + 1, read.second_});
+    };
+    auto field = [&](Transaction *transaction) {
+        transaction->Store(&pair.second_, transaction->Load(&pair.second_) + 1);
+    };
+    RunAsyncTransactions(&transaction_manager, {whole, field, whole, field, whole, field, whole, field}, 25);
+    assert_double_equals(pair.first_, 100, use_lazy_versioning, use_pessimistic_conflict_detection);
+    assert_double_equals(pair.second_, 100, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    WriteOnlyConflictingTest(&transaction_manager, use_lazy_versioning, use_pessimistic_conflict_detection);
+    ReadWriteConflictingTest(&transaction_manager, use_lazy_versioning, use_pessimistic_conflict_detection);
+    NestedTransactionTest(&transaction_manager, use_lazy_versioning, use_pessimistic_conflict_detection);
+}
+
+void PersistenceTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+    std::string path = "/tmp/transaction_memory_persistence_test_" + std::to_string(getpid());
+    std::remove(path.c_str());
+    std::remove((path + ".log").c_str());
+    auto report = [&](const std::string &message) {
+        std::cerr << "Use Lazy Versioning: " << (use_lazy_versioning ? "TRUE" : "FALSE") << std::endl;
+        std::cerr << "Use Pessimistic Conflict Detection: " << (use_pessimistic_conflict_detection ? "TRUE" : "FALSE")
+                  << std::endl;
+        std::cerr << message << std::endl;
+    };
+
+    // Concurrent commits survive a clean shutdown
+    {
+        PersistentRegion region(path, 4096);
+        TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+        transaction_manager.EnablePersistence(&region);
+        auto *accounts = static_cast<double *>(region.GetBase());
+        std::vector<std::function<void(Transaction *)>> funcs;
+        for (int i = 0; i < 8; i++) {
+            funcs.emplace_back([=](Transaction *transaction) {
+                transaction->Store(&accounts[i], transaction->Load(&accounts[i]) + 1);
+            });
+        }
+        RunAsyncTransactions(&transaction_manager, funcs, 25);
+        auto stats = region.GetPersistenceStats();
+        if (stats.commits_ != 200 || stats.syncs_ > stats.commits_) {
+            report("Expected 200 commits and at most as many syncs, got " + std::to_string(stats.commits_) + " and " +
+                   std::to_string(stats.syncs_));
+        }
+    }
+    {
+        PersistentRegion region(path, 4096);
+        auto *accounts = static_cast<double *>(region.GetBase());
+        for (int i = 0; i < 8; i++) {
+            assert_double_equals(accounts[i], 25, use_lazy_versioning, use_pessimistic_conflict_detection);
+        }
+    }
+
+    // Crash with a committed transaction whose writes never reached the file and a running one whose did
+    pid_t child = fork();
+    if (child == 0) {
+        try {
+            auto *region = new PersistentRegion(path, 4096);
+            TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+            transaction_manager.EnablePersistence(region);
+            auto *accounts = static_cast<double *>(region->GetBase());
+            Transaction committed = transaction_manager.XBegin();
+            committed.Store(&accounts[0], 1000.0);
+            committed.XEnd();
+            Transaction running = transaction_manager.XBegin();
+            running.Store(&accounts[1], -1.0);
+            running.Store(&accounts[2], -1.0);
+            msync(region->GetBase(), region->GetSize(), MS_SYNC);
+            std::ofstream(path + ".log", std::ios::app) << "torn";
+        } catch (...) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        report("Crashing child process failed");
+    }
+    {
+        PersistentRegion region(path, 4096);
+        auto *accounts = static_cast<double *>(region.GetBase());
+        assert_double_equals(accounts[0], 1000, use_lazy_versioning, use_pessimistic_conflict_detection);
+        assert_double_equals(accounts[1], 25, use_lazy_versioning, use_pessimistic_conflict_detection);
+        assert_double_equals(accounts[2], 25, use_lazy_versioning, use_pessimistic_conflict_detection);
+        const auto &recovery = region.GetRecoveryStats();
+        if (recovery.committed_ != 1 || recovery.rolled_back_ != (use_lazy_versioning ? 0 : 1) ||
+            recovery.torn_bytes_ == 0) {
+            report("Unexpected recovery: " + std::to_string(recovery.committed_) + " committed, " +
+                   std::to_string(recovery.rolled_back_) + " rolled back, " + std::to_string(recovery.torn_bytes_) +
+                   " torn bytes");
+        }
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".log").c_str());
+}
+
+void CoroutineTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+    TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+    CoroutineScheduler scheduler(&transaction_manager, 2);
+    std::vector<double> accounts(4, 0);
+    std::vector<CoroutineScheduler::Body> bodies;
+    for (int i = 0; i < 64; i++) {
+        bodies.emplace_back([&accounts, i](Transaction *transaction) -> TransactionTask {
+            double *from = &accounts[i % 4];
+            double *to = &accounts[(i + 1) % 4];
+            double balance = co_await transaction->AsyncLoad(from);
+            transaction->Store(from, balance - 1);
+            balance = co_await transaction->AsyncLoad(to);
+            transaction->Store(to, balance + 2);
+        });
+    }
+    scheduler.Run(bodies);
+    scheduler.Run(bodies);
+    for (double balance : accounts) {
+        assert_double_equals(balance, 32, use_lazy_versioning, use_pessimistic_conflict_detection);
+    }
+}
+
+void ConflictAwareSchedulerTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+    TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+    auto report = [&](const std::string &message) {
+        std::cerr << "Use Lazy Versioning: " << (use_lazy_versioning ? "TRUE" : "FALSE") << std::endl;
+        std::cerr << "Use Pessimistic Conflict Detection: " << (use_pessimistic_conflict_detection ? "TRUE" : "FALSE")
+                  << std::endl;
+        std::cerr << message << std::endl;
+    };
+
+    // Sites that aborted on the same address share a worker, the others spread
+    std::vector<double> accounts(4, 0);
+    {
+        ConflictAwareScheduler scheduler(2);
+        scheduler.Assign(4);
+        for (size_t site : {0, 2}) {
+            Transaction transaction = transaction_manager.XBegin();
+            transaction.Store(&accounts[0], 1.0);
+            scheduler.RecordAbort(site, transaction);
+            try {
+                transaction_manager.Abort(&transaction);
+            } catch (const AbortException &e) {}
+        }
+        auto queues = scheduler.Assign(4);
+        bool together = false;
+        for (const auto &queue : queues) {
+            together |= std::count(queue.begin(), queue.end(), 0) + std::count(queue.begin(), queue.end(), 2) == 2;
+            if (queue.size() != 2) {
+                report("Expected 2 sites per worker, got " + std::to_string(queue.size()));
+            }
+        }
+        if (!together || scheduler.GetSerializedSites() != 1) {
+            report("Sites predicted to conflict were not queued on the same worker");
+        }
+    }
+
+    // Conflicting transfers still all commit
+    {
+        ConflictAwareScheduler scheduler(4);
+        std::vector<std::function<void(Transaction *)>> funcs;
+        for (int i = 0; i < 16; i++) {
+            funcs.emplace_back([&accounts, i](Transaction *transaction) {
+                transaction->Store(&accounts[i % 4], transaction->Load(&accounts[i % 4]) + 1);
+            });
+        }
+        RunScheduledTransactions(&transaction_manager, &scheduler, funcs, 10);
+        for (double balance : accounts) {
+            assert_double_equals(balance, 40, use_lazy_versioning, use_pessimistic_conflict_detection);
+        }
+    }
+}
+
+void AdaptiveModeTest() {
+    TransactionManager transaction_manager(true, false);
+    AdaptiveConfig config;
+    config.window_transactions_ = 32;
+    config.hysteresis_windows_ = 2;
+    transaction_manager.EnableAdaptiveMode(config);
+    auto report = [&](const std::string &message) {
+        std::cerr << "Adaptive mode: " << message << std::endl;
+    };
+
+    // Write heavy, every transaction conflicts
+    int64_t counter = 0;
+    std::vector<std::function<void(Transaction *)>> funcs;
+    for (int i = 0; i < 8; i++) {
+        funcs.emplace_back([&counter](Transaction *transaction) {
+            transaction->Store(&counter, transaction->Load(&counter) + 1);
+        });
+    }
+    VirtualTimeScheduler scheduler(4, 1);
+    RunSimulatedTransactions(&transaction_manager, &scheduler, funcs, 50);
+    if (counter != 400) {
+        report("Expected counter to be 400, got " + std::to_string(counter));
+    }
+    if (transaction_manager.GetMode() == TransactionMode::LAZY_OPTIMISTIC) {
+        report("Still optimistic after a write heavy phase");
+    }
+
+    // Read mostly, nothing conflicts
+    size_t switches = transaction_manager.GetModeSwitches();
+    std::vector<int64_t> values(8, 1);
+    funcs.clear();
+    for (int i = 0; i < 8; i++) {
+        funcs.emplace_back([&values, i](Transaction *transaction) {
+            transaction->Load(&values[i]);
+        });
+    }
+    RunSimulatedTransactions(&transaction_manager, &scheduler, funcs, 50);
+    if (transaction_manager.GetMode() != TransactionMode::LAZY_OPTIMISTIC ||
+        transaction_manager.GetModeSwitches() == switches) {
+        report(std::string("Expected lazy optimistic after a read mostly phase, got ") +
+               TransactionModeName(transaction_manager.GetMode()));
+    }
+}
+
+void ProfilerTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+    if (!Profiler::ENABLED) {
+        return;
+    }
+    TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+    std::vector<double> accounts(4, 0);
+    Profiler::Reset();
+    for (int i = 0; i < 10; i++) {
+        auto transaction = transaction_manager.XBegin();
+        for (auto &account : accounts) {
+            transaction.Store(&account, transaction.Load(&account) + 1);
+        }
+        transaction.XEnd();
+    }
+    auto totals = Profiler::Collect();
+    Profiler::Reset();
+
+    auto report = [&](const std::string &message) {
+        std::cerr << "Profiler test failed: " << message << ", lazy versioning: " << use_lazy_versioning
+                  << ", pessimistic conflict detection: " << use_pessimistic_conflict_detection << std::endl;
+    };
+    if (totals.calls_[static_cast<size_t>(ProfileOperation::LOAD)] != 40 ||
+        totals.calls_[static_cast<size_t>(ProfileOperation::STORE)] != 40 ||
+        totals.calls_[static_cast<size_t>(ProfileOperation::COMMIT)] != 10) {
+        report("wrong number of operations");
+    }
+    auto &store_ticks = totals.ticks_[static_cast<size_t>(ProfileOperation::STORE)];
+    if (store_ticks[static_cast<size_t>(ProfilePhase::GLOBAL_LOCK_WAIT)] == 0 ||
+        store_ticks[static_cast<size_t>(ProfilePhase::SET_UPDATE)] == 0 ||
+        store_ticks[static_cast<size_t>(ProfilePhase::VERSION_MANAGER)] == 0) {
+        report("store phases missing");
+    }
+    for (double balance : accounts) {
+        assert_double_equals(balance, 10, use_lazy_versioning, use_pessimistic_conflict_detection);
+    }
+}
+
+void ScalabilitySweepTest() {
+    auto report = [](const std::string &message) {
+        std::cerr << "Scalability sweep test failed: " << message << std::endl;
+    };
+    if (SweepThreadCounts(20) != std::vector<size_t>{1, 2, 3, 4, 5, 6, 7, 8, 16, 20} ||
+        SweepThreadCounts(4) != std::vector<size_t>{1, 2, 3, 4} || SweepThreadCounts(1) != std::vector<size_t>{1}) {
+        report("wrong thread counts");
+    }
+    auto estimate = EstimateOf({1, 2, 3});
+    if (std::abs(estimate.mean_ - 2) > 1e-9 || std::abs(estimate.interval_ - 4.303 / std::sqrt(3.0)) > 1e-9) {
+        report("wrong confidence interval");
+    }
+    if (EstimateOf({5}).interval_ != 0) {
+        report("single sample has a confidence interval");
+    }
+}
+
+void AtomicallyTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection) {
+    TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection);
+    auto report = [&](const std::string &message) {
+        std::cerr << "Atomically test failed: " << message << ", lazy versioning: " << use_lazy_versioning
+                  << ", pessimistic conflict detection: " << use_pessimistic_conflict_detection << std::endl;
+    };
+    double from = 100;
+    double to = 0;
+
+    Atomically(&transaction_manager, [&](Transaction &transaction) {
+        transaction.Store(&from, transaction.Load(&from) - 40);
+        transaction.Store(&to, transaction.Load(&to) + 40);
+    });
+    double total = Atomically(&transaction_manager, [&](Transaction &transaction) {
+        return transaction.Load(&from) + transaction.Load(&to);
+    });
+    assert_double_equals(total, 100, use_lazy_versioning, use_pessimistic_conflict_detection);
+    auto owned = Atomically(&transaction_manager, [&](Transaction &transaction) {
+        return std::make_unique<double>(transaction.Load(&to));
+    });
+    assert_double_equals(*owned, 40, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    // The first attempt aborts, the result of the retry is returned
+    size_t aborts = 0;
+    bool first_attempt = true;
+    double balance = Atomically(&transaction_manager, [&](Transaction &transaction) {
+        transaction.Store(&from, 0.0);
+        if (first_attempt) {
+            first_attempt = false;
+            transaction_manager.Abort(&transaction);
+        }
+        return transaction.Load(&to);
+    }, RetryPolicy(), [&](const Transaction &) { aborts++; });
+    if (aborts != 1) {
+        report("wrong number of aborts");
+    }
+    assert_double_equals(balance, 40, use_lazy_versioning, use_pessimistic_conflict_detection);
+    assert_double_equals(from, 0, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    RetryPolicy policy;
+    policy.max_attempts_ = 3;
+    policy.initial_backoff_pauses_ = 1;
+    aborts = 0;
+    try {
+        Atomically(&transaction_manager, [&](Transaction &transaction) {
+            transaction.Store(&to, -1.0);
+            transaction_manager.Abort(&transaction);
+        }, policy, [&](const Transaction &) { aborts++; });
+        report("retry limit ignored");
+    } catch (const RetryLimitException &e) {
+        if (aborts != 3) {
+            report("gave up after the wrong number of attempts");
+        }
+    }
+    assert_double_equals(to, 40, use_lazy_versioning, use_pessimistic_conflict_detection);
+}
+
+void ElasticTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection,
+                 ConflictMetadata conflict_metadata = ConflictMetadata::HASH_SETS) {
+    TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection, conflict_metadata);
+    auto report = [&](const std::string &message) {
+        std::cerr << "Elastic test failed: " << message << ", lazy versioning: " << use_lazy_versioning
+                  << ", pessimistic conflict detection: " << use_pessimistic_conflict_detection
+                  << ", conflict metadata: " << static_cast<int>(conflict_metadata) << std::endl;
+    };
+    std::vector<double> accounts(4, 0);
+
+    // A writer of a released address neither aborts nor gets aborted by the reader
+    try {
+        auto reader = transaction_manager.XBegin();
+        reader.Load(&accounts[0]);
+        reader.Load(&accounts[1]);
+        reader.Release(&accounts[0]);
+        if (reader.GetReadSet() != std::unordered_set<void *>{&accounts[1]}) {
+            report("released address still in the read set");
+        }
+        auto writer = transaction_manager.XBegin();
+        writer.Store(&accounts[0], 1.0);
+        writer.XEnd();
+        reader.XEnd();
+    } catch (const AbortException &e) {
+        report("released read conflicted");
+    }
+    assert_double_equals(accounts[0], 1, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    // Only the most recent reads of an elastic section stay
+    try {
+        auto reader = transaction_manager.XBegin();
+        reader.BeginElastic(2);
+        for (auto &account : accounts) {
+            reader.Load(&account);
+        }
+        reader.EndElastic();
+        reader.Load(&accounts[0]);
+        if (reader.GetReadSet() != std::unordered_set<void *>{&accounts[0], &accounts[2], &accounts[3]}) {
+            report("elastic section kept the wrong reads");
+        }
+        auto writer = transaction_manager.XBegin();
+        writer.Store(&accounts[1], 2.0);
+        writer.XEnd();
+        reader.XEnd();
+    } catch (const AbortException &e) {
+        report("read that left the elastic window conflicted");
+    }
+    assert_double_equals(accounts[1], 2, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    // Written addresses stay tracked
+    RunTransaction(&transaction_manager, [&](Transaction *transaction) {
+        transaction->Store(&accounts[2], transaction->Load(&accounts[2]) + 3);
+        transaction->Release(&accounts[2]);
+        if (transaction->GetWriteSet().count(&accounts[2]) == 0) {
+            report("release dropped a written address");
+        }
+    });
+    assert_double_equals(accounts[2], 3, use_lazy_versioning, use_pessimistic_conflict_detection);
+}
+
+void CommutativeTest(bool use_lazy_versioning, bool use_pessimistic_conflict_detection,
+                     ConflictMetadata conflict_metadata = ConflictMetadata::HASH_SETS) {
+    TransactionManager transaction_manager(use_lazy_versioning, use_pessimistic_conflict_detection, conflict_metadata);
+    auto report = [&](const std::string &message) {
+        std::cerr << "Commutative test failed: " << message << ", lazy versioning: " << use_lazy_versioning
+                  << ", pessimistic conflict detection: " << use_pessimistic_conflict_detection
+                  << ", conflict metadata: " << static_cast<int>(conflict_metadata) << std::endl;
+    };
+    double counter = 0;
+
+    // Concurrent adds to one address both commit, reader bitmaps fall back to conflicting loads and stores
+    if (transaction_manager.SupportsCommutativeUpdates()) {
+        try {
+            auto first = transaction_manager.XBegin();
+            auto second = transaction_manager.XBegin();
+            first.Add(&counter, 1.0);
+            second.Add(&counter, 2.0);
+            first.XEnd();
+            second.XEnd();
+        } catch (const AbortException &e) {
+            report("concurrent adds conflicted");
+        }
+        assert_double_equals(counter, 3, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+        // A store conflicts with a pending add
+        bool committed = false;
+        bool aborted = false;
+        auto updater = transaction_manager.XBegin();
+        updater.Add(&counter, 1.0);
+        try {
+            auto writer = transaction_manager.XBegin();
+            writer.Store(&counter, 10.0);
+            updater.XEnd();
+            committed = true;
+            writer.XEnd();
+        } catch (const AbortException &e) {
+            aborted = true;
+        }
+        if (!committed) {
+            updater.XEnd();
+        }
+        if (!aborted) {
+            report("store didn't conflict with an add");
+        }
+    } else {
+        RunTransaction(&transaction_manager, [&](Transaction *transaction) {
+            transaction->Add(&counter, 4.0);
+        });
+    }
+    assert_double_equals(counter, 4, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    // A load sees the pending deltas and a store replaces them
+    RunTransaction(&transaction_manager, [&](Transaction *transaction) {
+        transaction->Add(&counter, 5.0);
+        if (transaction->Load(&counter) != 9) {
+            report("load missed a pending add");
+        }
+        transaction->Add(&counter, 1.0);
+        transaction->Store(&counter, 20.0);
+        transaction->Add(&counter, 2.0);
+    });
+    assert_double_equals(counter, 22, use_lazy_versioning, use_pessimistic_conflict_detection);
+
+    // Min, max and or
+    std::vector<int64_t> values = {10, 10, 0b0101};
+    RunTransaction(&transaction_manager, [&](Transaction *transaction) {
+        transaction->Min(&values[0], int64_t{3});
+        transaction->Min(&values[0], int64_t{7});
+        transaction->Max(&values[1], int64_t{42});
+        transaction->Or(&values[2], int64_t{0b1010});
+    });
+    if (values != std::vector<int64_t>{3, 42, 0b1111}) {
+        report("min, max or or produced the wrong values");
+    }
+
+    // A rolled back nested transaction drops its deltas
+    RunTransaction(&transaction_manager, [&](Transaction *transaction) {
+        transaction->Add(&counter, 1.0);
+        transaction->XBegin();
+        transaction->Add(&counter, 100.0);
+        transaction->AbortNested();
+    });
+    assert_double_equals(counter, 23, use_lazy_versioning, use_pessimistic_conflict_detection);
+}
+
+void OrecTest() {
+    auto report = [](const std::string &message) {
+        std::cerr << "Orec test failed: " << message << std::endl;
+    };
+
+    // Readers are counted, a writer only gets an orec nobody else reads
+    OrecTable table(1);
+    auto &orec = table.OrecFor(nullptr);
+    uint32_t reader = table.AcquireSlot(0);
+    uint32_t writer = table.AcquireSlot(1);
+    if (!table.AcquireRead(orec, reader)) {
+        report("read of a free orec failed");
+    }
+    if (table.AcquireWrite(orec, writer, false)) {
+        report("write of a read orec succeeded");
+    }
+    if (!table.AcquireWrite(orec, reader, true)) {
+        report("only reader couldn't upgrade to writer");
+    }
+    table.ReleaseWrite(orec, reader);
+    table.ReleaseRead(orec);
+    if (!table.AcquireWrite(orec, writer, false)) {
+        report("write of a released orec failed");
+    }
+    table.ReleaseWrite(orec, writer);
+    table.ReleaseSlot(reader);
+    table.ReleaseSlot(writer);
+    if (table.GetBytes() != sizeof(Orec)) {
+        report("table of one orec isn't four bytes");
+    }
+
+    // Transaction sets grow with the addresses they track, orecs stay the same size
+    std::vector<double> accounts(1000, 0);
+    for (auto conflict_metadata : {ConflictMetadata::HASH_SETS, ConflictMetadata::ORECS}) {
+        TransactionManager transaction_manager(true, true, conflict_metadata);
+        size_t idle_bytes = transaction_manager.GetMetadataBytes();
+        size_t tracking_bytes = 0;
+        RunTransaction(&transaction_manager, [&](Transaction *transaction) {
+            for (auto &account : accounts) {
+                transaction->Store(&account, transaction->Load(&account) + 1);
+            }
+            tracking_bytes = transaction_manager.GetMetadataBytes();
+        });
+        bool orecs = conflict_metadata == ConflictMetadata::ORECS;
+        if (orecs && (idle_bytes != OrecTable::DEFAULT_ORECS * sizeof(Orec) || tracking_bytes != idle_bytes)) {
+            report("orec table changed size");
+        }
+        if (!orecs && tracking_bytes < idle_bytes + accounts.size() * sizeof(TransactionManager::TransactionSet)) {
+            report("transaction set estimate didn't grow with the tracked addresses");
+        }
+    }
+    for (auto account : accounts) {
+        if (account != 2) {
+            report("transfers through orecs lost an update");
+            break;
+        }
+    }
+}
+
+void SharedMemoryTest(bool use_lazy_versioning) {
+    std::string name = "/transaction_memory_test_" + std::to_string(getpid());
+    SharedMemoryRegion::Unlink(name);
+    auto report = [&](const std::string &message) {
+        std::cerr << "Use Lazy Versioning: " << (use_lazy_versioning ? "TRUE" : "FALSE") << std::endl;
+        std::cerr << "Shared memory test failed: " << message << std::endl;
+    };
+
+    constexpr size_t processes = 4;
+    constexpr size_t accounts = 8;
+    constexpr int transfers = 200;
+    constexpr size_t data_size = accounts * sizeof(double) + processes * sizeof(uint64_t);
+    constexpr size_t orecs = 1 << 12;
+
+    // Every process attaches by name, maps the segment at its own address and transfers between the same accounts
+    auto transfer = [&](size_t process) {
+        SharedMemoryRegion region(name, data_size, orecs);
+        TransactionManager transaction_manager(use_lazy_versioning, true, ConflictMetadata::ORECS);
+        transaction_manager.EnableSharedMemory(&region);
+        auto *balances = static_cast<double *>(region.GetData());
+        auto *commits = reinterpret_cast<uint64_t *>(balances + accounts);
+        uint64_t seed = process + 1;
+        for (int i = 0; i < transfers; i++) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            size_t from = (seed >> 33) % accounts;
+            size_t to = (seed >> 40) % accounts;
+            RunTransaction(&transaction_manager, [&](Transaction *transaction) {
+                transaction->Store(&balances[from], transaction->Load(&balances[from]) - 1);
+                transaction->Store(&balances[to], transaction->Load(&balances[to]) + 1);
+                transaction->Store(&commits[process], transaction->Load(&commits[process]) + 1);
+            });
+        }
+    };
+
+    SharedMemoryRegion region(name, data_size, orecs);
+    if (!region.IsCreator()) {
+        report("first process didn't create the segment");
+    }
+    auto *balances = static_cast<double *>(region.GetData());
+    auto *commits = reinterpret_cast<uint64_t *>(balances + accounts);
+    for (size_t account = 0; account < accounts; account++) {
+        balances[account] = 100;
+    }
+
+    std::vector<pid_t> children;
+    for (size_t process = 1; process < processes; process++) {
+        pid_t child = fork();
+        if (child == 0) {
+            try {
+                transfer(process);
+            } catch (...) {
+                _exit(1);
+            }
+            _exit(0);
+        }
+        children.push_back(child);
+    }
+    transfer(0);
+    for (auto child : children) {
+        int status = 0;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            report("transferring child process failed");
+        }
+    }
+
+    double total = 0;
+    for (size_t account = 0; account < accounts; account++) {
+        total += balances[account];
+    }
+    assert_double_equals(total, 100 * accounts, use_lazy_versioning, true);
+    for (size_t process = 0; process < processes; process++) {
+        if (commits[process] != transfers) {
+            report("process " + std::to_string(process) + " counted " + std::to_string(commits[process]) +
+                   " commits");
+        }
+    }
+
+    // Attaching with another layout is refused
+    try {
+        SharedMemoryRegion mismatched(name, 2 * data_size, orecs);
+        report("segment attached with a different data size");
+    } catch (const InvalidStateException &e) {
+    }
+    SharedMemoryRegion::Unlink(name);
+
+    try {
+        TransactionManager transaction_manager(use_lazy_versioning, true);
+        transaction_manager.EnableSharedMemory(&region);
+        report("transaction sets were shared between processes");
+    } catch (const InvalidStateException &e) {
+    }
+}
+
 void TestCorrectness() {
 
     TransactionManager transaction_manager1(true, true);
@@ -287,6 +1279,10 @@ void TestCorrectness() {
     WriteOnlyConflictingTest(&transaction_manager1, true, true);
     ReadWriteNonConflictingTest(&transaction_manager1, true, true);
     ReadWriteConflictingTest(&transaction_manager1, true, true);
+    NestedTransactionTest(&transaction_manager1, true, true);
+    AllocatorTest(&transaction_manager1, true, true);
+    ContainerTest(&transaction_manager1, true, true);
+    TVarTest(&transaction_manager1, true, true);
 
     TransactionManager transaction_manager2(true, false);
 
@@ -296,6 +1292,10 @@ void TestCorrectness() {
     WriteOnlyConflictingTest(&transaction_manager2, true, false);
     ReadWriteNonConflictingTest(&transaction_manager2, true, false);
     ReadWriteConflictingTest(&transaction_manager2, true, false);
+    NestedTransactionTest(&transaction_manager2, true, false);
+    AllocatorTest(&transaction_manager2, true, false);
+    ContainerTest(&transaction_manager2, true, false);
+    TVarTest(&transaction_manager2, true, false);
 
     TransactionManager transaction_manager3(false, true);
 
@@ -305,4 +1305,119 @@ void TestCorrectness() {
     WriteOnlyConflictingTest(&transaction_manager3, false, true);
     ReadWriteNonConflictingTest(&transaction_manager3, false, true);
     ReadWriteConflictingTest(&transaction_manager3, false, true);
+    NestedTransactionTest(&transaction_manager3, false, true);
+    AllocatorTest(&transaction_manager3, false, true);
+    ContainerTest(&transaction_manager3, false, true);
+    TVarTest(&transaction_manager3, false, true);
+
+    TransactionManager transaction_manager4(true, true, ConflictMetadata::READER_BITMAPS);
+
+    ReadOnlyNonConflictingTest(&transaction_manager4, true, true);
+    ReadOnlyConflictingTest(&transaction_manager4, true, true);
+    WriteOnlyNonConflictingTest(&transaction_manager4, true, true);
+    WriteOnlyConflictingTest(&transaction_manager4, true, true);
+    ReadWriteNonConflictingTest(&transaction_manager4, true, true);
+    ReadWriteConflictingTest(&transaction_manager4, true, true);
+    NestedTransactionTest(&transaction_manager4, true, true);
+    AllocatorTest(&transaction_manager4, true, true);
+    ContainerTest(&transaction_manager4, true, true);
+    TVarTest(&transaction_manager4, true, true);
+
+    TransactionManager transaction_manager5(false, true, ConflictMetadata::READER_BITMAPS);
+
+    ReadOnlyNonConflictingTest(&transaction_manager5, false, true);
+    ReadOnlyConflictingTest(&transaction_manager5, false, true);
+    WriteOnlyNonConflictingTest(&transaction_manager5, false, true);
+    WriteOnlyConflictingTest(&transaction_manager5, false, true);
+    ReadWriteNonConflictingTest(&transaction_manager5, false, true);
+    ReadWriteConflictingTest(&transaction_manager5, false, true);
+    NestedTransactionTest(&transaction_manager5, false, true);
+    AllocatorTest(&transaction_manager5, false, true);
+    ContainerTest(&transaction_manager5, false, true);
+    TVarTest(&transaction_manager5, false, true);
+
+    TransactionManager transaction_manager6(true, true, ConflictMetadata::ORECS);
+
+    ReadOnlyNonConflictingTest(&transaction_manager6, true, true);
+    ReadOnlyConflictingTest(&transaction_manager6, true, true);
+    WriteOnlyNonConflictingTest(&transaction_manager6, true, true);
+    WriteOnlyConflictingTest(&transaction_manager6, true, true);
+    ReadWriteNonConflictingTest(&transaction_manager6, true, true);
+    ReadWriteConflictingTest(&transaction_manager6, true, true);
+    NestedTransactionTest(&transaction_manager6, true, true);
+    AllocatorTest(&transaction_manager6, true, true);
+    ContainerTest(&transaction_manager6, true, true);
+    TVarTest(&transaction_manager6, true, true);
+
+    TransactionManager transaction_manager7(false, true, ConflictMetadata::ORECS);
+
+    ReadOnlyNonConflictingTest(&transaction_manager7, false, true);
+    ReadOnlyConflictingTest(&transaction_manager7, false, true);
+    WriteOnlyNonConflictingTest(&transaction_manager7, false, true);
+    WriteOnlyConflictingTest(&transaction_manager7, false, true);
+    ReadWriteNonConflictingTest(&transaction_manager7, false, true);
+    ReadWriteConflictingTest(&transaction_manager7, false, true);
+    NestedTransactionTest(&transaction_manager7, false, true);
+    AllocatorTest(&transaction_manager7, false, true);
+    ContainerTest(&transaction_manager7, false, true);
+    TVarTest(&transaction_manager7, false, true);
+
+    VirtualTimeDeterminismTest(true, true);
+    VirtualTimeDeterminismTest(true, false);
+    VirtualTimeDeterminismTest(false, true);
+
+    HtmCapacityFallbackTest(true, true);
+    HtmCapacityFallbackTest(true, false);
+    HtmCapacityFallbackTest(false, true);
+
+    FlatCombiningTest(true, true);
+    FlatCombiningTest(true, false);
+    FlatCombiningTest(false, true);
+
+    ByteRangeTest(true, true);
+    ByteRangeTest(true, false);
+    ByteRangeTest(false, true);
+
+    PersistenceTest(true, true);
+    PersistenceTest(true, false);
+    PersistenceTest(false, true);
+
+    CoroutineTest(true, true);
+    CoroutineTest(true, false);
+    CoroutineTest(false, true);
+
+    ConflictAwareSchedulerTest(true, true);
+    ConflictAwareSchedulerTest(true, false);
+    ConflictAwareSchedulerTest(false, true);
+
+    AdaptiveModeTest();
+
+    ProfilerTest(true, true);
+    ProfilerTest(true, false);
+    ProfilerTest(false, true);
+
+    ScalabilitySweepTest();
+
+    AtomicallyTest(true, true);
+    AtomicallyTest(true, false);
+    AtomicallyTest(false, true);
+
+    ElasticTest(true, true);
+    ElasticTest(true, false);
+    ElasticTest(false, true);
+    ElasticTest(true, true, ConflictMetadata::READER_BITMAPS);
+    ElasticTest(false, true, ConflictMetadata::READER_BITMAPS);
+    ElasticTest(true, true, ConflictMetadata::ORECS);
+    ElasticTest(false, true, ConflictMetadata::ORECS);
+
+    CommutativeTest(true, true);
+    CommutativeTest(true, false);
+    CommutativeTest(false, true);
+    CommutativeTest(true, true, ConflictMetadata::READER_BITMAPS);
+    CommutativeTest(true, true, ConflictMetadata::ORECS);
+
+    OrecTest();
+
+    SharedMemoryTest(true);
+    SharedMemoryTest(false);
 }
\ No newline at end of file
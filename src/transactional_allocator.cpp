@@ -0,0 +1,205 @@
+#include "include/transactional_allocator.h"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+
+constexpr size_t NUM_SIZE_CLASSES = 9;
+constexpr uint32_t LARGE_BLOCK = UINT32_MAX;
+static_assert(TransactionalAllocator::MIN_BLOCK_SIZE << (NUM_SIZE_CLASSES - 1) == TransactionalAllocator::MAX_BLOCK_SIZE,
+              "Size classes must cover MIN_BLOCK_SIZE to MAX_BLOCK_SIZE");
+
+/**
+ * Sits in front of every block, keeps blocks 16 byte aligned
+ */
+struct alignas(16) BlockHeader {
+    uint32_t size_class_;
+};
+
+/**
+ * Epoch announcement of one thread. The lowest bit is set while the thread is pinned.
+ */
+struct EpochRecord {
+    std::atomic<uint64_t> state_{0};
+    bool in_use_ = true;
+};
+
+struct RetiredBlock {
+    void *block_;
+    uint64_t epoch_;
+};
+
+std::atomic<uint64_t> global_epoch{0};
+
+std::mutex records_mutex;
+std::vector<std::unique_ptr<EpochRecord>> records;
+
+/** Retired blocks of threads that exited before they could be reclaimed */
+std::mutex orphans_mutex;
+std::vector<RetiredBlock> orphans;
+
+EpochRecord *AcquireRecord() {
+    std::lock_guard<std::mutex> lock(records_mutex);
+    for (auto &record : records) {
+        if (!record->in_use_) {
+            record->in_use_ = true;
+            return record.get();
+        }
+    }
+    records.push_back(std::make_unique<EpochRecord>());
+    return records.back().get();
+}
+
+BlockHeader *HeaderOf(void *block) {
+    return reinterpret_cast<BlockHeader *>(block) - 1;
+}
+
+struct ThreadState {
+    ~ThreadState() {
+        for (auto &free_list : free_lists_) {
+            for (auto *block : free_list) {
+                std::free(HeaderOf(block));
+            }
+        }
+        if (!limbo_.empty()) {
+            std::lock_guard<std::mutex> lock(orphans_mutex);
+            orphans.insert(orphans.end(), limbo_.begin(), limbo_.end());
+        }
+        if (record_ != nullptr) {
+            std::lock_guard<std::mutex> lock(records_mutex);
+            record_->state_.store(0);
+            record_->in_use_ = false;
+        }
+    }
+
+    EpochRecord *Record() {
+        if (record_ == nullptr) {
+            record_ = AcquireRecord();
+        }
+        return record_;
+    }
+
+    std::array<std::vector<void *>, NUM_SIZE_CLASSES> free_lists_;
+    std::vector<RetiredBlock> limbo_;
+    EpochRecord *record_ = nullptr;
+    size_t pin_count_ = 0;
+};
+
+thread_local ThreadState thread_state;
+
+uint32_t SizeClass(size_t size) {
+    size_t block_size = TransactionalAllocator::MIN_BLOCK_SIZE;
+    for (uint32_t size_class = 0; size_class < NUM_SIZE_CLASSES; size_class++, block_size <<= 1) {
+        if (size <= block_size) {
+            return size_class;
+        }
+    }
+    return LARGE_BLOCK;
+}
+
+/**
+ * Advance the global epoch if every pinned thread has observed it
+ */
+void TryAdvanceEpoch() {
+    uint64_t epoch = global_epoch.load();
+    {
+        std::lock_guard<std::mutex> lock(records_mutex);
+        for (const auto &record : records) {
+            uint64_t state = record->state_.load();
+            if ((state & 1) != 0 && (state >> 1) != epoch) {
+                return;
+            }
+        }
+    }
+    global_epoch.compare_exchange_strong(epoch, epoch + 1);
+}
+
+/**
+ * A block retired in epoch e may still be referenced by threads pinned in e, all of them are gone once the global
+ * epoch reaches e + 2
+ */
+size_t ReclaimBlocks(std::vector<RetiredBlock> &retired) {
+    uint64_t epoch = global_epoch.load();
+    size_t reclaimed = 0;
+    size_t kept = 0;
+    for (auto &retired_block : retired) {
+        if (retired_block.epoch_ + 2 <= epoch) {
+            TransactionalAllocator::Deallocate(retired_block.block_);
+            reclaimed++;
+        } else {
+            retired[kept++] = retired_block;
+        }
+    }
+    retired.resize(kept);
+    return reclaimed;
+}
+
+}
+
+void *TransactionalAllocator::Allocate(size_t size) {
+    uint32_t size_class = SizeClass(size);
+    if (size_class != LARGE_BLOCK) {
+        auto &free_list = thread_state.free_lists_[size_class];
+        if (!free_list.empty()) {
+            void *block = free_list.back();
+            free_list.pop_back();
+            return block;
+        }
+        size = MIN_BLOCK_SIZE << size_class;
+    }
+
+    auto *header = static_cast<BlockHeader *>(std::malloc(sizeof(BlockHeader) + size));
+    if (header == nullptr) {
+        throw std::bad_alloc();
+    }
+    header->size_class_ = size_class;
+    return header + 1;
+}
+
+void TransactionalAllocator::Deallocate(void *block) {
+    auto *header = HeaderOf(block);
+    if (header->size_class_ != LARGE_BLOCK) {
+        auto &free_list = thread_state.free_lists_[header->size_class_];
+        if (free_list.size() < MAX_POOLED_BLOCKS) {
+            free_list.push_back(block);
+            return;
+        }
+    }
+    std::free(header);
+}
+
+void TransactionalAllocator::Retire(void *block) {
+    thread_state.limbo_.push_back({block, global_epoch.load()});
+    if (thread_state.limbo_.size() >= RECLAIM_THRESHOLD) {
+        Reclaim();
+    }
+}
+
+void TransactionalAllocator::Pin() {
+    if (thread_state.pin_count_++ == 0) {
+        thread_state.Record()->state_.store((global_epoch.load() << 1) | 1);
+    }
+}
+
+void TransactionalAllocator::Unpin() {
+    if (--thread_state.pin_count_ == 0) {
+        thread_state.record_->state_.store(global_epoch.load() << 1);
+    }
+}
+
+size_t TransactionalAllocator::Reclaim() {
+    TryAdvanceEpoch();
+    size_t reclaimed = ReclaimBlocks(thread_state.limbo_);
+
+    std::unique_lock<std::mutex> lock(orphans_mutex, std::try_to_lock);
+    if (lock.owns_lock() && !orphans.empty()) {
+        reclaimed += ReclaimBlocks(orphans);
+    }
+    return reclaimed;
+}
@@ -0,0 +1,129 @@
+#include "include/virtual_time_scheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+VirtualTimeScheduler::VirtualTimeScheduler(size_t cores, uint64_t seed, SimulationCosts costs)
+        : num_cores_(cores), costs_(costs), rng_(seed), running_core_(NO_CORE) {
+    if (cores == 0) {
+        throw std::invalid_argument("Virtual time scheduler needs at least one core");
+    }
+}
+
+uint64_t VirtualTimeScheduler::Run(const std::vector<std::function<void()>> &bodies) {
+    if (bodies.size() > num_cores_) {
+        throw std::invalid_argument("More bodies than simulated cores");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cores_.clear();
+    for (size_t i = 0; i < bodies.size(); i++) {
+        cores_.push_back(std::make_unique<Core>());
+    }
+    running_core_ = NO_CORE;
+    lock.unlock();
+
+    std::vector<std::thread> threads;
+    threads.reserve(bodies.size());
+    for (size_t i = 0; i < bodies.size(); i++) {
+        threads.emplace_back([this, i, &bodies] {
+            current_ = this;
+            current_core_ = i;
+            {
+                std::unique_lock<std::mutex> core_lock(mutex_);
+                cores_[i]->cv_.wait(core_lock, [&] { return running_core_ == i; });
+            }
+
+            bodies[i]();
+
+            {
+                std::unique_lock<std::mutex> core_lock(mutex_);
+                cores_[i]->finished_ = true;
+                RunNextCoreWithoutLocking();
+            }
+            current_ = nullptr;
+            current_core_ = NO_CORE;
+        });
+    }
+
+    lock.lock();
+    RunNextCoreWithoutLocking();
+    lock.unlock();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    uint64_t makespan = 0;
+    for (const auto &core : cores_) {
+        makespan = std::max(makespan, core->clock_);
+    }
+    return makespan;
+}
+
+void VirtualTimeScheduler::Advance(SimulatedOperation operation) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto &core = *cores_[current_core_];
+    core.clock_ += Cost(operation);
+
+    size_t next_core = PickNextCoreWithoutLocking();
+    if (next_core == current_core_) {
+        return;
+    }
+    if (costs_.quantum_cycles_ > 0 && core.clock_ <= cores_[next_core]->clock_ + costs_.quantum_cycles_) {
+        return;
+    }
+    running_core_ = next_core;
+    cores_[next_core]->cv_.notify_one();
+    core.cv_.wait(lock, [&] { return running_core_ == current_core_; });
+}
+
+uint64_t VirtualTimeScheduler::Cost(SimulatedOperation operation) const {
+    switch (operation) {
+        case SimulatedOperation::BEGIN:
+            return costs_.begin_cycles_;
+        case SimulatedOperation::LOAD:
+            return costs_.load_cycles_;
+        case SimulatedOperation::STORE:
+            return costs_.store_cycles_;
+        case SimulatedOperation::COMMIT:
+            return costs_.commit_cycles_;
+        case SimulatedOperation::ABORT:
+            return costs_.abort_cycles_;
+        case SimulatedOperation::STALL:
+            return costs_.stall_cycles_;
+    }
+    return 0;
+}
+
+size_t VirtualTimeScheduler::PickNextCoreWithoutLocking() {
+    uint64_t min_clock = UINT64_MAX;
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < cores_.size(); i++) {
+        if (cores_[i]->finished_) {
+            continue;
+        }
+        if (cores_[i]->clock_ < min_clock) {
+            min_clock = cores_[i]->clock_;
+            candidates.clear();
+        }
+        if (cores_[i]->clock_ == min_clock) {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.empty()) {
+        return NO_CORE;
+    }
+    if (candidates.size() == 1) {
+        return candidates.front();
+    }
+    return candidates[rng_() % candidates.size()];
+}
+
+void VirtualTimeScheduler::RunNextCoreWithoutLocking() {
+    running_core_ = PickNextCoreWithoutLocking();
+    if (running_core_ != NO_CORE) {
+        cores_[running_core_]->cv_.notify_one();
+    }
+}